@@ -0,0 +1,357 @@
+/* ============================================================================================================================================================= *\
+   Pico-Clock-Module.c
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   https://github.com/astlouys/Pico-MQTT-Module
+   Revision 16-OCT-2026
+   Langage: C
+   Version 1.00
+
+   =========================================================================
+   Pico-Clock-Module is compatible with the ASTL Smart Home ecosystem family.
+   =========================================================================
+
+   Raspberry Pi Pico C-Language soft clock: wall-clock time is kept as an offset from time_us_64(). It works the same way on the Pico / PicoW
+   (RP2040, which has a real-time clock) and on the Pico2 / Pico2W (RP2350, which does not).
+
+   NOTE:
+   THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+   WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+   TIME. AS A RESULT, THE AUTHOR SHALL NOT BE HELD LIABLE FOR ANY DIRECT,
+   INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING FROM
+   THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE CODING
+   INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCT.
+
+
+   NOTES:
+   Pico-MQTT_Example.c gives an example on how to use this module:
+     clock_set_datetime(&DateTime);          // when the date and time have been entered or received from the time server.
+     Now = clock_get_time();                 // usec since 01-JAN-1970, as cheap as time_us_64().
+     clock_get_strings(DateString, NULL);    // "DD-MMM-YYYY", only rebuilt when the second changes.
+
+   Reading the clock never takes a lock: the offset is protected by a sequence number (Generation) and each core has its own cache of the
+   formatted date and time. The clock is meant to be set from one place at a time (main loop).
+
+   REVISION HISTORY:
+   =================
+   16-OCT-2026 1.00 - Initial release.
+\* ============================================================================================================================================================= */
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                          Include files
+\* ============================================================================================================================================================= */
+/* Compile-time log level of this module (may be given on the compiler command line, ex: -DCLOCK_LOG_LEVEL=LOG_LEVEL_DEBUG). */
+#ifndef CLOCK_LOG_LEVEL
+#define CLOCK_LOG_LEVEL  LOG_LEVEL_INFO
+#endif  // CLOCK_LOG_LEVEL
+#define LOG_LEVEL  CLOCK_LOG_LEVEL  // must be defined before baseline.h.
+
+#include "baseline.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include "string.h"
+
+#include "Pico-Clock-Module.h"
+
+
+
+/* $PAGE */
+/* $TITLE=Definitions and macros. */
+/* ============================================================================================================================================================= *\
+                                                                     Definitions and macros.
+\* ============================================================================================================================================================= */
+#define RELEASE_VERSION  ///
+
+
+
+/* $PAGE */
+/* $TITLE=Global variables declaration / definition. */
+/* ============================================================================================================================================================= *\
+                                                               Global variables declaration / definition.
+\* ============================================================================================================================================================= */
+extern struct struct_clock StructClock;
+extern UCHAR ShortMonth[13][4];
+
+
+
+/* $PAGE */
+/* $TITLE=Function prototypes. */
+/* ============================================================================================================================================================= *\
+                                                                Function prototypes (module internal).
+\* ============================================================================================================================================================= */
+/* Return the cache of the calling core, rebuilt if the second has changed since last call (interrupts must be disabled). */
+static struct clock_cache *clock_cache_update(void);
+
+/* Convert a date and time to seconds since 01-JAN-1970. */
+static INT64 clock_datetime_to_seconds(const datetime_t *DateTime);
+
+/* Return a consistent copy of the offset between wall-clock time and time_us_64(), along with its generation. */
+static UINT64 clock_get_offset(UINT32 *Generation);
+
+/* Send a string to external monitor through Pico UART (or USB CDC). */
+extern void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...);
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=clock_cache_update() */
+/* ============================================================================================================================================================= *\
+                         Return the cache of the calling core. It is rebuilt only when the wall-clock second has changed since it has been built
+                                              or when the clock has been set in the meantime. Interrupts must be disabled.
+\* ============================================================================================================================================================= */
+static struct clock_cache *clock_cache_update(void)
+{
+  UINT32 Generation;
+
+  UINT64 Second;
+
+  struct clock_cache *Cache;
+
+
+  Second = (clock_get_offset(&Generation) + time_us_64()) / 1000000ull;
+  Cache  = &StructClock.Cache[get_core_num()];
+
+  if ((Cache->FlagValid == FLAG_ON) && (Cache->Second == Second) && (Cache->Generation == Generation)) return Cache;
+
+  clock_time_to_datetime(Second * 1000000ull, &Cache->DateTime);
+  sprintf(Cache->Date, "%2.2u-%s-%4.4u", Cache->DateTime.day, ShortMonth[Cache->DateTime.month], Cache->DateTime.year);
+  sprintf(Cache->Time, "%2.2u:%2.2u:%2.2u", Cache->DateTime.hour, Cache->DateTime.min, Cache->DateTime.sec);
+  Cache->Second     = Second;
+  Cache->Generation = Generation;
+  Cache->FlagValid  = FLAG_ON;
+  ++Cache->Regenerations;
+
+  return Cache;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=clock_datetime_to_seconds() */
+/* ============================================================================================================================================================= *\
+                       Convert a date and time to seconds since 01-JAN-1970 ("days from civil", years begin on March 1st so that February 29th
+                                                                   is the last day of the year).
+\* ============================================================================================================================================================= */
+static INT64 clock_datetime_to_seconds(const datetime_t *DateTime)
+{
+  INT32 Year;
+
+  UINT32 DayOfEra;
+  UINT32 DayOfYear;
+  UINT32 YearOfEra;
+
+  INT64 Days;
+
+
+  Year      = DateTime->year - ((DateTime->month <= 2) ? 1 : 0);
+  YearOfEra = (UINT32)(Year % 400);
+  DayOfYear = ((153 * (DateTime->month + ((DateTime->month > 2) ? -3 : 9))) + 2) / 5 + DateTime->day - 1;
+  DayOfEra  = (YearOfEra * 365) + (YearOfEra / 4) - (YearOfEra / 100) + DayOfYear;
+  Days      = ((INT64)(Year / 400) * 146097) + DayOfEra - 719468;
+
+  return (Days * 86400ll) + (DateTime->hour * 3600) + (DateTime->min * 60) + DateTime->sec;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=clock_get_datetime() */
+/* ============================================================================================================================================================= *\
+                                               Return the wall-clock date and time (regenerated at most once per second).
+\* ============================================================================================================================================================= */
+void clock_get_datetime(datetime_t *DateTime)
+{
+  UINT32 InterruptMask;
+
+
+  InterruptMask = save_and_disable_interrupts();
+  *DateTime = clock_cache_update()->DateTime;
+  restore_interrupts(InterruptMask);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=clock_get_offset() */
+/* ============================================================================================================================================================= *\
+                       Return a consistent copy of the offset between wall-clock time and time_us_64(). The 64-bit offset can not be read in one
+                  access: read it again if the clock has been set in the meantime (Generation changed or odd). Optionally return its generation.
+\* ============================================================================================================================================================= */
+static UINT64 clock_get_offset(UINT32 *Generation)
+{
+  UINT32 Before;
+
+  UINT64 Offset;
+
+
+  do
+  {
+    Before = StructClock.Generation;
+    __dmb();
+    Offset = StructClock.OffsetUSec;
+    __dmb();
+  } while ((Before & 1) || (Before != StructClock.Generation));
+
+  if (Generation != NULL) *Generation = Before;
+
+  return Offset;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=clock_get_strings() */
+/* ============================================================================================================================================================= *\
+                       Copy the "DD-MMM-YYYY" date string to <Date> (CLOCK_DATE_SIZE bytes) and / or the "HH:MM:SS" time string to <Time>
+                    (CLOCK_TIME_SIZE bytes). NULL skips one of them. The strings are only formatted again when the wall-clock second changes.
+\* ============================================================================================================================================================= */
+void clock_get_strings(UCHAR *Date, UCHAR *Time)
+{
+  UINT32 InterruptMask;
+
+  struct clock_cache *Cache;
+
+
+  /* An interrupt handler of the same core could log a message while the cache is being rebuilt. */
+  InterruptMask = save_and_disable_interrupts();
+  Cache = clock_cache_update();
+  if (Date != NULL) memcpy(Date, Cache->Date, CLOCK_DATE_SIZE);
+  if (Time != NULL) memcpy(Time, Cache->Time, CLOCK_TIME_SIZE);
+  restore_interrupts(InterruptMask);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=clock_get_time() */
+/* ============================================================================================================================================================= *\
+                                       Return the wall-clock time in usec since 01-JAN-1970 (one time_us_64() and one addition).
+\* ============================================================================================================================================================= */
+UINT64 clock_get_time(void)
+{
+  return clock_get_offset(NULL) + time_us_64();
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=clock_set_datetime() */
+/* ============================================================================================================================================================= *\
+                                    Set the wall-clock date and time. The day of the week (dotw) is computed from the date and ignored.
+\* ============================================================================================================================================================= */
+void clock_set_datetime(const datetime_t *DateTime)
+{
+  clock_set_time((UINT64)clock_datetime_to_seconds(DateTime) * 1000000ull);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=clock_set_time() */
+/* ============================================================================================================================================================= *\
+                                    Set the wall-clock time in usec since 01-JAN-1970 (ex: from a network time server). The caches of
+                                                            both cores are rebuilt on their next use.
+\* ============================================================================================================================================================= */
+void clock_set_time(UINT64 TimeUSec)
+{
+  UINT32 InterruptMask;
+
+
+  InterruptMask = save_and_disable_interrupts();
+  ++StructClock.Generation;
+  __dmb();
+  StructClock.OffsetUSec = TimeUSec - time_us_64();
+  __dmb();
+  ++StructClock.Generation;
+  restore_interrupts(InterruptMask);
+
+  log_debug("Wall-clock time set to %llu usec (generation %lu).\n", TimeUSec, StructClock.Generation);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=clock_stamp_to_time() */
+/* ============================================================================================================================================================= *\
+                                  Convert a time_us_64() time stamp to wall-clock time in usec since 01-JAN-1970, using the current
+                                                 offset (a time stamp taken before the clock has been set follows it).
+\* ============================================================================================================================================================= */
+UINT64 clock_stamp_to_time(UINT64 Stamp)
+{
+  return clock_get_offset(NULL) + Stamp;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=clock_time_to_datetime() */
+/* ============================================================================================================================================================= *\
+                                 Convert a wall-clock time in usec since 01-JAN-1970 to date and time ("civil from days", years begin
+                                                          on March 1st so that February 29th is the last day of the year).
+\* ============================================================================================================================================================= */
+void clock_time_to_datetime(UINT64 TimeUSec, datetime_t *DateTime)
+{
+  INT32 Month;
+
+  UINT32 DayOfEra;
+  UINT32 DayOfYear;
+  UINT32 YearOfEra;
+
+  INT64 Days;
+  INT64 Seconds;
+
+
+  Seconds = (INT64)(TimeUSec / 1000000ull);
+  Days    = Seconds / 86400ll;
+  Seconds = Seconds % 86400ll;
+
+  DateTime->hour = Seconds / 3600;
+  DateTime->min  = (Seconds / 60) % 60;
+  DateTime->sec  = Seconds % 60;
+  DateTime->dotw = (Days + 4) % 7;  // 01-JAN-1970 was a Thursday.
+
+  Days     += 719468;
+  DayOfEra  = (UINT32)(Days % 146097);
+  YearOfEra = (DayOfEra - (DayOfEra / 1460) + (DayOfEra / 36524) - (DayOfEra / 146096)) / 365;
+  DayOfYear = DayOfEra - ((365 * YearOfEra) + (YearOfEra / 4) - (YearOfEra / 100));
+  Month     = ((5 * DayOfYear) + 2) / 153;
+
+  DateTime->day   = DayOfYear - (((153 * Month) + 2) / 5) + 1;
+  DateTime->month = (Month < 10) ? (Month + 3) : (Month - 9);
+  DateTime->year  = ((Days / 146097) * 400) + YearOfEra + ((DateTime->month <= 2) ? 1 : 0);
+
+  return;
+}
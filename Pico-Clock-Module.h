@@ -0,0 +1,85 @@
+/* ============================================================================================================================================================= *\
+   Pico-Clock-Module.h
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   Revision 16-OCT-2026
+   Langage: C
+\* ============================================================================================================================================================= */
+
+#ifndef __PICO_CLOCK_MODULE_H
+#define __PICO_CLOCK_MODULE_H
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                      Include files.
+\* ============================================================================================================================================================= */
+#include "pico/stdlib.h"
+
+
+
+/* $PAGE */
+/* $TITLE=Definitions. */
+/* ============================================================================================================================================================= *\
+                                                                        Definitions.
+\* ============================================================================================================================================================= */
+#define CLOCK_DATE_SIZE  12  // "DD-MMM-YYYY" date string, including its terminating null.
+#define CLOCK_TIME_SIZE   9  // "HH:MM:SS" time string, including its terminating null.
+
+
+
+/* $PAGE */
+/* $TITLE=Variable definitions. */
+/* ============================================================================================================================================================= *\
+                                                                      Variable definitions.
+\* ============================================================================================================================================================= */
+/* Date and time of the last second seen by one core, regenerated when the second changes (see clock_get_strings()). */
+struct clock_cache
+{
+  UINT8      FlagValid;
+  UINT32     Generation;             // StructClock.Generation when the cache has been built.
+  UINT64     Second;                 // wall-clock second (since 01-JAN-1970) of the cached values.
+  datetime_t DateTime;
+  UCHAR      Date[CLOCK_DATE_SIZE];  // "DD-MMM-YYYY"
+  UCHAR      Time[CLOCK_TIME_SIZE];  // "HH:MM:SS"
+  UINT32     Regenerations;          // number of times the cache has been rebuilt.
+};
+
+struct struct_clock
+{
+  volatile UINT64    OffsetUSec;  // wall-clock time (usec since 01-JAN-1970) minus time_us_64().
+  volatile UINT32    Generation;  // incremented before and after OffsetUSec is changed (odd while it is being changed).
+  struct clock_cache Cache[2];    // one per core: a core only touches its own cache.
+};
+
+
+
+/* $PAGE */
+/* $TITLE=Function prototypes. */
+/* ============================================================================================================================================================= *\
+                                                                     Function prototypes.
+\* ============================================================================================================================================================= */
+/* Return the wall-clock date and time (regenerated at most once per second). */
+void clock_get_datetime(datetime_t *DateTime);
+
+/* Copy the "DD-MMM-YYYY" date string and / or the "HH:MM:SS" time string of the current second (regenerated at most once per second, NULL to skip one). */
+void clock_get_strings(UCHAR *Date, UCHAR *Time);
+
+/* Return the wall-clock time in usec since 01-JAN-1970 (cheap: one time_us_64() and one addition). */
+UINT64 clock_get_time(void);
+
+/* Set the wall-clock date and time (the day of the week is computed from the date). */
+void clock_set_datetime(const datetime_t *DateTime);
+
+/* Set the wall-clock time in usec since 01-JAN-1970 (ex: from a network time server). */
+void clock_set_time(UINT64 TimeUSec);
+
+/* Convert a time_us_64() time stamp to wall-clock time in usec since 01-JAN-1970. */
+UINT64 clock_stamp_to_time(UINT64 Stamp);
+
+/* Convert a wall-clock time in usec since 01-JAN-1970 to date and time. */
+void clock_time_to_datetime(UINT64 TimeUSec, datetime_t *DateTime);
+
+#endif  // __PICO_CLOCK_MODULE_H
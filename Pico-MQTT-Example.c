@@ -3,9 +3,9 @@
    St-Louys Andre - August 2024
    astlouys@gmail.com
    https://github.com/astlouys/Pico-MQTT-Module
-   Revision 04-APR-2026
+   Revision 16-OCT-2026
    Langage: C
-   Version 3.00
+   Version 3.10
 
    Raspberry Pi Pico Firmware showing how to integrate "Pico-MQTT-Module" to your own C-Language program / project.
    This firmware doesn't do much useful things, but it shows how to implement the Pico-MQTT-Module in
@@ -32,6 +32,59 @@
                      - Convert all <\r> to <\n>.
     04-JAN-2026 2.04 - Transfer MQTT initialisaton and setup in the function mqtt_check_connection() to make it much easier to implement and support MQTT health status.
     29-MAR-2026 3.00 - Adapted to the last modifications to comply with ASTL Smart Home ecosystem standards.
+    16-OCT-2026 3.10 - mqtt_incoming_data_cb() uses the tokenized view of the message (mqtt_get_view()) instead of null-terminated sub-strings.
+                     - mqtt_incoming_data_cb() reassembles payloads received in several chunks (mqtt_reassemble_payload()) and processes the message only
+                       when the last chunk has been received. It used to copy each chunk over the previous one, with no check of the payload length.
+                     - Incoming messages are dispatched through the topic router of Pico-MQTT-Module (mqtt_register_handler() / mqtt_dispatch()) instead
+                       of a chain of string compares. <TimeSet> processing moved to mqtt_handler_time_set().
+                     - Publish requests go through the outbound request queue of Pico-MQTT-Module (mqtt_publish_async()), with the outcome logged by
+                       mqtt_publish_complete_cb(). The sleep_ms() that used to wait for the publish callback have been removed.
+                     - mqtt_device_subscribe() queues all device topic filters in one list (mqtt_subscribe_list()), right after mqtt_initialization(),
+                       without waiting for the connection to be accepted. Filters are pipelined and their SUBACK results are logged by
+                       mqtt_subscribe_complete_cb(). Terminal menu subscribe / unsubscribe use the same lists. All handshake sleep_ms() removed.
+                     - StructMQTT.FlagSubscribe is not used anymore: each request is matched to its answer by its own descriptor.
+                     - Main loop is now event-driven (Pico-Scheduler-Module): the 15 seconds and 60 seconds time steps are periodic tasks of a timer
+                       wheel (task_health_check() / task_60_sec()) and the processor sleeps (WFE) until the next task is due, instead of waking up every
+                       200 msec. A lost MQTT connection (mqtt_status_cb()) wakes the main loop to run the health check right away.
+                       Terminal menu option 11 displays the scheduler tasks and statistics.
+                     - While the MQTT broker is down, task_health_check() runs again when the next reconnection attempt is allowed by the reconnection
+                       policy of Pico-MQTT-Module (exponential backoff with jitter, see mqtt_reconnect_delay()) instead of every 15 seconds.
+                     - Persistent session mode is turned On (mqtt_set_persistent_session()): mqtt_initialization() connects with clean session Off
+                       (mqtt_session_request()) and mqtt_device_subscribe() gives the device topic filters to the subscription replay cache
+                       (mqtt_session_subscribe()). When the broker still has the session, no SUBSCRIBE is sent on reconnection and the commands published
+                       for this device during the outage are delivered right after the connection is accepted.
+                     - Terminal menu option 12 displays the publish-to-ack latency of each QoS level (p50 / p99 / max) measured by Pico-MQTT-Module,
+                       then clears it so that each display covers the time since the previous one.
+                     - log_printf() builds each log line in one buffer and, once the scheduler is running, only copies it to a ring buffer of the
+                       calling core (LOG_MODE_ASYNC). The main loop sends the lines to the terminal after each wake-up, and task_log_drain() every
+                       2 seconds or right away when a ring buffer gets half full (EVENT_LOG). While the terminal menu is displayed, the log lines of
+                       its core are sent right away (log_set_direct()), without changing the output mode of the other core.
+                     - Date and time are kept by the soft clock of Pico-Clock-Module (clock_set_datetime()) instead of Pico's real-time clock, which the
+                       Pico2 / Pico2W (RP2350) do not have. Log time stamps use its date and time strings, formatted at most once per second.
+                     - get_pico_identifier() finds the device name by binary search in tables sorted by 64-bit board ID: first the registry kept in the
+                       last sectors of the flash memory (built with host/pico_id_registry and written with picotool), then the built-in table. Devices
+                       may be added to the registry without changing the code.
+                     - Add a headless boot (HEADLESS_BOOT) for production devices: no wait for a USB CDC terminal and no date and time prompts, the
+                       date and time come from the MQTT Time Server. The sleep_ms(300) and sleep_ms(500) of mqtt_initialization() have been removed (the
+                       log is asynchronous). task_boot_link() time stamps Wi-Fi link up and DHCP, and wakes the health check as soon as the IP address is
+                       received (polled every 10 msec from the main loop, for BOOT_LINK_TIMEOUT_MSEC at most). Boot phases are recorded by Pico-MQTT-Module (mqtt_boot_mark()), terminal menu option 13 displays them.
+                     - Add MQTT_ENGINE_CORE1: incoming messages are handed off to core 1 by mqtt_incoming_data_cb() (mqtt_engine_push()) and processed
+                       there by mqtt_process_message() (display and dispatch), in the SIO FIFO interrupt of core 1. Core 1 is then started even
+                       without a terminal.
+                     - Pico-MQTT-Module has no StructMQTT singleton anymore: StructMQTT is the MQTT client instance of this program, initialized with
+                       its receive buffers by mqtt_ctx_init() and given to every function of the module. mqtt_incoming_data_cb(), mqtt_status_cb() and
+                       mqtt_process_message() work on the instance they receive.
+                     - MQTT requests queued on core 1 (terminal menu, message handlers of the engine interrupt) are not given to lwIP there anymore:
+                       Pico-MQTT-Module asks for it through mqtt_status_cb() (MQTT_PUMP_REQUEST) and task_mqtt_pump() does it on core 0 (EVENT_MQTT).
+                     - MqttArena[] holds the copies of topic and payload kept by the message snapshots and, with MQTT_ENGINE_CORE1, by the MQTT engine
+                       slots of StructMQTT (see mqtt_ctx_init()).
+                     - log_header() displays the MQTT connection status with mqtt_get_connection_status(): it also runs on core 1 (terminal menu),
+                       where mqtt_check_connection() used up a reconnection attempt without connecting.
+                     - Terminal menu option 4 (connect) calls mqtt_session_request() under the lwIP lock, as mqtt_initialization() does, and does not wait
+                       800 msec anymore: mqtt_connection_cb() reports the result.
+                     - Topic filter of terminal menu subscribe / unsubscribe is copied to MenuFilter[]: the filter sent again after a reconnection was
+                       read from the topic buffer of term_menu(), reused by later menu input.
+                     - main() stops with an error when mqtt_ctx_init() fails, instead of going on with an uninitialized MQTT instance.
 \* ============================================================================================================================================================= */
 
 
@@ -108,13 +161,21 @@ Test point 6 - Bootsel (upload mode).
 \* ============================================================================================================================================================= */
 #define CYW43_COUNTRY_CODE CYW43_COUNTRY_CANADA  // do not put in Pico-WiFi-Module.h in case different projects are developped for different countries.
 
+/* Headless boot for production devices: no wait for a USB CDC terminal and no date and time prompts, the date and time are received from the
+   MQTT Time Server. May also be selected on the cmake command line (-DHEADLESS_BOOT=ON). */
+// #define HEADLESS_BOOT
+
+/* Process incoming MQTT messages on core 1 (see mqtt_engine_start()): lwIP callbacks on core 0 only hand them off, parsing, display and handlers
+   run on core 1. May also be selected on the cmake command line (-DMQTT_ENGINE_CORE1=ON). */
+// #define MQTT_ENGINE_CORE1
+
 
 
 /* ============================================================================================================================================================= *\
                                                                        Definitions and macros.
 \* ============================================================================================================================================================= */
 #define RELEASE_VERSION
-#define FIRMWARE_VERSION "3.00"
+#define FIRMWARE_VERSION "3.10"
 
 
 
@@ -126,7 +187,7 @@ Test point 6 - Bootsel (upload mode).
 #include "baseline.h"
 #include "hardware/gpio.h"
 #include "hardware/irq.h"
-#include "hardware/rtc.h"
+#include "hardware/sync.h"
 #include "hardware/watchdog.h"
 #include "pico/bootrom.h"
 #include "pico/cyw43_arch.h"
@@ -136,8 +197,10 @@ Test point 6 - Bootsel (upload mode).
 #include "stdarg.h"
 #include <stdio.h>
 
+#include "Pico-Clock-Module.h"
 #include "Pico-WiFi-Module.h"
 #include "Pico-MQTT-Module.h"
+#include "Pico-Scheduler-Module.h"
 
 
 
@@ -154,8 +217,46 @@ UINT8 FlagTimeSet = FLAG_OFF;
 
 datetime_t DateTime;
 
-struct struct_mqtt StructMQTT;
-struct struct_wifi StructWiFi;
+struct struct_clock     StructClock;
+struct struct_mqtt      StructMQTT;
+struct struct_scheduler StructScheduler;
+struct struct_wifi      StructWiFi;
+
+/* Receive buffers of the MQTT client instance, and arena of its snapshots and engine slots (see mqtt_ctx_init()). */
+#ifdef MQTT_ENGINE_CORE1
+#define MQTT_ENGINE_SLOTS  MAX_MQTT_ENGINE_SLOTS
+#else   // MQTT_ENGINE_CORE1
+#define MQTT_ENGINE_SLOTS  0
+#endif  // MQTT_ENGINE_CORE1
+UCHAR MqttTopic[MAX_TOPIC_LENGTH];
+UCHAR MqttPayload[MAX_PAYLOAD_LENGTH];
+UCHAR MqttArena[MQTT_ARENA_SIZE(MAX_TOPIC_LENGTH, MAX_PAYLOAD_LENGTH, MQTT_ENGINE_SLOTS)];
+
+/* Events of the main loop (see sched_signal()). */
+#define EVENT_NETWORK  0x01  // Wi-Fi or MQTT connection has been lost, or the IP address has just been received (task_boot_link()).
+#define EVENT_LOG      0x02  // a log ring buffer is getting full (see log_set_wakeup()).
+#define EVENT_MQTT     0x04  // MQTT requests have been queued on core 1 or in an interrupt: core 0 gives them to lwIP (MQTT_PUMP_REQUEST).
+INT16 HealthTask;            // task number of task_health_check() (see sched_set_next_run()).
+INT16 BootLinkTask;          // task number of task_boot_link(), which polls the Wi-Fi link status until the IP address is received.
+
+/* Safety period of task_log_drain(): the log is also drained after each wake-up of the main loop. */
+#define LOG_DRAIN_MSEC  2000
+
+/* Boot phase time stamps: Wi-Fi link status is polled every BOOT_LINK_POLL_MSEC, until the IP address is received or for BOOT_LINK_TIMEOUT_MSEC after reset. */
+#define BOOT_LINK_POLL_MSEC        10
+#define BOOT_LINK_TIMEOUT_MSEC  30000
+
+/* Topic filters of this device (see mqtt_device_subscribe()) and of the terminal menu. They must stay valid until their list has been answered. */
+UCHAR DeviceFilter[48];
+struct mqtt_subscription DeviceSubscription[] =
+{
+  {"All/#",      0},
+  {DeviceFilter, 1},
+};
+struct mqtt_subscribe_batch DeviceBatch;
+UCHAR MenuFilter[256];  // same size as the topic entered in term_menu(), whose buffer is reused by the next menu input.
+struct mqtt_subscription    MenuSubscription[1];
+struct mqtt_subscribe_batch MenuBatch;
 
 /* Day names. */
 UCHAR DayName[7][13] =
@@ -188,18 +289,66 @@ void input_string(UCHAR *String, UINT16 StringSize, UINT32 TimeOutMSec);
 /* Display log header. */
 void log_header(void);
 
+/* Send the lines waiting in the log ring buffers to stdio. */
+UINT32 log_drain(void);
+
+/* Return log_printf() output mode. */
+UINT8 log_get_mode(void);
+
 /* Send data to log file. */
 void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...);
 
+/* Send the log lines of the calling core right away to stdio (FLAG_ON) or in the current output mode (FLAG_OFF). */
+void log_set_direct(UINT8 FlagDirect);
+
+/* Select log_printf() output mode (LOG_MODE_DIRECT or LOG_MODE_ASYNC, LOG_MODE_BINARY may be added to either one). */
+void log_set_mode(UINT8 Mode);
+
+/* Register the function called when a log ring buffer gets half full. */
+void log_set_wakeup(void (*Wakeup)(void));
+
+/* Callback of log_printf(): wake the main loop when a log ring buffer gets half full. */
+void log_wakeup_cb(void);
+
 /* Subscribe to all required MQTT topics for this device. */
 void mqtt_device_subscribe(void);
 
+/* Handler for the <TimeSet> topic: set Pico's real-time clock. */
+void mqtt_handler_time_set(const struct mqtt_view *View, void *Context);
+
 /* Callback to process the data received from a subscribed topic. */
 static void mqtt_incoming_data_cb(void *arg, const UINT8 *Data, UINT16 DataLength, UINT8 flags);
 
 /* Initialize MQTT client and setup connection with MQTT broker. */
 static void mqtt_initialization(void);
 
+/* Display and dispatch a complete incoming message (on core 0, or on core 1 when the MQTT engine is used). */
+void mqtt_process_message(mqtt_ctx_t *Ctx);
+
+/* Completion callback of a queued publish request. */
+void mqtt_publish_complete_cb(const struct mqtt_request *Request, err_t Result);
+
+/* Completion callback of a subscribe / unsubscribe list. */
+void mqtt_subscribe_complete_cb(struct mqtt_subscribe_batch *Batch);
+
+/* Callback of Pico-MQTT-Module: wake the main loop when the connection with the MQTT broker is lost. */
+void mqtt_status_cb(mqtt_ctx_t *Ctx, UINT16 Status);
+
+/* Task run every 60 seconds. */
+void task_60_sec(void *Context);
+
+/* Task polling the Wi-Fi link status during boot: time stamp Wi-Fi link up and DHCP boot phases. */
+void task_boot_link(void *Context);
+
+/* Task run every 15 seconds and when the network connection is lost: check Wi-Fi and MQTT connection health. */
+void task_health_check(void *Context);
+
+/* Task sending the lines of the log ring buffers to the terminal. */
+void task_log_drain(void *Context);
+
+/* Task giving to lwIP the MQTT requests queued on core 1 or in an interrupt. */
+void task_mqtt_pump(void *Context);
+
 /* Terminal menu when a CDC USB connection is detected during power up sequence. */
 void term_menu(void);
 
@@ -225,18 +374,24 @@ UINT main()
   UINT8 Delay;
   UINT8 PicoType;
 
-  UINT16 ReturnCode;
   UINT16 WaitTime;
 
-  UINT64 CurrentTimer;
-  UINT64 Last15SecTimer;
-  UINT64 Last60SecTimer;
-
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
                                                                           Initializations.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
   stdio_init_all();
+  if (mqtt_ctx_init(&StructMQTT, MqttTopic, sizeof(MqttTopic), MqttPayload, sizeof(MqttPayload), MqttArena, sizeof(MqttArena), MQTT_ENGINE_SLOTS))
+  {
+    /* Nothing works without the MQTT instance (MqttArena[] too small or MQTT_ENGINE_SLOTS not a power of two): stop here. The error is
+       repeated since the terminal may not be connected yet. */
+    while (1)
+    {
+      log_printf(__LINE__, __func__, "Unable to initialize the MQTT instance (see MqttArena[] and MQTT_ENGINE_SLOTS), Firmware stopped.\n");
+      sleep_ms(5000);
+    }
+  }
+  mqtt_boot_mark(&StructMQTT, MQTT_BOOT_MAIN);
 
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
@@ -249,14 +404,16 @@ UINT main()
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
                                                                       Wait for USB CDC connection.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  log_printf(__LINE__, __func__, "Waiting for a USB CDC connection.\n");  // message will not show up on terminal if connection is not established.
   Delay    = 0;
   WaitTime = 50;  // number of msec delay on each pass.
+#ifndef HEADLESS_BOOT
+  log_printf(__LINE__, __func__, "Waiting for a USB CDC connection.\n");  // message will not show up on terminal if connection is not established.
   while (!stdio_usb_connected())
   {
     ++Delay;
     sleep_ms(WaitTime);  // 50 msec added to current wait time for a USB CDC connection.
   }
+#endif  // HEADLESS_BOOT
 
   get_pico_identifier(PicoUniqueId, PicoIdentifier, &PicoType);
   log_printf(__LINE__, __func__, "cls");            // clear terminal emulator screen on entry.
@@ -265,6 +422,10 @@ UINT main()
   log_header();
   log_printf(__LINE__, __func__, "Main program entry point (Delay: %u msec waiting for USB CDC connection).\n", (Delay * WaitTime));
 
+#ifdef HEADLESS_BOOT
+  /* Headless boot: nobody is waiting to enter date and time, they will be received from the MQTT Time Server. */
+  log_printf(__LINE__, __func__, "Headless boot: no date and time prompts, waiting for the MQTT Time Server.\n");
+#else   // HEADLESS_BOOT
   /* Check if USB CDC connection has been detected (message will not show-up if no terminal has been detected). */
   log_printf(__LINE__, __func__, "USB Communications Device Class (CDC) connection has been detected.\n", __LINE__);
 
@@ -316,10 +477,21 @@ UINT main()
                                DateTime.day,  ShortMonth[DateTime.month], DateTime.year,
                                DateTime.hour, DateTime.min,               DateTime.sec);
 
-  rtc_init();                   // initialize Pico's real-time clock.
-  rtc_set_datetime(&DateTime);  // set current time on Pico's real-time clock.
+  clock_set_datetime(&DateTime);  // set current time on the soft clock (Pico-Clock-Module).
+  FlagTimeSet = FLAG_ON;
   log_printf(__LINE__, __func__, "LOG MASK 0x1D");
-  log_printf(__LINE__, __func__, "Now that Pico's real-time clock has been initialized, logged data will be time stamped.\n");
+  log_printf(__LINE__, __func__, "Now that the clock has been set, logged data will be time stamped.\n");
+#endif  // HEADLESS_BOOT
+
+
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                                       Register handlers for the MQTT topics processed by this device.
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  /* NOTE: Topic filters are stored in a topic router (trie), so the time needed to dispatch a message doesn't grow with the number of handlers. */
+  mqtt_register_handler(&StructMQTT, "+/TimeSet/#", mqtt_handler_time_set, NULL);
+
+  /* Keep the session of this device on the broker: no need to subscribe again after a short outage and commands sent meanwhile are not lost. */
+  mqtt_set_persistent_session(&StructMQTT, FLAG_ON);
 
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
@@ -334,98 +506,50 @@ UINT main()
                                                        Starting core1 in charge of handling terminal requests.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
   if (FlagLocalDebug) log_printf(__LINE__, __func__, "Before starting core 1 thread.\n");
+#ifdef MQTT_ENGINE_CORE1
+  /* Core 1 processes incoming MQTT messages: start it with or without a terminal. */
+  multicore_launch_core1(core1_loop);
+  sleep_ms(100);  // give some time to log data from core 1 startup sequence.
+#else   // MQTT_ENGINE_CORE1
   if (stdio_usb_connected())
   {
     /* Start terminal menu only if a terminal has been connected to USB CDC (it SHOULD have been since this the main purpose of this Firmware !!). */
     multicore_launch_core1(core1_loop);
     sleep_ms(100);  // give some time to log data from core 1 startup sequence.
   }
+#endif  // MQTT_ENGINE_CORE1
 
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                          Main core 0 forever loop. Will be executed in core 0 context and will loop forever.
+                                               Register the periodic tasks of the main loop and the MQTT status callback.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  CurrentTimer   = time_us_64();
-  Last15SecTimer = 0ll;
-  Last60SecTimer = CurrentTimer;
-
-  while (1)
-  {
-    CurrentTimer = time_us_64();
-    watchdog_update();  // kick watchdog to keep Firmware alive.
-    rtc_get_datetime(&DateTime);
-    // log_printf(__LINE__, __func__, "Date: %s %2.2u-%3s-%4.4u   %2.2u:%2.2u:%2.2u\n", DayName[DateTime.dotw], DateTime.day, ShortMonth[DateTime.month], DateTime.year, DateTime.hour, DateTime.min, DateTime.sec);
-
-
+  sched_init();
+  HealthTask = sched_add_task("Health check", 15000, EVENT_NETWORK, task_health_check, NULL);
+  sched_add_task("60 seconds", 60000, 0, task_60_sec, NULL);
+  sched_add_task("Log drain", LOG_DRAIN_MSEC, EVENT_LOG, task_log_drain, NULL);
+  sched_add_task("MQTT pump", 0, EVENT_MQTT, task_mqtt_pump, NULL);
+  if (HealthTask >= 0) sched_run_now(HealthTask);  // first health check right away.
+  StructMQTT.mqtt_status = mqtt_status_cb;
 
-    /* --------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                                       15 seconds time step.
-    \* --------------------------------------------------------------------------------------------------------------------------------------------------------- */
-    if ((Last15SecTimer == 0) || (CurrentTimer > (Last15SecTimer + 15000000ll)))
-    {
-      Last15SecTimer = CurrentTimer;
-
-      log_printf(__LINE__, __func__, "Entering 15 seconds time step...\n");
-
-      /* ------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                               Check Wi-Fi (network) connection health.
-      \* ------------------------------------------------------------------------------------------------------------------------------------------------------- */
-      ReturnCode = wifi_check_connection();
-      if (ReturnCode)
-      {
-        if (FlagLocalDebug) log_printf(__LINE__, __func__, "Problem with Wi-Fi connection...\n");
-      }
-      else
-      {
-        if (FlagLocalDebug) log_printf(__LINE__, __func__, "Wi-Fi connection OK.\n");
-      }
+  /* Time stamp Wi-Fi link up and DHCP, and run the health check as soon as the IP address is received to connect to MQTT broker right away. */
+  BootLinkTask = sched_add_task("Boot link", 0, 0, task_boot_link, NULL);
+  if (BootLinkTask >= 0) sched_set_next_run(BootLinkTask, BOOT_LINK_POLL_MSEC);
 
+  /* From now on, log_printf() only copies its lines to a ring buffer: the USB CDC output is done by task_log_drain(), in large chunks. */
+  log_set_wakeup(log_wakeup_cb);
+  log_set_mode(LOG_MODE_ASYNC);
 
 
-      /* ------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                                         Check MQTT connection health.
-      \* ------------------------------------------------------------------------------------------------------------------------------------------------------- */
-      /* Check MQTT health only if Wi-Fi health is OK since it is a pre-requisite. */
-      if (StructWiFi.FlagHealth == FLAG_ON)
-      {
-        ReturnCode = mqtt_check_connection(StructWiFi.FlagHealth);
-        switch (ReturnCode)
-        {
-          case (0):
-            if (FlagLocalDebug) log_printf(__LINE__, __func__, "MQTT connection OK.\n");
-          break;
-
-          case (1):
-            if (StructMQTT.FlagStartupOver)
-              log_printf(__LINE__, __func__, "MQTT connection just restored, proceed with mqtt_initialization() and mqtt_device_subscribe().\n");
-            else
-              log_printf(__LINE__, __func__, "MQTT connection has just been established, proceed with mqtt_initialization() and mqtt_device_subscribe().\n");
-            mqtt_initialization();
-            sleep_ms(500);  // if MQTT broker is too busy, connection may be delayed.
-            mqtt_device_subscribe();
-          break;
-
-          default:
-            if (FlagLocalDebug) log_printf(__LINE__, __func__, "Problem with MQTT connection.\n");
-          break;
-        }
-      }
-    }
-
-
-
-
-
-    /* --------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                                       60 seconds time step.
-    \* --------------------------------------------------------------------------------------------------------------------------------------------------------- */
-    if (CurrentTimer > (Last60SecTimer + 60000000ll))
-    {
-      Last60SecTimer = CurrentTimer;
-    }
-
-
-    sleep_ms(200);  // slow down endless loop to keep Pico cool...
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                          Main core 0 forever loop. Will be executed in core 0 context and will loop forever.
+                           Processor sleeps (WFE) until next task is due or until an event is signaled, instead of polling the timers every 200 msec.
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  while (1)
+  {
+    watchdog_update();  // kick watchdog to keep Firmware alive.
+    sched_poll();
+    log_drain();        // lines logged since the previous wake-up, without waking up for them.
+    sched_wait();
   }
 
   return 0;
@@ -439,9 +563,15 @@ UINT main()
 /* $TITLE=core1_loop() */
 /* ============================================================================================================================================================= *\
                                                               Thread running on core1 - Loop on terminal menu.
+                      With MQTT_ENGINE_CORE1, incoming MQTT messages are also processed on core 1, in the SIO FIFO interrupt, while the terminal
+                                                                      menu runs in thread mode.
 \* ============================================================================================================================================================= */
 void core1_loop(void)
 {
+#ifdef MQTT_ENGINE_CORE1
+  mqtt_engine_start(&StructMQTT, mqtt_process_message);
+#endif  // MQTT_ENGINE_CORE1
+
   sleep_ms(300);
   while (1)
   {
@@ -496,7 +626,7 @@ void log_header(void)
     }
     else
     {
-      if (mqtt_check_connection(StructWiFi.FlagHealth))
+      if (mqtt_get_connection_status(&StructMQTT))  // log_header() also runs on core 1: display only, mqtt_check_connection() is left to task_health_check().
         log_printf(__LINE__, __func__, "<120>Problem with MQTT connection.\n");
       else
         log_printf(__LINE__, __func__, "<120>MQTT connection OK.\n");
@@ -515,15 +645,30 @@ void log_header(void)
 #include "log_printf.c"
 
 
+
+
+
+/* $PAGE */
+/* $TITLE=log_wakeup_cb() */
+/* ============================================================================================================================================================= *\
+                         Callback of log_printf(): wake the main loop to drain the log ring buffers when one of them gets half full (any core).
+\* ============================================================================================================================================================= */
+void log_wakeup_cb(void)
+{
+  sched_signal(EVENT_LOG);
+
+  return;
+}
+
+
 /* $PAGE */
 /* $TITLE=mqtt_device_subscribe() */
 /* ============================================================================================================================================================= *\
-                                                        Subscribe to all required MQTT topics for this device.
+                        Subscribe to all required MQTT topics for this device. All topic filters are given in one list to the subscription replay cache:
+                      they are pipelined as soon as the connection is accepted, or not sent at all when the broker still has the session of this device.
 \* ============================================================================================================================================================= */
 void mqtt_device_subscribe(void)
 {
-  UINT8 QoS;
-
   INT16 ReturnCode;
 
 
@@ -534,71 +679,87 @@ void mqtt_device_subscribe(void)
     return;
   }
 
-  if (mqtt_client_is_connected(StructMQTT.MqttClientInstance) == 0)
-  {
-    log_printf(__LINE__, __func__, "ERROR - MqttClientInstance is not connected to broker.\n");
-    return;
-  }
-
 
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                              Subscribe to topics specific for this device.               
+                                    Subscribe to topics specific for this device: "All" and <Identifier> (see DeviceSubscription[]).
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                                                   All
-  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  mqtt_wipe_packet();
-  sprintf(StructMQTT.Topic, "All/#");
-  StructMQTT.FlagSubscribe = FLAG_ON;
-  ReturnCode = mqtt_subscribe(StructMQTT.MqttClientInstance, StructMQTT.Topic, QoS, mqtt_sub_request_cb, &StructMQTT);
+  sprintf(DeviceFilter, "%s/#", PicoIdentifier);
+  ReturnCode = mqtt_session_subscribe(&StructMQTT, &DeviceBatch, DeviceSubscription, sizeof(DeviceSubscription) / sizeof(DeviceSubscription[0]), mqtt_subscribe_complete_cb, "Device");
   if (ReturnCode)
   {
-    log_printf(__LINE__, __func__, "Error while sending subscribe request for Topic [%s] (ReturnCode: %d).\n", StructMQTT.Topic, ReturnCode);
+    log_printf(__LINE__, __func__, "Error %d while queuing device subscribe requests.\n", ReturnCode);
   }
   else
   {
-    log_printf(__LINE__, __func__, "Subscribe request sent successfully to broker for topic: [%s] (ReturnCode: %d).\n", StructMQTT.Topic, ReturnCode);
+    log_printf(__LINE__, __func__, "Replay cache set for %u topic filters.\n", sizeof(DeviceSubscription) / sizeof(DeviceSubscription[0]));
   }
-  sleep_ms(300);  // wait for response callback to complete to get a clean log and also to get the right "topic being subscribed to" in log file.
 
 
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                                              <Identifier>
+                                                       Request current time from ASTL Smart Home MQTT Time Server.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  /* Subscribe to the topic specific to this device, corresponding to Device Identifier. */
-  mqtt_wipe_packet();
-  sprintf(StructMQTT.Topic,  "%s/#", PicoIdentifier);
-  StructMQTT.FlagSubscribe = FLAG_ON;
-  ReturnCode = mqtt_subscribe(StructMQTT.MqttClientInstance, StructMQTT.Topic, QoS, mqtt_sub_request_cb, &StructMQTT);
+  mqtt_wipe_packet(&StructMQTT);
+  sprintf(StructMQTT.Topic, "TimeServer/TimeRequest/%s", StructMQTT.PicoIdentifier);  // include source of MQTT message as per ASTL Smart Home convention.
+  ReturnCode = mqtt_publish_async(&StructMQTT, StructMQTT.Topic, StructMQTT.Payload, strlen(StructMQTT.Payload), 0, 0, mqtt_publish_complete_cb, "TimeRequest");
   if (ReturnCode)
   {
-    log_printf(__LINE__, __func__, "Error while sending subscribe request for Topic [%s] (ReturnCode: %d).\n", StructMQTT.Topic, ReturnCode);
+    log_printf(__LINE__, __func__, "Error %d while trying to queue publish on Topic <%s>   Payload: <%s>.\n", ReturnCode, StructMQTT.Topic, StructMQTT.Payload);
   }
   else
   {
-    log_printf(__LINE__, __func__, "Subscribe request sent successfully to broker for topic: [%s] (ReturnCode: %d).\n", StructMQTT.Topic, ReturnCode);
+    log_printf(__LINE__, __func__, "Publish request queued for Topic <%s>   Payload: <%s>.\n", StructMQTT.Topic, StructMQTT.Payload);
   }
-  sleep_ms(300);  // wait for response callback to complete to get a clean log and also to get the right "topic being subscribed to" in log file.
 
+  return;
+}
 
 
-  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                       Request current time from ASTL Smart Home MQTT Time Server.
-  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  mqtt_wipe_packet();
-  sprintf(StructMQTT.Topic, "TimeServer/TimeRequest/%s", StructMQTT.PicoIdentifier);  // include source of MQTT message as per ASTL Smart Home convention.
-  ReturnCode = mqtt_publish(StructMQTT.MqttClientInstance, StructMQTT.Topic, StructMQTT.Payload, strlen(StructMQTT.Payload), 0, 0, mqtt_pub_request_cb, &StructMQTT);
-  if (ReturnCode)
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_handler_time_set() */
+/* ============================================================================================================================================================= *\
+                                       Handler for the <TimeSet> topic: set Pico's real-time clock with date and time received from MQTT time server.
+\* ============================================================================================================================================================= */
+void mqtt_handler_time_set(const struct mqtt_view *View, void *Context)
+{
+#ifdef RELEASE_VERSION
+  UINT8 FlagLocalDebug = FLAG_OFF;  // must be turned OFF at all time.
+#else   // RELEASE_VERSION
+  UINT8 FlagLocalDebug = FLAG_OFF;  // may be turned ON for debug purposes.
+#endif  // RELEASE_VERSION
+
+  datetime_t DateTime;
+
+
+  if (FlagLocalDebug) log_printf(__LINE__, __func__, "Processing <TimeSet> subtopic\n");
+
+  /* Set the soft clock with date and time retrieved from MQTT time server. */
+  DateTime.dotw  = mqtt_view_payload_long(View, 0);
+  DateTime.day   = mqtt_view_payload_long(View, 1);
+  DateTime.month = mqtt_view_payload_long(View, 2);
+  DateTime.year  = mqtt_view_payload_long(View, 3);
+  DateTime.hour  = mqtt_view_payload_long(View, 4);
+  DateTime.min   = mqtt_view_payload_long(View, 5);
+  DateTime.sec   = mqtt_view_payload_long(View, 6);
+  clock_set_datetime(&DateTime);  // set current time on the soft clock (Pico-Clock-Module).
+  mqtt_boot_mark(&StructMQTT, MQTT_BOOT_TIME_SET);
+  if (FlagTimeSet == FLAG_OFF)
   {
-    log_printf(__LINE__, __func__, "Error 0x%X while trying to publish on Topic <%s>   Payload: <%s>.\n", ReturnCode, StructMQTT.Topic, StructMQTT.Payload);
+    /* First time received (headless boot): logged data may now be time stamped. */
+    FlagTimeSet = FLAG_ON;
+    log_printf(__LINE__, __func__, "LOG MASK 0x1D");
   }
-  else
+  if (FlagLocalDebug)
   {
-    log_printf(__LINE__, __func__, "Publish request sent successfully to broker for Topic <%s>   Payload: <%s>.\n", StructMQTT.Topic, StructMQTT.Payload);
+    log_printf(__LINE__, __func__, "Date and time as decoded when received from MQTT time server: %s   %u-%s-%u   %2.2u:%2.2u:%2.2u\n",
+               DayName[DateTime.dotw], 
+               DateTime.day, ShortMonth[DateTime.month], DateTime.year, 
+               DateTime.hour, DateTime.min, DateTime.sec);
   }
-  sleep_ms(300);  // wait for response callback to complete to get a clean log and also to get the right "topic being subscribed to" in log file.
 
   return;
 }
@@ -620,52 +781,29 @@ void mqtt_incoming_data_cb(void *ExtraArgument, const UINT8 *Payload, UINT16 Pay
   UINT8 FlagLocalDebug = FLAG_OFF;  // may be turned ON for debug purposes.
 #endif  // RELEASE_VERSION
 
-  datetime_t DateTime;
+  mqtt_ctx_t *Ctx;
 
 
-  StructMQTT.PayloadLength = PayloadLength;
-  strncpy(StructMQTT.Payload, Payload, PayloadLength);
-  StructMQTT.Payload[PayloadLength] = '\0';  // in case the payload must be considered as an ASCII string, add an end-of-string.
+  Ctx = ExtraArgument;  // instance given to mqtt_set_inpub_callback().
 
   if (FlagLocalDebug)
   {
     log_printf(__LINE__, __func__, "Entering mqtt_incoming_data_cb()\n");
-    log_printf(__LINE__, __func__, "Receiving payload for a topic on which we did subscribe: <%s>\n", StructMQTT.Topic);
-    log_printf(__LINE__, __func__, "StructMQTT: %p   ExtraArgument: %p   *Payload: %p   Payload length: <%u>   Flags: 0x%2.2X\n", &StructMQTT, ExtraArgument, Payload, PayloadLength, Flags);
+    log_printf(__LINE__, __func__, "Receiving payload for a topic on which we did subscribe: <%s>\n", Ctx->Topic);
+    log_printf(__LINE__, __func__, "Ctx: %p   *Payload: %p   Payload length: <%u>   Flags: 0x%2.2X\n", Ctx, Payload, PayloadLength, Flags);
   }
 
-  mqtt_parse_item(PARSE_TOPIC);
-  mqtt_parse_item(PARSE_PAYLOAD);
-  
-  /* Display all sub-topics. */
-  mqtt_display_topic();
+  /* Large payloads are received in several chunks. Wait for the last one before processing the message. */
+  if (mqtt_reassemble_payload(Ctx, Payload, PayloadLength, Flags) == FLAG_OFF) return;
 
-  /* Display all sub-payloads. */
-  mqtt_display_payload();
-
-
-  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                                                 TimeSet
-  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  if (strcmp(StructMQTT.SubTopic[1], "TimeSet") == 0)
+  if (Ctx->Engine.FlagOn)
   {
-    if (FlagLocalDebug) log_printf(__LINE__, __func__, "Processing <TimeSet> subtopic\n");
-    /* Set Pico real-time clock with date and time retrieved from MQTT time server. */
-    DateTime.dotw  = strtol(StructMQTT.SubPayload[0], NULL, 10);
-    DateTime.day   = strtol(StructMQTT.SubPayload[1], NULL, 10);
-    DateTime.month = strtol(StructMQTT.SubPayload[2], NULL, 10);
-    DateTime.year  = strtol(StructMQTT.SubPayload[3], NULL, 10);
-    DateTime.hour  = strtol(StructMQTT.SubPayload[4], NULL, 10);
-    DateTime.min   = strtol(StructMQTT.SubPayload[5], NULL, 10);
-    DateTime.sec   = strtol(StructMQTT.SubPayload[6], NULL, 10);
-    rtc_set_datetime(&DateTime);  // set current time on Pico's real-time clock.
-    if (FlagLocalDebug)
-    {
-      log_printf(__LINE__, __func__, "Date and time as decoded when received from MQTT time server: %s   %u-%s-%u   %2.2u:%2.2u:%2.2u\n",
-                 DayName[DateTime.dotw], 
-                 DateTime.day, ShortMonth[DateTime.month], DateTime.year, 
-                 DateTime.hour, DateTime.min, DateTime.sec);
-    }
+    /* MQTT engine: core 1 processes the message, give control back to lwIP right away. */
+    mqtt_engine_push(Ctx);
+  }
+  else
+  {
+    mqtt_process_message(Ctx);
   }
 
   log_printf(__LINE__, __func__, "Exiting mqtt_incoming_data_cb().\n");
@@ -699,7 +837,7 @@ static void mqtt_initialization(void)
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
                                                                      Initialize MQTT client.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  if (mqtt_init())
+  if (mqtt_init(&StructMQTT))
   {
     log_printf(__LINE__, __func__, "Error while trying to create an MQTT client instance.\n");
     log_printf(__LINE__, __func__, "Firmware will restart when progress line reach the end of LCD display...\n");
@@ -753,16 +891,20 @@ static void mqtt_initialization(void)
   if (FlagLocalDebug)
   {
     log_printf(__LINE__, __func__, "MQTT information before trying to connect to MQTT broker:\n");
-    mqtt_display_client();
+    mqtt_display_client(&StructMQTT);
   }
-  sleep_ms(300);  // give some time to complete logging callback before continuing...
 
 
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
                                                                      Connect to MQTT broker.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  /* lwIP must not send the CONNECT packet before mqtt_session_request() had a chance to turn Off its clean session flag. */
+  cyw43_arch_lwip_begin();
   ReturnCode = mqtt_client_connect(StructMQTT.MqttClientInstance, &StructMQTT.BrokerAddress, PORT, mqtt_connection_cb, &StructMQTT, &StructMQTT.MqttClientInfo);
+  if (ReturnCode == ERR_OK) mqtt_session_request(&StructMQTT);
+  cyw43_arch_lwip_end();
+  if (ReturnCode == ERR_OK) mqtt_boot_mark(&StructMQTT, MQTT_BOOT_CONNECT);
   if (ReturnCode != ERR_OK)
   {
     log_printf(__LINE__, __func__, "Error while trying to connect to MQTT broker (return code: %d).\n", ReturnCode);
@@ -771,7 +913,6 @@ static void mqtt_initialization(void)
   else
   {
     log_printf(__LINE__, __func__, "Connection request sent to MQTT broker without error (return code: %d).\n", ReturnCode);
-    sleep_ms(500);  // wait for response callback to complete to get a clean log.
   }
 
   return;
@@ -781,6 +922,284 @@ static void mqtt_initialization(void)
 
 
 
+/* $PAGE */
+/* $TITLE=mqtt_process_message() */
+/* ============================================================================================================================================================= *\
+                       Display and dispatch a complete incoming message. Called by mqtt_incoming_data_cb() on core 0, or by the MQTT engine on core 1
+                 (MQTT_ENGINE_CORE1), where mqtt_get_view() returns the engine view. The view is held while the message is processed, so that it is
+                                                  the same message from display to handlers on any core (see mqtt_hold_view()).
+\* ============================================================================================================================================================= */
+void mqtt_process_message(mqtt_ctx_t *Ctx)
+{
+#ifdef RELEASE_VERSION
+  UINT8 FlagLocalDebug = FLAG_OFF;  // must be turned OFF at all time.
+#else   // RELEASE_VERSION
+  UINT8 FlagLocalDebug = FLAG_OFF;  // may be turned ON for debug purposes.
+#endif  // RELEASE_VERSION
+
+
+  mqtt_hold_view(Ctx, FLAG_ON);
+
+  /* Display all sub-topics. */
+  mqtt_display_topic(Ctx);
+
+  /* Display all sub-payloads. */
+  mqtt_display_payload(Ctx);
+
+  /* Call the handlers registered for this topic (see main()). */
+  if (mqtt_dispatch(Ctx) == 0)
+  {
+    if (FlagLocalDebug) log_printf(__LINE__, __func__, "No handler registered for topic <%s>.\n", mqtt_get_view(Ctx)->Topic);
+  }
+
+  mqtt_hold_view(Ctx, FLAG_OFF);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_publish_complete_cb() */
+/* ============================================================================================================================================================= *\
+                                   Completion callback of a queued publish request (its Context is a short string telling who queued it).
+\* ============================================================================================================================================================= */
+void mqtt_publish_complete_cb(const struct mqtt_request *Request, err_t Result)
+{
+  if (Result == ERR_OK)
+    log_printf(__LINE__, __func__, "<%s> publish %u on topic <%s> completed in %llu usec.\n", (UCHAR *)Request->Context, Request->Id, Request->Topic, time_us_64() - Request->IssueTime);
+  else
+    log_printf(__LINE__, __func__, "<%s> publish %u on topic <%s> failed (error: %d).\n", (UCHAR *)Request->Context, Request->Id, Request->Topic, Result);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_status_cb() */
+/* ============================================================================================================================================================= *\
+                   Callback of Pico-MQTT-Module (may run in lwIP interrupt context). When the connection with the MQTT broker is lost, wake the main
+                   loop to run the health check right away instead of waiting for the next 15 seconds time step. Only the first error is signaled:
+                          Ctx->FlagHealth is turned Off by the health check, so failed reconnection attempts don't make it run over and over.
+                    Requests queued on core 1 or in an interrupt (MQTT_PUMP_REQUEST) are given to lwIP by task_mqtt_pump() on core 0.
+\* ============================================================================================================================================================= */
+void mqtt_status_cb(mqtt_ctx_t *Ctx, UINT16 Status)
+{
+  if ((Status == MQTT_CONNECTION_ERROR) && (Ctx->FlagHealth == FLAG_ON)) sched_signal(EVENT_NETWORK);
+  if (Status == MQTT_PUMP_REQUEST) sched_signal(EVENT_MQTT);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_subscribe_complete_cb() */
+/* ============================================================================================================================================================= *\
+                       Completion callback of a subscribe / unsubscribe list: log the result of each topic filter (Context tells who queued the list).
+\* ============================================================================================================================================================= */
+void mqtt_subscribe_complete_cb(struct mqtt_subscribe_batch *Batch)
+{
+  UINT8 Loop1UInt8;
+
+
+  for (Loop1UInt8 = 0; Loop1UInt8 < Batch->Count; ++Loop1UInt8)
+    log_printf(__LINE__, __func__, "<%s> topic filter <%s>   QoS: %u   result: %d\n", (UCHAR *)Batch->Context, Batch->List[Loop1UInt8].Filter, Batch->List[Loop1UInt8].QoS, Batch->List[Loop1UInt8].Result);
+
+  if (Batch->Failed)
+    log_printf(__LINE__, __func__, "<%s> %u of %u topic filters failed.\n", (UCHAR *)Batch->Context, Batch->Failed, Batch->Count);
+  else
+    log_printf(__LINE__, __func__, "<%s> all %u topic filters done.\n", (UCHAR *)Batch->Context, Batch->Count);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=task_60_sec() */
+/* ============================================================================================================================================================= *\
+                                                                      Task run every 60 seconds.
+\* ============================================================================================================================================================= */
+void task_60_sec(void *Context)
+{
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=task_boot_link() */
+/* ============================================================================================================================================================= *\
+                    Task run every BOOT_LINK_POLL_MSEC during boot: time stamp the Wi-Fi link up and DHCP boot phases. When the IP address has been
+                  received, wake the main loop to run the health check (MQTT connection) right away. The task stops rescheduling itself once the
+                 IP address has been received, or BOOT_LINK_TIMEOUT_MSEC after reset (the health check keeps on checking the Wi-Fi connection).
+\* ============================================================================================================================================================= */
+void task_boot_link(void *Context)
+{
+  INT32 LinkStatus;
+
+
+  /* Link status is read from the main loop, under the lwIP lock, not from interrupt context. */
+  cyw43_arch_lwip_begin();
+  LinkStatus = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+  cyw43_arch_lwip_end();
+
+  if ((LinkStatus == CYW43_LINK_JOIN) || (LinkStatus == CYW43_LINK_NOIP)) mqtt_boot_mark(&StructMQTT, MQTT_BOOT_LINK_UP);
+
+  if (LinkStatus == CYW43_LINK_UP)
+  {
+    mqtt_boot_mark(&StructMQTT, MQTT_BOOT_LINK_UP);
+    mqtt_boot_mark(&StructMQTT, MQTT_BOOT_DHCP);
+    sched_signal(EVENT_NETWORK);
+    return;
+  }
+
+  if (time_us_64() >= (BOOT_LINK_TIMEOUT_MSEC * 1000ull))
+  {
+    log_printf(__LINE__, __func__, "No IP address %u msec after reset: stop polling the Wi-Fi link status for boot time stamps.\n", BOOT_LINK_TIMEOUT_MSEC);
+    return;
+  }
+
+  sched_set_next_run(BootLinkTask, BOOT_LINK_POLL_MSEC);
+
+  return;
+}
+
+
+
+
+
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=task_health_check() */
+/* ============================================================================================================================================================= *\
+                               Task run every 15 seconds and when the network connection is lost: check Wi-Fi and MQTT connection health.
+\* ============================================================================================================================================================= */
+void task_health_check(void *Context)
+{
+#ifdef RELEASE_VERSION
+  UINT8 FlagLocalDebug = FLAG_OFF;  // must be turned OFF at all time.
+#else   // RELEASE_VERSION
+  UINT8 FlagLocalDebug = FLAG_OFF;  // may be turned ON for debug purposes.
+#endif  // RELEASE_VERSION
+
+  UINT16 ReturnCode;
+
+  UINT32 Delay;
+
+
+  log_printf(__LINE__, __func__, "Entering 15 seconds time step...\n");
+
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                                                  Check Wi-Fi (network) connection health.
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  ReturnCode = wifi_check_connection();
+  if (ReturnCode)
+  {
+    if (FlagLocalDebug) log_printf(__LINE__, __func__, "Problem with Wi-Fi connection...\n");
+  }
+  else
+  {
+    if (FlagLocalDebug) log_printf(__LINE__, __func__, "Wi-Fi connection OK.\n");
+  }
+
+
+
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                                                     Check MQTT connection health.
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  /* Check MQTT health only if Wi-Fi health is OK since it is a pre-requisite. */
+  if (StructWiFi.FlagHealth == FLAG_ON)
+  {
+    ReturnCode = mqtt_check_connection(&StructMQTT, StructWiFi.FlagHealth);
+    switch (ReturnCode)
+    {
+      case (0):
+        if (FlagLocalDebug) log_printf(__LINE__, __func__, "MQTT connection OK.\n");
+      break;
+
+      case (1):
+        if (StructMQTT.FlagStartupOver)
+          log_printf(__LINE__, __func__, "MQTT connection just restored, proceed with mqtt_initialization() and mqtt_device_subscribe().\n");
+        else
+          log_printf(__LINE__, __func__, "MQTT connection has just been established, proceed with mqtt_initialization() and mqtt_device_subscribe().\n");
+        mqtt_initialization();
+        mqtt_device_subscribe();  // queued now, sent as soon as the broker accepts the connection.
+      break;
+
+      case (2):
+        if (FlagLocalDebug) log_printf(__LINE__, __func__, "MQTT connection down, waiting for next reconnection attempt.\n");
+      break;
+
+      default:
+        if (FlagLocalDebug) log_printf(__LINE__, __func__, "Problem with MQTT connection.\n");
+      break;
+    }
+
+    /* While MQTT broker is down, come back when next reconnection attempt is allowed (exponential backoff) instead of waiting for next 15 seconds time step. */
+    if (ReturnCode != 0)
+    {
+      Delay = mqtt_reconnect_delay(&StructMQTT);
+      if (Delay < 15000) sched_set_next_run(HealthTask, Delay);
+    }
+  }
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=task_log_drain() */
+/* ============================================================================================================================================================= *\
+                  Task run when a log ring buffer gets half full, and every LOG_DRAIN_MSEC for the lines logged while the main loop sleeps (lines
+                                  logged by the tasks are sent by the main loop right after they run): send the logged lines to the terminal.
+\* ============================================================================================================================================================= */
+void task_log_drain(void *Context)
+{
+  log_drain();
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=task_mqtt_pump() */
+/* ============================================================================================================================================================= *\
+                        Task giving to lwIP the MQTT requests queued on core 1 or in an interrupt (signaled by mqtt_status_cb(), EVENT_MQTT).
+\* ============================================================================================================================================================= */
+void task_mqtt_pump(void *Context)
+{
+  mqtt_queue_pump(&StructMQTT);
+
+  return;
+}
+
+
+
+
+
 /* $PAGE */
 /* $TITLE=term_menu()) */
 /* ============================================================================================================================================================= *\
@@ -809,6 +1228,11 @@ void term_menu()
   while (1)
   {
     input_string(String, 1, 0ll);
+
+    /* Terminal menu mixes printf() and log_printf(): send the log lines of this core right away so that they show up in the right order. The
+       output mode is not changed: the other core keeps on logging to its ring buffer, sent by task_log_drain() (log_drain() must not be
+       called from two cores). */
+    log_set_direct(FLAG_ON);
     log_header();
     log_printf(__LINE__, __func__, "         Terminal menu\n");
     log_printf(__LINE__, __func__, "         =============\n");
@@ -822,6 +1246,9 @@ void term_menu()
     log_printf(__LINE__, __func__, "    8) - Unsubscribe from a MQTT topic.\n");
     log_printf(__LINE__, __func__, "    9) - Set MQTT client parameters.\n");
     log_printf(__LINE__, __func__, "   10) - Find memory pattern for a given number.\n");
+    log_printf(__LINE__, __func__, "   11) - Display scheduler information.\n");
+    log_printf(__LINE__, __func__, "   12) - Display MQTT publish latency (and clear it).\n");
+    log_printf(__LINE__, __func__, "   13) - Display boot phase time stamps.\n");
     log_printf(__LINE__, __func__, " \n");
     log_printf(__LINE__, __func__, "   77) - Clear terminal screen.\n");
     log_printf(__LINE__, __func__, "   88) - Restart the Firmware.\n");
@@ -839,6 +1266,7 @@ void term_menu()
     {
       String[0] = 0x00;
       printf("\n\n\n");
+      log_set_direct(FLAG_OFF);
 
       return;
     }
@@ -865,7 +1293,7 @@ void term_menu()
         log_printf(__LINE__, __func__, Separator);
         log_printf(__LINE__, __func__, "<120>Display current MQTT client information.\n");
         log_printf(__LINE__, __func__, Separator);
-        mqtt_display_client();
+        mqtt_display_client(&StructMQTT);
         printf("\n\n");
       break;
 
@@ -911,14 +1339,17 @@ void term_menu()
         input_string(String, 1, 0ll);
         if ((String[0] == 'G') || (String[0] == 'g'))
         {
+          /* Same sequence as mqtt_initialization(): the clean session flag must be turned Off before lwIP sends the CONNECT packet. The result
+             is reported by mqtt_connection_cb() once CONNACK comes back, there is no need to wait for it here. */
           log_printf(__LINE__, __func__, "Connecting client to MQTT broker.\n");
+          cyw43_arch_lwip_begin();
           ReturnCode = mqtt_client_connect(StructMQTT.MqttClientInstance, &StructMQTT.BrokerAddress, PORT, mqtt_connection_cb, &StructMQTT, &StructMQTT.MqttClientInfo);
+          if (ReturnCode == ERR_OK) mqtt_session_request(&StructMQTT);
+          cyw43_arch_lwip_end();
           if (ReturnCode != ERR_OK)
             log_printf(__LINE__, __func__, "Error 0x%X while trying to connect to MQTT broker.\n", ReturnCode);
           else
             log_printf(__LINE__, __func__, "Connection request sent to MQTT broker without error (return code: %d).\n", ReturnCode);
-
-          sleep_ms(800);
         }
         else
         {
@@ -974,20 +1405,25 @@ void term_menu()
           break;
         }
 
+        /* The filter is sent again if the connection is lost before the broker answers: copy it where the next menu input will not overwrite it. */
+        if (MenuBatch.Remaining)
+        {
+          log_printf(__LINE__, __func__, "ERROR - Previous subscribe / unsubscribe of the menu is still in progress.\n");
+          break;
+        }
         log_printf(__LINE__, __func__, "Subscribing to topic: <%s>\n", Topic);
-        mqtt_wipe_packet();
-        strcpy(StructMQTT.Topic, Topic);
-        StructMQTT.FlagSubscribe = FLAG_ON;
-        ReturnCode = mqtt_subscribe(StructMQTT.MqttClientInstance, Topic, 1, mqtt_sub_request_cb, &StructMQTT);
+        strcpy(MenuFilter, Topic);
+        MenuSubscription[0].Filter = MenuFilter;
+        MenuSubscription[0].QoS    = 1;
+        ReturnCode = mqtt_subscribe_list(&StructMQTT, &MenuBatch, MenuSubscription, 1, mqtt_subscribe_complete_cb, "Menu subscribe");
         if (ReturnCode)
         {
-          log_printf(__LINE__, __func__, "Error 0x%X while trying to subscribe to topic <%s>.\n", ReturnCode, Topic);
+          log_printf(__LINE__, __func__, "Error %d while trying to subscribe to topic <%s>.\n", (INT16)ReturnCode, Topic);
         }
         else
         {
-          log_printf(__LINE__, __func__, "Successfully sent subscribe request.\n");
+          log_printf(__LINE__, __func__, "Successfully queued subscribe request.\n");
         }
-        sleep_ms(100);
         printf("\n\n");
       break;
 
@@ -1025,16 +1461,12 @@ void term_menu()
           break;
         }
 
-        mqtt_wipe_packet();
-        strcpy(StructMQTT.Topic, Topic);
-        strcpy(StructMQTT.Payload, Payload);
         log_printf(__LINE__, __func__, "Publishing on Topic: <%s>   Payload: <%s>\n", Topic, Payload);
-        ReturnCode = mqtt_publish(StructMQTT.MqttClientInstance, Topic, Payload, strlen(Payload), 0, 0, mqtt_pub_request_cb, &StructMQTT);
+        ReturnCode = mqtt_publish_async(&StructMQTT, Topic, Payload, strlen(Payload), 0, 0, mqtt_publish_complete_cb, "Menu");
         if (ReturnCode)
         {
-          log_printf(__LINE__, __func__, "Error 0x%X while trying to publish on Topic <%s>   Payload: <%s>.\n", ReturnCode, Topic, Payload);
+          log_printf(__LINE__, __func__, "Error %d while trying to queue publish on Topic <%s>   Payload: <%s>.\n", (INT16)ReturnCode, Topic, Payload);
         }
-        sleep_ms(100);
         printf("\n\n");
       break;
 
@@ -1066,15 +1498,19 @@ void term_menu()
           break;
         }
 
-        mqtt_wipe_packet();
-        strcpy(StructMQTT.Topic, Topic);
-        StructMQTT.FlagSubscribe = FLAG_OFF;
-        if ((ReturnCode = mqtt_unsubscribe(StructMQTT.MqttClientInstance, Topic, mqtt_sub_request_cb, &StructMQTT)) != 0)
+        /* Same as subscribe: the filter must stay valid until the broker has answered. */
+        if (MenuBatch.Remaining)
         {
-          log_printf(__LINE__, __func__, "Error %d while trying to unsubscribe from topic: <%s>\n", ReturnCode, Topic);
+          log_printf(__LINE__, __func__, "ERROR - Previous subscribe / unsubscribe of the menu is still in progress.\n");
+          break;
+        }
+        strcpy(MenuFilter, Topic);
+        MenuSubscription[0].Filter = MenuFilter;
+        if ((ReturnCode = mqtt_unsubscribe_list(&StructMQTT, &MenuBatch, MenuSubscription, 1, mqtt_subscribe_complete_cb, "Menu unsubscribe")) != 0)
+        {
+          log_printf(__LINE__, __func__, "Error %d while trying to unsubscribe from topic: <%s>\n", (INT16)ReturnCode, Topic);
           break;
         }
-        sleep_ms(100);
         printf("\n\n");
       break;
 
@@ -1117,6 +1553,28 @@ void term_menu()
         printf("\n\n");
       break;
 
+      case (11):
+        /* Display scheduler information. */
+        printf("\n\n");
+        sched_display();
+        printf("\n\n");
+      break;
+
+      case (12):
+        /* Display MQTT publish-to-ack latency of each QoS level, then start a new measurement period. */
+        printf("\n\n");
+        mqtt_display_latency(&StructMQTT);
+        mqtt_reset_latency(&StructMQTT);
+        printf("\n\n");
+      break;
+
+      case (13):
+        /* Display the time of each boot phase since reset. */
+        printf("\n\n");
+        mqtt_display_boot(&StructMQTT);
+        printf("\n\n");
+      break;
+
       case (77):
         /* Clear terminal screen. */
         log_printf(__LINE__, __func__, "CLS");
@@ -2,7 +2,7 @@
    Pico-MQTT-Module.h
    St-Louys Andre - May 2025
    astlouys@gmail.com
-   Revision 02-APR-2026
+   Revision 16-OCT-2026
    Langage: C
 \* ============================================================================================================================================================= */
 
@@ -17,6 +17,8 @@
                                                                       Include files.
 \* ============================================================================================================================================================= */
 #include "lwip/apps/mqtt.h"
+#include "lwip/apps/mqtt_priv.h"
+#include "pico/critical_section.h"
 
 
 
@@ -33,7 +35,79 @@
 #define PARSE_TOPIC                  1  // determine which item is to be parsed (topic or payload).
 #define PARSE_PAYLOAD                2  // determine which item is to be parsed (topic or payload).
 #define PORT                      1883  // port used for MQTT.
-#define MAX_MQTT_BREAKDOWN_HISTORY  10  // number of breakdown history items to keep in memory.
+#define MAX_ROUTE_NODES            128  // maximum number of topic levels in the topic router (all registered filters together, see mqtt_register_handler()).
+#define MAX_ROUTE_BUCKETS          256  // size of the topic router hash table (must be a power of 2, at least twice MAX_ROUTE_NODES).
+#define MAX_ROUTE_TEXT             512  // maximum number of characters of all topic levels in the topic router.
+#define MQTT_ROUTE_NONE           0xFF  // no such node in the topic router.
+#define MAX_MQTT_REQUESTS            8  // maximum number of outbound requests waiting in the queue or in flight (see mqtt_publish_async()).
+#define MAX_REQUEST_TOPIC_LENGTH    64  // length of the topic shown for a request in flight (see mqtt_snapshot_statistics(), including end-of-string).
+#define MQTT_RECONNECT_INITIAL    2000  // default delay between the first and the second reconnection attempts (msec, the first attempt is immediate).
+#define MQTT_RECONNECT_MAX      120000  // default maximum delay between two reconnection attempts (msec).
+#define MQTT_RECONNECT_JITTER       50  // default percentage of each delay that is randomized (spreads the reconnection of all devices after a broker restart).
+#define MQTT_SESSION_CLEAN_FLAG   0x02  // clean session flag in the connect flags of a CONNECT packet.
+#define MQTT_SESSION_PRESENT_FLAG 0x01  // session present flag in the acknowledge flags of a CONNACK packet.
+#define MQTT_CONNACK_TYPE         0x20  // packet type of a CONNACK packet (first byte of its fixed header).
+#define MQTT_CONNACK_FLAGS_INDEX     2  // acknowledge flags of the CONNACK packet in lwIP receive buffer (after the 2-byte fixed header).
+#define MQTT_AVAILABILITY_BUCKETS  168  // number of buckets of the availability rolling window (one week of one-hour buckets).
+#define MQTT_AVAILABILITY_BUCKET  3600  // duration of one bucket of the availability rolling window (sec).
+#define MQTT_LATENCY_BUCKETS       112  // number of buckets of each latency histogram (4 per power of 2, from 1 usec up to about 9 minutes).
+
+/* Boot phases (see mqtt_boot_mark()). Time stamps are time_us_64() values, that is usec since reset. */
+#define MQTT_BOOT_RESET              0  // power up or reset (time_us_64() starts at 0).
+#define MQTT_BOOT_MAIN               1  // main() entry.
+#define MQTT_BOOT_LINK_UP            2  // Wi-Fi network joined (link up).
+#define MQTT_BOOT_DHCP               3  // IP address received from DHCP server.
+#define MQTT_BOOT_CONNECT            4  // connection request given to lwIP (TCP connection to the broker starts).
+#define MQTT_BOOT_CONNACK            5  // connection accepted by the broker.
+#define MQTT_BOOT_SUBACK             6  // first subscription acknowledged (or broker session resumed with its subscriptions).
+#define MQTT_BOOT_TIME_SET           7  // date and time received from the Time Server.
+#define MQTT_BOOT_PHASES             8
+
+/* Number of MQTT client instances, one per broker connection (see mqtt_ctx_init(), may be changed at compile time). */
+#ifndef MAX_MQTT_INSTANCES
+#define MAX_MQTT_INSTANCES           2
+#endif  // MAX_MQTT_INSTANCES
+
+/* Maximum number of incoming messages waiting for the MQTT engine of core 1 (power of 2, may be changed at compile time). Each instance gives its own
+   number of slots to mqtt_ctx_init(), and each slot takes TopicSize + PayloadSize bytes of the arena of the instance. */
+#ifndef MAX_MQTT_ENGINE_SLOTS
+#define MAX_MQTT_ENGINE_SLOTS        8
+#endif  // MAX_MQTT_ENGINE_SLOTS
+
+/* Size of the arena given to mqtt_ctx_init(): a copy of topic and payload for each engine slot, the two message snapshots, the reader copy and
+   each outbound request. */
+#define MQTT_ARENA_SIZE(TopicSize, PayloadSize, SlotCount)  (((SlotCount) + 3 + MAX_MQTT_REQUESTS) * ((TopicSize) + (PayloadSize)))
+
+/* Number of breakdowns kept in the breakdown history (16 bytes each, may be changed at compile time). */
+#ifndef MAX_MQTT_BREAKDOWN_HISTORY
+#define MAX_MQTT_BREAKDOWN_HISTORY 128
+#endif  // MAX_MQTT_BREAKDOWN_HISTORY
+
+/* Flags of the cached message view (see struct mqtt_view). */
+#define MQTT_VIEW_TOPIC           0x01  // topic has been tokenized into sub-topic spans.
+#define MQTT_VIEW_PAYLOAD         0x02  // payload has been tokenized into sub-payload spans.
+#define MQTT_VIEW_OVERFLOW        0x04  // topic has more than MAX_SUB_TOPICS levels: SubTopic[] holds the first ones only, mqtt_dispatch() ignores it.
+
+/* Parts of the snapshots read by the other core (see mqtt_snapshot_update()). */
+#define MQTT_SNAPSHOT_CONNECTION  0x01  // connection state, reconnections, session, breakdown history and availability.
+#define MQTT_SNAPSHOT_STATISTICS  0x02  // outbound request queue counters and requests in flight.
+#define MQTT_SNAPSHOT_MESSAGE     0x04  // last complete incoming message.
+#define MQTT_SNAPSHOT_FORCE       0x80  // copy the parts even if the other core has never read them (readers on the network core).
+
+/* Packet reset mode used by mqtt_wipe_packet() (see WipeMode in struct struct_mqtt). */
+#define MQTT_WIPE_TRACKED            0  // clear only the part of Topic and Payload that has been written since last wipe (default).
+#define MQTT_WIPE_FULL               1  // clear the whole Topic and Payload data space (original behavior).
+
+/* States of an outbound request (see struct mqtt_request). */
+#define MQTT_REQUEST_FREE            0  // request slot is available.
+#define MQTT_REQUEST_QUEUED          1  // waiting for a free lwIP in-flight slot (MQTT_REQ_MAX_IN_FLIGHT).
+#define MQTT_REQUEST_IN_FLIGHT       2  // given to lwIP, waiting for the answer of the broker.
+#define MQTT_REQUEST_COMPLETING      3  // answered, completion callback running (slot not available yet).
+
+/* Operation of an outbound request. */
+#define MQTT_OP_PUBLISH              0
+#define MQTT_OP_SUBSCRIBE            1
+#define MQTT_OP_UNSUBSCRIBE          2
 
 /* Result codes when am action is required after execution of a callback. */
 #define MQTT_CONNECTION_OK        1001  // connect with MQTT broker without error.
@@ -47,6 +121,7 @@
 #define MQTT_SUBSCRIBE_ERROR      1009  // error while trying to subscribe to a specific topic.
 #define MQTT_UNSUBSCRIBE_OK       1010  // unsubscribe from a specific topic without error.
 #define MQTT_UNSUBSCRIBE_ERROR    1011  // error while trying to unsubscribe from a specific topic.
+#define MQTT_PUMP_REQUEST         1012  // requests queued from the other core or from an interrupt: call mqtt_queue_pump() from the core of lwIP.
 
 
 /* $PAGE */
@@ -54,27 +129,373 @@
 /* ============================================================================================================================================================= *\
                                                                       Variable definitions.
 \* ============================================================================================================================================================= */
+/* MQTT client instance (one per broker connection): all functions of the module work on the instance they are given. */
+typedef struct struct_mqtt mqtt_ctx_t;
+
+/* Position of a sub-topic or sub-payload inside the main topic or payload string (the original string is left intact, so it is not null-terminated). */
+struct mqtt_span
+{
+  UINT16 Offset;  // offset of the first character from the beginning of the main string.
+  UINT16 Length;  // number of characters.
+};
+
+/* Tokenized view of the current message, built once per message and shared by handlers, display functions and logging. */
+struct mqtt_view
+{
+  UINT8            Flags;                         // MQTT_VIEW_TOPIC and / or MQTT_VIEW_PAYLOAD when the corresponding span table is valid, MQTT_VIEW_OVERFLOW.
+  UINT8            TopicCount;                    // number of valid entries in SubTopic[].
+  UINT8            PayloadCount;                  // number of valid entries in SubPayload[].
+  UINT16           TopicLength;                   // length of the main topic string.
+  UINT16           PayloadLength;                 // length of the main payload string.
+  const UCHAR     *Topic;                         // main topic string.
+  const UCHAR     *Payload;                       // main payload string.
+  struct mqtt_span SubTopic[MAX_SUB_TOPICS];
+  struct mqtt_span SubPayload[MAX_SUB_PAYLOADS];
+};
+
+/* Handler called for an incoming message whose topic matches a registered topic filter. */
+typedef void (*mqtt_handler_t)(const struct mqtt_view *View, void *Context);
+
+/* One topic level of the topic router. Children having a level text are found through the hash table of the router, wildcard children are linked directly. */
+struct mqtt_route_node
+{
+  UINT16         TextOffset;   // offset of the level text in Router.Text[].
+  UINT8          TextLength;   // length of the level text.
+  UINT8          Parent;       // node of the previous level.
+  UINT8          PlusChild;    // "+" node of the next level or MQTT_ROUTE_NONE.
+  UINT8          HashChild;    // "#" node of the next level or MQTT_ROUTE_NONE.
+  mqtt_handler_t Handler;      // handler of the filter ending at this level, or NULL.
+  void          *Context;      // argument given to the handler.
+};
+
+/* Level-by-level trie of the registered topic filters (node 0 is the root and has no text). */
+struct mqtt_router
+{
+  UINT8                  NodeCount;
+  UINT16                 TextLength;
+  UCHAR                  Text[MAX_ROUTE_TEXT];
+  UINT8                  Bucket[MAX_ROUTE_BUCKETS];  // hash table of (parent node, level text) -> child node, open addressing.
+  struct mqtt_route_node Node[MAX_ROUTE_NODES];
+};
+
+struct mqtt_request;
+
+/* Completion callback of an outbound request (Result is ERR_OK or the lwIP error code). The request may only be used during the callback. */
+typedef void (*mqtt_complete_t)(const struct mqtt_request *Request, err_t Result);
+
+/* One topic filter of a subscribe / unsubscribe list, with its own QoS and result. */
+struct mqtt_subscription
+{
+  const UCHAR *Filter;  // topic filter (copied when it is given to the request queue, must stay valid until the completion callback).
+  UINT8        QoS;     // requested QoS (ignored for unsubscribe).
+  err_t        Result;  // ERR_INPROGRESS until the broker answers, then ERR_OK or the lwIP error code (ERR_ABRT when refused in SUBACK).
+};
+
+struct mqtt_subscribe_batch;
+
+/* Completion callback of a subscribe / unsubscribe list, called once all filters of the list have been answered. */
+typedef void (*mqtt_batch_complete_t)(struct mqtt_subscribe_batch *Batch);
+
+/* Subscribe / unsubscribe list in progress. Owned by the caller, it must stay valid until its completion callback. */
+struct mqtt_subscribe_batch
+{
+  struct mqtt_subscription    *List;       // filters of the list and their result.
+  UINT8                        Count;      // number of filters in the list.
+  UINT8                        Next;       // next filter to give to the request queue (filters are fed as request slots free up).
+  UINT8                        Remaining;  // number of filters not answered yet.
+  UINT8                        Failed;     // number of filters answered with an error.
+  UINT8                        Operation;  // MQTT_OP_SUBSCRIBE or MQTT_OP_UNSUBSCRIBE.
+  mqtt_batch_complete_t        Complete;   // optional completion callback.
+  void                        *Context;    // for use by the caller.
+  mqtt_ctx_t                  *Ctx;        // instance the list has been queued on.
+  struct mqtt_subscribe_batch *NextBatch;  // next list having filters not given to the request queue yet.
+};
+
+/* Outbound request descriptor. Topic and payload are copied (into the arena of the instance, as large as its receive buffers), so the caller's
+   buffers may be reused as soon as the request has been queued. The descriptor itself is the argument given to lwIP, so each answer of the broker
+   is matched to its own request. */
+struct mqtt_request
+{
+  mqtt_ctx_t     *Ctx;                                  // instance owning the request (see mqtt_ctx_init()).
+  UINT8           State;                                // MQTT_REQUEST_FREE, MQTT_REQUEST_QUEUED, MQTT_REQUEST_IN_FLIGHT or MQTT_REQUEST_COMPLETING.
+  UINT8           Operation;                            // MQTT_OP_PUBLISH, MQTT_OP_SUBSCRIBE or MQTT_OP_UNSUBSCRIBE.
+  UINT8           QoS;
+  UINT8           Retain;
+  UINT16          PayloadLength;
+  UINT16          Id;                                   // request number, different for each queued request.
+  UINT64          IssueTime;                            // time_us_64() value when the request was given to lwIP.
+  mqtt_complete_t Complete;                             // optional completion callback.
+  void           *Context;                              // for use by the caller (available to the completion callback).
+  struct mqtt_subscribe_batch *Batch;                   // subscribe / unsubscribe list this request belongs to (NULL for a publish).
+  UINT8           BatchIndex;                           // index of the filter in the list.
+  UCHAR          *Topic;                                // TopicSize bytes of the arena (see mqtt_ctx_init()).
+  UCHAR          *Payload;                              // PayloadSize bytes of the arena.
+};
+
+/* Outbound request queue: requests are given to lwIP in FIFO order, up to MQTT_REQ_MAX_IN_FLIGHT at a time. */
+struct mqtt_queue
+{
+  UINT8               Head;                        // index in Order[] of the oldest queued request.
+  UINT8               Count;                       // number of requests waiting in Order[].
+  UINT8               InFlight;                    // number of requests given to lwIP and not completed yet.
+  UINT8               HighWater;                   // highest number of requests waiting or in flight at the same time.
+  UINT16              NextId;                      // number given to the next queued request.
+  volatile UINT8      FlagPump;                    // FLAG_ON when the core of lwIP has been asked to pump (see mqtt_queue_pump()).
+  UINT8               Order[MAX_MQTT_REQUESTS];    // FIFO of the indexes of the queued requests.
+  UINT32              TotalSubmitted;              // number of requests given to lwIP.
+  UINT32              TotalCompleted;              // number of requests completed without error.
+  UINT32              TotalFailed;                 // number of requests completed with an error.
+  critical_section_t  Lock;                        // lwIP callbacks may run in interrupt context.
+  struct mqtt_subscribe_batch *Feeding;            // subscribe / unsubscribe lists having filters not queued yet, oldest first (see mqtt_queue_feed()).
+  struct mqtt_request Request[MAX_MQTT_REQUESTS];
+};
+
+/* Reconnection policy and its measurements (see mqtt_check_connection() and mqtt_set_reconnect_policy()). */
+struct mqtt_reconnect
+{
+  UINT32 InitialDelay;         // delay between the first and the second attempts (msec, 0: MQTT_RECONNECT_INITIAL).
+  UINT32 MaxDelay;             // the delay doubles after each attempt, up to this value (msec, 0: MQTT_RECONNECT_MAX).
+  UINT8  Jitter;               // percentage of each delay that is randomized (0 to 100).
+  UINT32 Seed;                 // state of the pseudo-random generator, seeded from the unique board ID.
+  UINT16 Attempts;             // attempts since the beginning of the current breakdown.
+  UINT32 TotalAttempts;        // attempts since power up.
+  UINT64 OutageStart;          // time_us_64() value when the current breakdown has been detected.
+  UINT64 NextAttempt;          // time_us_64() value before which no new attempt is made.
+  UINT32 Reconnections;        // number of breakdowns ended by a successful reconnection.
+  UINT16 LastAttempts;         // attempts needed by the last reconnection.
+  UINT64 LastTimeToReconnect;  // duration of the last breakdown (usec).
+  UINT64 MaxTimeToReconnect;   // longest breakdown (usec).
+  UINT64 TotalTimeToReconnect; // cumulative duration of all breakdowns (usec).
+};
+
+/* Persistent session and subscription replay cache (see mqtt_set_persistent_session() and mqtt_session_subscribe()). */
+struct mqtt_session
+{
+  UINT8                        FlagPersistent;  // FLAG_ON: connect with clean session Off and keep the session on the broker (opt-in).
+  UINT8                        FlagPresent;     // broker reported "session present" in the last CONNACK.
+  UINT8                        FlagSubscribed;  // all filters of the replay cache have been accepted in the current broker session.
+  UINT8                        FlagReplay;      // new broker session while the replay cache list was in progress: subscribe it again when done.
+  struct mqtt_subscribe_batch *Batch;           // replay cache: topic filters of the device, subscribed again after each new session.
+  struct mqtt_subscription    *List;
+  UINT8                        Count;
+  mqtt_batch_complete_t        Complete;
+  void                        *Context;
+  UINT32                       Resumed;         // connections where the broker still had the session (no SUBSCRIBE sent).
+  UINT32                       Replayed;        // connections where the filters of the replay cache have been subscribed again.
+};
+
+/* One MQTT connection breakdown. Time stamps are time_us_64() values: they are converted to date and time only when displayed. */
+struct mqtt_breakdown
+{
+  UINT64 Start;  // breakdown has been detected.
+  UINT64 End;    // connection has been accepted again (0: breakdown in progress).
+};
+
+/* Breakdown history: ring of the last MAX_MQTT_BREAKDOWN_HISTORY breakdowns, the oldest one is overwritten by a new one. */
+struct mqtt_breakdown_history
+{
+  UINT16                Head;   // entry used by the next breakdown.
+  UINT16                Count;  // number of valid entries.
+  struct mqtt_breakdown Entry[MAX_MQTT_BREAKDOWN_HISTORY];
+};
+
+/* Connection availability statistics, updated when a breakdown starts and when the connection is accepted again (see mqtt_get_availability()).
+   Downtime of the rolling window is kept per bucket: buckets that get out of the window are dropped one by one as time goes on. */
+struct mqtt_availability
+{
+  UINT64 FirstUp;                                   // time_us_64() value of the first accepted connection (0: statistics not started yet).
+  UINT64 DownStart;                                 // time_us_64() value when the breakdown in progress started (0: connection is up).
+  UINT64 TotalDowntime;                             // downtime of all completed breakdowns (usec).
+  UINT64 LongestOutage;                             // longest completed breakdown (usec).
+  UINT32 Failures;                                  // breakdowns since the first connection.
+  UINT32 Recoveries;                                // breakdowns ended by a reconnection.
+  UINT32 BucketNumber;                              // number (since FirstUp) of the bucket at BucketHead.
+  UINT16 BucketHead;                                // index in Downtime[] of the most recent bucket.
+  UINT32 WindowDowntime;                            // sum of Downtime[] (msec).
+  UINT32 Downtime[MQTT_AVAILABILITY_BUCKETS];       // downtime of each bucket of the rolling window (msec).
+};
+
+/* Connection availability figures returned by mqtt_get_availability(). Breakdown in progress is included. */
+struct mqtt_availability_report
+{
+  UINT64 Uptime;              // since the first connection (usec).
+  UINT64 Downtime;            // since the first connection (usec).
+  UINT64 MTBF;                // mean time between failures: uptime / failures (usec, 0 if there was no failure).
+  UINT64 MTTR;                // mean time to recover: downtime of completed breakdowns / recoveries (usec, 0 if there was no recovery).
+  UINT64 LongestOutage;       // (usec).
+  UINT32 Failures;            // breakdowns since the first connection.
+  UINT32 WindowLength;        // part of the rolling window covered so far (sec, up to MQTT_AVAILABILITY_BUCKETS * MQTT_AVAILABILITY_BUCKET).
+  UINT16 Availability;        // since the first connection (hundredths of percent).
+  UINT16 WindowAvailability;  // over the rolling window (hundredths of percent).
+};
+
+/* Publish-to-ack latency histogram of one QoS level (see mqtt_get_latency()). Bucket widths grow with latency: relative precision is the same
+   from a few usec to a few minutes, in fixed memory. */
+struct mqtt_latency
+{
+  UINT32 Count;                           // number of publish requests completed without error.
+  UINT32 Max;                             // highest latency (usec).
+  UINT64 Total;                           // sum of all latencies (usec).
+  UINT32 Bucket[MQTT_LATENCY_BUCKETS];    // number of latencies in each bucket (see mqtt_latency_record()).
+};
+
+/* Time of each boot phase, recorded only the first time it is reached. */
+struct mqtt_boot
+{
+  UINT8  FlagReached[MQTT_BOOT_PHASES];
+  UINT64 Stamp[MQTT_BOOT_PHASES];  // time_us_64() value (usec since reset).
+};
+
+/* Incoming message handed off to the MQTT engine of core 1 (see mqtt_engine_push()). Topic and payload are null-terminated. */
+struct mqtt_engine_slot
+{
+  UINT16 TopicLength;
+  UINT16 PayloadLength;
+  UCHAR *Topic;          // TopicSize bytes of the arena given to mqtt_ctx_init().
+  UCHAR *Payload;        // PayloadSize bytes of the arena given to mqtt_ctx_init().
+};
+
+/* MQTT engine of an instance: lock-free single-producer / single-consumer ring of incoming messages. Core 0 (lwIP callbacks) only writes Head, core 1 only
+   writes Tail, so no lock is needed. Core 1 is interrupted through the SIO FIFO when a message is handed off (see mqtt_engine_start()). */
+struct mqtt_engine
+{
+  volatile UINT8          FlagOn;                       // incoming messages are processed by the engine (set by core 1, see mqtt_engine_start()).
+  UINT8                   Core;                         // core processing the messages (mqtt_get_view() returns the engine view on this core).
+  void                  (*mqtt_process)(mqtt_ctx_t *Ctx);  // called for each message on core 1 (mqtt_dispatch() if NULL).
+  volatile UINT32         Head;                         // number of messages handed off so far (written by core 0 only).
+  volatile UINT32         Tail;                         // number of messages processed so far (written by core 1 only).
+  UINT32                  Dropped;                      // messages dropped because all slots were in use (written by core 0 only).
+  UINT32                  HighWater;                    // highest number of messages waiting (written by core 0 only).
+  struct mqtt_view        View;                         // sub-topics and sub-payloads of the message being processed by core 1.
+  UINT8                   SlotCount;                    // number of slots given to mqtt_ctx_init() (power of 2, 0: no engine).
+  struct mqtt_engine_slot Slot[MAX_MQTT_ENGINE_SLOTS];
+};
+
+/* Seqlock of a double-buffered snapshot. The writer fills the buffer readers are not using, then makes it the current one: it never waits for them.
+   A reader copies the current buffer and copies it again if its sequence has changed meanwhile (see mqtt_seqlock_read_begin()). */
+struct mqtt_seqlock
+{
+  volatile UINT32 Sequence[2];  // one per buffer: incremented before and after the buffer is written (odd while it is being written).
+  volatile UINT8  Current;      // buffer holding the most recent snapshot.
+  UINT8           Next;         // buffer being written (writer only).
+  UINT32          IrqState;     // interrupts of the writer core, disabled while the buffer is written (writer only).
+  UINT32          Retries;      // copies started again because the buffer changed during the copy (readers only).
+};
+
+/* Connection state and statistics, as seen by another core (see mqtt_snapshot_connection()). */
+struct mqtt_connection_snapshot
+{
+  UINT64                        Stamp;           // time_us_64() value when the snapshot was taken.
+  UINT8                         FlagConnected;   // MQTT client is connected to the broker.
+  UINT8                         FlagPersistent;  // copy of the Session of the instance.
+  UINT8                         FlagPresent;
+  UINT32                        Resumed;
+  UINT32                        Replayed;
+  UINT32                        TotalErrors;
+  ip_addr_t                     BrokerAddress;
+  ip_addr_t                     PicoIPAddress;
+  struct mqtt_reconnect         Reconnect;
+  struct mqtt_breakdown_history Breakdown;
+  struct mqtt_availability      Availability;
+};
+
+/* Request in flight, as seen by another core. */
+struct mqtt_request_snapshot
+{
+  UINT16 Id;
+  UINT8  Operation;
+  UINT64 IssueTime;
+  UCHAR  Topic[MAX_REQUEST_TOPIC_LENGTH];
+};
+
+/* Outbound request queue, as seen by another core (see mqtt_snapshot_statistics()). */
+struct mqtt_statistics_snapshot
+{
+  UINT8                        Count;           // copy of the Queue of the instance.
+  UINT8                        InFlight;
+  UINT8                        HighWater;
+  UINT32                       TotalSubmitted;
+  UINT32                       TotalCompleted;
+  UINT32                       TotalFailed;
+  UINT8                        RequestCount;    // number of valid entries in Request[].
+  struct mqtt_request_snapshot Request[MAX_MQTT_REQUESTS];
+};
+
+/* Last complete incoming message, as seen by another core (see mqtt_snapshot_message()). Topic and payload are null-terminated. */
+struct mqtt_message_snapshot
+{
+  UINT32           Number;                       // number of messages received so far (0: no message yet).
+  UINT16           TopicLength;
+  UINT16           PayloadLength;
+  UCHAR           *Topic;                        // TopicSize bytes (arena of the instance, or buffer of the caller of mqtt_snapshot_message()).
+  UCHAR           *Payload;                      // PayloadSize bytes (arena of the instance, or buffer of the caller of mqtt_snapshot_message()).
+  struct mqtt_view View;                         // sub-topics and sub-payloads of the copy (built by the reader).
+};
+
+/* Snapshots of an instance for the other core. They are written by the network core only (the statistics also by a core holding the queue lock),
+   at the time its own state changes, so readers never see buffers being overwritten by lwIP callbacks and never make the writer wait. */
+struct mqtt_snapshot
+{
+  UINT8                           Core;             // network core (lwIP callbacks), which reads the instance directly.
+  UINT32                          MessageNumber;    // number of messages received so far (writer only).
+  volatile INT8                   Status;           // connection status returned by mqtt_get_connection_status() on the other core.
+  volatile UINT8                  Wanted;           // parts read at least once by the other core: the others are not copied (set by readers only).
+  UINT8                           Served;           // parts of Wanted copied since they have been wanted (network core only, see mqtt_queue_pump()).
+  struct mqtt_seqlock             ConnectionLock;
+  struct mqtt_connection_snapshot Connection[2];
+  struct mqtt_seqlock             StatisticsLock;
+  struct mqtt_statistics_snapshot Statistics[2];
+  struct mqtt_seqlock             MessageLock;
+  struct mqtt_message_snapshot    Message[2];
+  struct mqtt_message_snapshot    Reader;           // last message copied by mqtt_get_view() on the other core.
+  UINT8                           ReaderHold;       // Reader is kept while held by mqtt_hold_view() on the other core (nesting depth).
+};
+
+/* Latency figures of one QoS level returned by mqtt_get_latency(). Percentiles are the upper limit of their bucket (within 25 %). */
+struct mqtt_latency_report
+{
+  UINT32 Count;    // number of publish requests completed without error.
+  UINT32 Average;  // (usec).
+  UINT32 P50;      // median (usec).
+  UINT32 P99;      // 99th percentile (usec).
+  UINT32 Max;      // (usec).
+};
+
 struct struct_mqtt
 {
   UINT8          FlagHealth;
-  UINT8          FlagSubscribe;       // if FLAG_ON, means that we want to subscribe, FLAG_OFF means that we want to unsubscribe.
+  UINT8          FlagSubscribe;       // obsolete: only used by mqtt_sub_request_cb() for requests not sent through the request queue (FLAG_ON: subscribe, FLAG_OFF: unsubscribe).
   UINT8          FlagStartupOver;     // indicate that MQTT connection has already been established with MQTT broker during startup sequence.
+  UINT8          WipeMode;            // MQTT_WIPE_TRACKED or MQTT_WIPE_FULL (see mqtt_wipe_packet()).
   UINT32         TotalErrors;
   UCHAR          PicoUniqueId[40];    // Pico Unique ID ("serial number") used for MQTT client ID.
   UCHAR          PicoIdentifier[40];  // "human string" to describe / identify the PicoW client device from its Unique Number.
   UCHAR          Password[40];        // MQTT password.
   ip_addr_t      BrokerAddress;       // IP address of MQTT broker.
   ip_addr_t      PicoIPAddress;       // IP address of PicoW.
-  UCHAR          Topic[MAX_TOPIC_LENGTH];
-  UCHAR          Payload[MAX_PAYLOAD_LENGTH];
-  UCHAR          *SubTopic[MAX_SUB_TOPICS];
-  UCHAR          *SubPayload[MAX_SUB_PAYLOADS];
-  UINT32         PayloadLength;
-  void           (*mqtt_status)(UINT16 Status);  // in case original program requires to take an action when a callback executes
+  UCHAR         *Topic;               // receive buffers given to mqtt_ctx_init().
+  UINT16         TopicSize;           // size of Topic[] (up to MAX_TOPIC_LENGTH).
+  UCHAR         *Payload;
+  UINT16         PayloadSize;         // size of Payload[] (up to MAX_PAYLOAD_LENGTH).
+  UINT32         PayloadLength;       // number of payload bytes received so far for the current message.
+  UINT32         PayloadTotalLength;  // total payload length announced by the broker for the current message.
+  UINT8          FlagPayloadStream;   // FLAG_ON when the current payload is too large for Payload[] and is given to mqtt_payload_stream() chunk by chunk.
+  UINT8          FlagPayloadOverflow; // FLAG_ON when the current payload is too large for Payload[] and there is no streaming handler (message is dropped).
+  struct mqtt_view View;              // sub-topics and sub-payloads of the current message (see mqtt_get_view()).
+  struct mqtt_router Router;          // registered topic filters and their handlers (see mqtt_register_handler()).
+  struct mqtt_queue  Queue;           // outbound requests (see mqtt_publish_async()).
+  struct mqtt_reconnect Reconnect;    // reconnection policy (exponential backoff with jitter) and measurements.
+  struct mqtt_session   Session;      // persistent session and subscription replay cache.
+  void           (*mqtt_status)(mqtt_ctx_t *Ctx, UINT16 Status);  // in case original program requires to take an action when a callback executes
+  void           (*mqtt_payload_stream)(mqtt_ctx_t *Ctx, const UINT8 *Chunk, UINT16 ChunkLength, UINT32 Offset, UINT8 Flags);  // optional handler for payloads larger than Payload[].
   mqtt_client_t *MqttClientInstance;
   struct mqtt_connect_client_info_t MqttClientInfo;
-  datetime_t BreakdownStart[MAX_MQTT_BREAKDOWN_HISTORY];  // time stamp of the last MQTT connection breakdowns start time.
-  datetime_t BreakdownEnd[MAX_MQTT_BREAKDOWN_HISTORY];    // time stamp of the last MQTT connection breakdowns ened time.
+  struct mqtt_breakdown_history Breakdown;  // last MQTT connection breakdowns (see mqtt_breakdown_start() and mqtt_breakdown_end()).
+  struct mqtt_availability      Availability;  // connection availability statistics (see mqtt_get_availability()).
+  struct mqtt_latency           Latency[3];    // publish-to-ack latency histogram of each QoS level (see mqtt_get_latency()).
+  struct mqtt_boot              Boot;          // time of each boot phase (see mqtt_boot_mark()).
+  struct mqtt_engine            Engine;        // incoming messages processed by core 1 (see mqtt_engine_start()).
+  struct mqtt_snapshot          Snapshot;      // consistent copies for the other core (see mqtt_snapshot_update()).
 };
 
 typedef struct mqtt_client_s mqtt_client_t;
@@ -86,44 +507,165 @@ typedef struct mqtt_client_s mqtt_client_t;
 /* ============================================================================================================================================================= *\
                                                                      Function prototypes.
 \* ============================================================================================================================================================= */
+/* Record the time of a boot phase (only the first time it is reached, may be called from lwIP callbacks). */
+void mqtt_boot_mark(mqtt_ctx_t *Ctx, UINT8 Phase);
+
+/* Return the time of a boot phase (usec since reset), or -1 if it has not been reached yet. */
+INT64 mqtt_boot_time(mqtt_ctx_t *Ctx, UINT8 Phase);
+
+/* Return the duration of a breakdown (usec, <Age> 0 is the most recent one, a breakdown in progress lasts until now), or 0 if there is no such breakdown. */
+UINT64 mqtt_breakdown_duration(mqtt_ctx_t *Ctx, UINT16 Age);
+
 /* Enter time of end of MQTT breakdown. */
-void mqtt_breakdown_end(void);
+void mqtt_breakdown_end(mqtt_ctx_t *Ctx);
 
 /* Enter time of beginning of MQTT breakdown. */
-void mqtt_breakdown_start(void);
+void mqtt_breakdown_start(mqtt_ctx_t *Ctx);
 
-/* Check MQTT connection health. */
-INT16 mqtt_check_connection(UINT8 FlagWiFiHealth);
+/* Check MQTT connection health and count a reconnection attempt when one is allowed (network core only). Return 2 while the next attempt is not allowed yet. */
+INT16 mqtt_check_connection(mqtt_ctx_t *Ctx, UINT8 FlagWiFiHealth);
 
-/* Callback to receive the result for a MQTT connection request. */
+/* Callback to receive the result for a MQTT connection request (ExtraArgument must be the instance). */
 void mqtt_connection_cb(mqtt_client_t *LocalClient, void *ExtraArgument, mqtt_connection_status_t Status);
 
+/* Initialize an instance with its receive buffers (up to MAX_TOPIC_LENGTH and MAX_PAYLOAD_LENGTH) and its arena of MQTT_ARENA_SIZE() bytes for <SlotCount>
+   engine slots, before any other use. Return 0 if OK, -1 if a buffer or the slot count is invalid, -2 if there are already MAX_MQTT_INSTANCES instances. */
+INT16 mqtt_ctx_init(mqtt_ctx_t *Ctx, UCHAR *Topic, UINT16 TopicSize, UCHAR *Payload, UINT16 PayloadSize, UCHAR *Arena, UINT32 ArenaSize, UINT8 SlotCount);
+
+/* Display the time of each boot phase. */
+void mqtt_display_boot(mqtt_ctx_t *Ctx);
+
 /* Display MQTT client information. */
-void mqtt_display_client(void);
+void mqtt_display_client(mqtt_ctx_t *Ctx);
+
+/* Display publish-to-ack latency of each QoS level. */
+void mqtt_display_latency(mqtt_ctx_t *Ctx);
 
 /* Display all current MQTT sub-payloads. */
-void mqtt_display_payload(void);
+void mqtt_display_payload(mqtt_ctx_t *Ctx);
 
 /* Display all current MQTT sub-topics. */
-void mqtt_display_topic(void);
+void mqtt_display_topic(mqtt_ctx_t *Ctx);
+
+/* Call the handlers of all registered topic filters matching the topic of the current message. Return the number of handlers called. */
+UINT8 mqtt_dispatch(mqtt_ctx_t *Ctx);
 
-/* Callback to receive the response of a publish request. */
+/* Process the messages handed off to the MQTT engine (core 1 only, called by the SIO FIFO interrupt). Return the number of messages processed. */
+UINT16 mqtt_engine_poll(mqtt_ctx_t *Ctx);
+
+/* Hand the current message off to the MQTT engine of core 1 (core 0 only, from the incoming data callback). Return 0 if OK, -1 if all slots are in use. */
+INT16 mqtt_engine_push(mqtt_ctx_t *Ctx);
+
+/* Start the MQTT engine of an instance on the calling core (must be core 1): its incoming messages are processed there by <Process>. Return 0 if OK, -1 if called on core 0. */
+INT16 mqtt_engine_start(mqtt_ctx_t *Ctx, void (*Process)(mqtt_ctx_t *Ctx));
+
+/* Return the connection availability figures (uptime, downtime, MTBF, MTTR, longest outage, availability overall and over the rolling window). */
+void mqtt_get_availability(mqtt_ctx_t *Ctx, struct mqtt_availability_report *Report);
+
+/* Return the connection status for display from any core, without changing it: -1 if instance is not valid, 0 if connected, 1 if disconnected. */
+INT16 mqtt_get_connection_status(mqtt_ctx_t *Ctx);
+
+/* Return publish-to-ack latency figures (count, average, p50, p99, max) of a QoS level. Return 0 if OK, -1 if QoS is invalid. */
+INT16 mqtt_get_latency(mqtt_ctx_t *Ctx, UINT8 QoS, struct mqtt_latency_report *Report);
+
+/* Return the tokenized view of the current message (topic and payload are tokenized only once per message). */
+const struct mqtt_view *mqtt_get_view(mqtt_ctx_t *Ctx);
+
+/* Hold (FLAG_ON) or release (FLAG_OFF) the copy of the last message returned by mqtt_get_view() on the other core (holds may be nested). */
+void mqtt_hold_view(mqtt_ctx_t *Ctx, UINT8 FlagHold);
+
+/* Callback to receive the response of a publish request (ExtraArgument must be the instance). */
 void mqtt_incoming_publish_cb(void *ExtraArgument, const char *Topic, UINT32 PayloadLength);
 
 /* Initialize MQTT session. */
-INT16 mqtt_init(void);
+INT16 mqtt_init(mqtt_ctx_t *Ctx);
 
-/* Parse topic or payload into its components: sub-topics and sub-payloads (separator must be a slash </> in both cases). */
-void mqtt_parse_item(UINT8 ParseUnit);
+/* Parse topic or payload into its components: sub-topics and sub-payloads (separator must be a slash </> in both cases, network core only). */
+void mqtt_parse_item(mqtt_ctx_t *Ctx, UINT8 ParseUnit);
 
-/* Callback to receive the response of a publish request. */
+/* Register a handler for a topic filter ("+" and "#" wildcards are supported). Return 0 if OK, -1 if filter is invalid, -2 if router is full. */
+INT16 mqtt_register_handler(mqtt_ctx_t *Ctx, const UCHAR *Filter, mqtt_handler_t Handler, void *Context);
+
+/* Split a string in slash-separated spans without modifying it. Return the number of spans found (*FlagOverflow: more items than MaxSpans). */
+UINT8 mqtt_tokenize(const UCHAR *Data, UINT16 Length, struct mqtt_span *Span, UINT8 MaxSpans, UINT8 *FlagOverflow);
+
+/* Callback to receive the response of a publish request (ExtraArgument is the instance or a request of its queue). */
 void mqtt_pub_request_cb(void *ExtraArgument, err_t Result);
 
-/* Callback to receive the response to a subscribe request. */
+/* Queue a publish request, sent as soon as lwIP has a free in-flight slot. Return 0 if OK, -1 if topic or payload is too long, -2 if queue is full. */
+INT16 mqtt_publish_async(mqtt_ctx_t *Ctx, const UCHAR *Topic, const void *Payload, UINT16 PayloadLength, UINT8 QoS, UINT8 Retain, mqtt_complete_t Complete, void *Context);
+
+/* Complete all requests in flight with the given error (lwIP drops them without calling their callback when the connection is lost). */
+void mqtt_queue_abort(mqtt_ctx_t *Ctx, err_t Result);
+
+/* Return the number of outbound requests waiting or in flight (and optionally the number in flight). */
+UINT8 mqtt_queue_depth(mqtt_ctx_t *Ctx, UINT8 *InFlight);
+
+/* Give the queued requests to lwIP, as long as it has free in-flight slots (or ask the core of lwIP to do it, see MQTT_PUMP_REQUEST). */
+void mqtt_queue_pump(mqtt_ctx_t *Ctx);
+
+/* Return the request descriptor given as lwIP callback argument, or NULL if the argument is not a request of the queue of an instance. */
+struct mqtt_request *mqtt_queue_request(void *ExtraArgument);
+
+/* Callback to receive the response of a queued request. */
+void mqtt_queue_request_cb(void *ExtraArgument, err_t Result);
+
+/* Return the number of msec before the next reconnection attempt is allowed (0 if it may be done now). */
+UINT32 mqtt_reconnect_delay(mqtt_ctx_t *Ctx);
+
+/* Append one incoming payload chunk to the current message. Return FLAG_ON when the last chunk has been received and the message may be processed. */
+UINT8 mqtt_reassemble_payload(mqtt_ctx_t *Ctx, const UINT8 *Chunk, UINT16 ChunkLength, UINT8 Flags);
+
+/* Clear the publish-to-ack latency histograms of all QoS levels. */
+void mqtt_reset_latency(mqtt_ctx_t *Ctx);
+
+/* Call right after mqtt_client_connect(): in persistent session mode, turn Off the clean session flag of the CONNECT packet. Return 0 if OK, -1 if not found. */
+INT16 mqtt_session_request(mqtt_ctx_t *Ctx);
+
+/* Set the topic filters of the device (replay cache). They are subscribed after each connection, unless the broker reports that it still has the session.
+   Return 0 if OK, or the same codes as mqtt_subscribe_list() when they must be subscribed right away. */
+INT16 mqtt_session_subscribe(mqtt_ctx_t *Ctx, struct mqtt_subscribe_batch *Batch, struct mqtt_subscription *List, UINT8 Count, mqtt_batch_complete_t Complete, void *Context);
+
+/* Turn persistent session mode On or Off (default Off). Takes effect on next connection. */
+void mqtt_set_persistent_session(mqtt_ctx_t *Ctx, UINT8 FlagPersistent);
+
+/* Set the reconnection policy: first attempt immediate, then delays starting at InitialDelay and doubling up to MaxDelay, Jitter percent randomized. */
+void mqtt_set_reconnect_policy(mqtt_ctx_t *Ctx, UINT32 InitialDelay, UINT32 MaxDelay, UINT8 Jitter);
+
+/* Copy the connection state and statistics of the network core (consistent copy, may be called from any core). */
+void mqtt_snapshot_connection(mqtt_ctx_t *Ctx, struct mqtt_connection_snapshot *Snapshot);
+
+/* Copy the last complete incoming message into Snapshot->Topic and Snapshot->Payload (TopicSize and PayloadSize bytes) and tokenize the copy (consistent
+   copy, may be called from any core). */
+void mqtt_snapshot_message(mqtt_ctx_t *Ctx, struct mqtt_message_snapshot *Snapshot);
+
+/* Copy the outbound request queue counters and the requests in flight (consistent copy, may be called from any core). */
+void mqtt_snapshot_statistics(mqtt_ctx_t *Ctx, struct mqtt_statistics_snapshot *Snapshot);
+
+/* Callback to receive the response to a subscribe request (ExtraArgument is the instance or a request of its queue). */
 void mqtt_sub_request_cb(void *ExtraArgument, err_t Result);
 
+/* Queue a list of topic filters to subscribe to (any length, fed to the request queue as slots free up). They are pipelined (up to
+   MQTT_REQ_MAX_IN_FLIGHT at a time) and each gets its own result. Return 0 if OK, -1 if a filter is invalid or too long, -3 if the batch is still in progress. */
+INT16 mqtt_subscribe_list(mqtt_ctx_t *Ctx, struct mqtt_subscribe_batch *Batch, struct mqtt_subscription *List, UINT8 Count, mqtt_batch_complete_t Complete, void *Context);
+
+/* Queue a list of topic filters to unsubscribe from (same return codes as mqtt_subscribe_list()). */
+INT16 mqtt_unsubscribe_list(mqtt_ctx_t *Ctx, struct mqtt_subscribe_batch *Batch, struct mqtt_subscription *List, UINT8 Count, mqtt_batch_complete_t Complete, void *Context);
+
+/* Return a pointer to a sub-payload of the view (not null-terminated) and its length, or NULL if there is no such sub-payload. */
+const UCHAR *mqtt_view_sub_payload(const struct mqtt_view *View, UINT8 Index, UINT16 *Length);
+
+/* Return a pointer to a sub-topic of the view (not null-terminated) and its length, or NULL if there is no such sub-topic. */
+const UCHAR *mqtt_view_sub_topic(const struct mqtt_view *View, UINT8 Index, UINT16 *Length);
+
+/* Return the decimal value of a sub-payload of the view (0 if there is no such sub-payload). */
+INT32 mqtt_view_payload_long(const struct mqtt_view *View, UINT8 Index);
+
+/* Return TRUE if a sub-topic of the view is equal to the given string. */
+UINT8 mqtt_view_topic_is(const struct mqtt_view *View, UINT8 Index, const UCHAR *String);
+
 /* Wipe MQTT packet in preparation for next reception. */
-void mqtt_wipe_packet(void);
+void mqtt_wipe_packet(mqtt_ctx_t *Ctx);
 
 /* Send a string to external monitor through Pico UART (or USB CDC). */
 extern void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...);
@@ -0,0 +1,311 @@
+/* ============================================================================================================================================================= *\
+   Pico-MQTT-Router.hpp
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   Revision 16-OCT-2026
+   Langage: C++17
+
+   Optional header-only C++17 facade over Pico-MQTT-Module: compile-time topic routing table.
+
+   The topics of the table are hashed at compile time into a perfect-hash table (no collision, built with "hash and displace"), so an incoming topic
+   is matched with one hash and one compare. When the table is declared "constexpr" at namespace scope (or "static constexpr" in a function), it is
+   constant-initialized and placed in .rodata, which the Pico linker script keeps in XIP flash: it uses no RAM at all.
+
+   Example:
+     static void handler_time_set(const struct mqtt_view *View, void *Context);
+     static void handler_volume(const struct mqtt_view *View, void *Context);
+
+     // Key on the second topic level (ASTL Smart Home convention: <Destination>/<Command>/<Source>).
+     constexpr pico_mqtt::Route CommandRoute[] =
+     {
+       {"TimeSet", handler_time_set},
+       {"Volume",  handler_volume},
+     };
+     constexpr auto CommandTable = pico_mqtt::make_route_table<1>(CommandRoute);
+
+     // in the incoming data callback of the MQTT instance:
+     CommandTable.dispatch(Ctx);
+
+   NOTES: - Only exact topics (or exact topic levels) may be used: for "+" and "#" wildcards, use mqtt_register_handler() of Pico-MQTT-Module.
+          - A duplicate topic, or a table for which no perfect hash may be found, stops the compilation (the table is not a constant expression).
+          - On a Linux host, position independent executables put the table in .data.rel.ro instead (read-only after relocation).
+\* ============================================================================================================================================================= */
+
+#ifndef __PICO_MQTT_ROUTER_HPP
+#define __PICO_MQTT_ROUTER_HPP
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                      Include files.
+\* ============================================================================================================================================================= */
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+extern "C"
+{
+#include "baseline.h"
+#include "Pico-MQTT-Module.h"
+}
+
+
+
+namespace pico_mqtt
+{
+/* $PAGE */
+/* $TITLE=Definitions. */
+/* ============================================================================================================================================================= *\
+                                                                        Definitions.
+\* ============================================================================================================================================================= */
+/* Maximum number of displacements tried at compile time for each bucket of the perfect hash. */
+constexpr UINT32 ROUTE_MAX_SEED = 4096;
+
+/* Key used to match incoming topics. */
+constexpr int ROUTE_KEY_TOPIC = -1;  // the whole topic (any other value is the index of the topic level used as key).
+
+
+/* One entry of a compile-time routing table. */
+struct Route
+{
+  std::string_view Topic;              // topic (or topic level) literal.
+  mqtt_handler_t   Handler;            // same handler type as mqtt_register_handler().
+  void            *Context = nullptr;  // argument given to the handler.
+};
+
+
+
+/* $PAGE */
+/* $TITLE=route_hash() */
+/* ============================================================================================================================================================= *\
+                                                        FNV-1a hash of a string (same result at compile time and at run time).
+\* ============================================================================================================================================================= */
+constexpr UINT32 route_hash(const char *Text, std::size_t Length)
+{
+  UINT32 Hash = 2166136261u;
+
+
+  for (std::size_t Loop1Size = 0; Loop1Size < Length; ++Loop1Size)
+  {
+    Hash ^= static_cast<UCHAR>(Text[Loop1Size]);
+    Hash *= 16777619u;
+  }
+
+  return Hash;
+}
+
+
+
+/* $PAGE */
+/* $TITLE=route_slot_mix() */
+/* ============================================================================================================================================================= *\
+                                  Mix the hash of a topic with the displacement of its bucket to select its slot (no new pass on the string).
+\* ============================================================================================================================================================= */
+constexpr UINT32 route_slot_mix(UINT32 Hash, UINT32 Displacement)
+{
+  Hash ^= Displacement * 0x9E3779B9u;
+  Hash ^= Hash >> 15;
+  Hash *= 0x2C1B3C6Du;
+  Hash ^= Hash >> 12;
+
+  return Hash;
+}
+
+
+
+/* $PAGE */
+/* $TITLE=route_table_error() */
+/* ============================================================================================================================================================= *\
+                     Not constexpr on purpose: calling it while building a table at compile time stops the compilation with an explicit message.
+\* ============================================================================================================================================================= */
+inline void route_table_error_duplicate_topic(void) {}
+inline void route_table_error_no_perfect_hash(void) {}
+
+
+
+/* $PAGE */
+/* $TITLE=RouteTable */
+/* ============================================================================================================================================================= *\
+                                             Compile-time perfect-hash routing table of <Count> topics, keyed on <KeyLevel>.
+                     Hash and displace: topics are first spread in buckets by their hash, then, starting with the largest bucket, a displacement is
+                     searched for each bucket so that all its topics fall into free slots. Only the displacements and the slots are kept in the table.
+\* ============================================================================================================================================================= */
+template <std::size_t Count, int KeyLevel = ROUTE_KEY_TOPIC>
+class RouteTable
+{
+  static_assert(Count > 0,   "A routing table needs at least one route");
+  static_assert(Count < 256, "A routing table is limited to 255 routes");
+
+public:
+  /* Number of slots: power of 2, at least twice the number of routes. */
+  static constexpr std::size_t Size = []
+  {
+    std::size_t Size = 4;
+    while (Size < (Count * 2)) Size *= 2;
+    return Size;
+  }();
+
+  /* Number of buckets: power of 2, about half the number of routes. */
+  static constexpr std::size_t Buckets = Size / 4;
+
+
+  /* Build the table (at compile time when the object is declared constexpr). */
+  constexpr RouteTable(const Route (&RouteList)[Count]) : Entry{}, Slot{}, Displacement{}
+  {
+    UINT32      Hash[Count]         = {};
+    std::size_t BucketSize[Buckets] = {};
+    bool        BucketDone[Buckets] = {};
+
+
+    for (std::size_t Loop1Size = 0; Loop1Size < Count; ++Loop1Size)
+    {
+      Entry[Loop1Size] = RouteList[Loop1Size];
+      Hash[Loop1Size]  = route_hash(Entry[Loop1Size].Topic.data(), Entry[Loop1Size].Topic.size());
+      ++BucketSize[bucket_of(Hash[Loop1Size])];
+
+      for (std::size_t Loop2Size = 0; Loop2Size < Loop1Size; ++Loop2Size)
+        if (Entry[Loop1Size].Topic == Entry[Loop2Size].Topic) route_table_error_duplicate_topic();
+    }
+
+    /* Place buckets from the largest one to the smallest one. */
+    for (std::size_t Loop1Size = 0; Loop1Size < Buckets; ++Loop1Size)
+    {
+      std::size_t Bucket = Buckets;
+      for (std::size_t Loop2Size = 0; Loop2Size < Buckets; ++Loop2Size)
+        if ((BucketDone[Loop2Size] == false) && ((Bucket == Buckets) || (BucketSize[Loop2Size] > BucketSize[Bucket]))) Bucket = Loop2Size;
+
+      BucketDone[Bucket] = true;
+      if (BucketSize[Bucket] == 0) break;  // all remaining buckets are empty.
+
+      if (place_bucket(Bucket, Hash) == false) route_table_error_no_perfect_hash();
+    }
+  }
+
+
+  /* Return the route of a topic (or topic level), or nullptr if it is not in the table. One hash and one compare. */
+  const Route *find(const char *Text, std::size_t Length) const noexcept
+  {
+    UINT32 Hash  = route_hash(Text, Length);
+    UINT8  Index = Slot[route_slot_mix(Hash, Displacement[bucket_of(Hash)]) & (Size - 1)];
+
+
+    if (Index == 0) return nullptr;
+
+    const Route &Candidate = Entry[Index - 1];
+    if ((Candidate.Topic.size() != Length) || (std::memcmp(Candidate.Topic.data(), Text, Length) != 0)) return nullptr;
+
+    return &Candidate;
+  }
+
+
+  /* Call the handler of the current message of an MQTT instance (see mqtt_get_view()). Return 1 if a handler has been called, 0 otherwise. */
+  UINT8 dispatch(mqtt_ctx_t *Ctx) const
+  {
+    const struct mqtt_view *View = mqtt_get_view(Ctx);
+
+    const UCHAR *Text;
+
+    UINT16 Length;
+
+
+    if constexpr (KeyLevel == ROUTE_KEY_TOPIC)
+    {
+      Text   = View->Topic;
+      Length = View->TopicLength;
+    }
+    else
+    {
+      Text = mqtt_view_sub_topic(View, KeyLevel, &Length);
+      if (Text == nullptr) return 0;
+    }
+
+    const Route *Match = find(reinterpret_cast<const char *>(Text), Length);
+    if (Match == nullptr) return 0;
+
+    Match->Handler(View, Match->Context);
+
+    return 1;
+  }
+
+
+  /* Call the handler of a topic without tokenizing it first (KeyLevel must be ROUTE_KEY_TOPIC). The view is built only if a handler is found. */
+  UINT8 dispatch(mqtt_ctx_t *Ctx, const UCHAR *Topic) const
+  {
+    static_assert(KeyLevel == ROUTE_KEY_TOPIC, "dispatch(Ctx, Topic) requires a table keyed on the whole topic");
+
+    const Route *Match = find(reinterpret_cast<const char *>(Topic), strnlen(reinterpret_cast<const char *>(Topic), MAX_TOPIC_LENGTH));
+    if (Match == nullptr) return 0;
+
+    Match->Handler(mqtt_get_view(Ctx), Match->Context);
+
+    return 1;
+  }
+
+
+private:
+  /* Bucket of a topic (high bits of the hash, the low bits select the slot). */
+  static constexpr std::size_t bucket_of(UINT32 Hash)
+  {
+    return (Hash >> 16) & (Buckets - 1);
+  }
+
+
+  /* Find a displacement for which all topics of a bucket fall into free and different slots, and take these slots. */
+  constexpr bool place_bucket(std::size_t Bucket, const UINT32 (&Hash)[Count])
+  {
+    for (UINT32 Candidate = 0; Candidate < ROUTE_MAX_SEED; ++Candidate)
+    {
+      std::size_t Taken[Count] = {};
+      std::size_t TakenCount   = 0;
+      bool        FlagFree     = true;
+
+      for (std::size_t Loop1Size = 0; (Loop1Size < Count) && FlagFree; ++Loop1Size)
+      {
+        if (bucket_of(Hash[Loop1Size]) != Bucket) continue;
+
+        std::size_t Index = route_slot_mix(Hash[Loop1Size], Candidate) & (Size - 1);
+        if (Slot[Index] != 0)
+        {
+          FlagFree = false;
+          break;
+        }
+        Slot[Index]         = static_cast<UINT8>(Loop1Size + 1);
+        Taken[TakenCount++] = Index;
+      }
+
+      if (FlagFree)
+      {
+        Displacement[Bucket] = static_cast<UINT16>(Candidate);
+        return true;
+      }
+
+      /* Give back the slots taken with this displacement and try the next one. */
+      for (std::size_t Loop1Size = 0; Loop1Size < TakenCount; ++Loop1Size) Slot[Taken[Loop1Size]] = 0;
+    }
+
+    return false;
+  }
+
+  std::array<Route, Count>     Entry;         // routes, in the order they were declared.
+  std::array<UINT8, Size>      Slot;          // index + 1 of the route placed in each slot, 0 if slot is empty.
+  std::array<UINT16, Buckets>  Displacement;  // displacement giving a perfect hash for the topics of each bucket.
+};
+
+
+
+/* $PAGE */
+/* $TITLE=make_route_table() */
+/* ============================================================================================================================================================= *\
+                                   Build a routing table from an array of routes, keyed on the whole topic or on one topic level.
+\* ============================================================================================================================================================= */
+template <int KeyLevel = ROUTE_KEY_TOPIC, std::size_t Count>
+constexpr RouteTable<Count, KeyLevel> make_route_table(const Route (&RouteList)[Count])
+{
+  return RouteTable<Count, KeyLevel>(RouteList);
+}
+}  // namespace pico_mqtt
+
+#endif  // __PICO_MQTT_ROUTER_HPP
@@ -0,0 +1,546 @@
+/* ============================================================================================================================================================= *\
+   Pico-Scheduler-Module.c
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   https://github.com/astlouys/Pico-MQTT-Module
+   Revision 16-OCT-2026
+   Langage: C
+   Version 1.00
+
+   =========================================================================
+   Pico-Scheduler-Module is compatible with the ASTL Smart Home ecosystem family.
+   =========================================================================
+
+   Raspberry Pi Pico C-Language event-driven main loop: periodic tasks are kept in a hashed timer wheel and the processor sleeps (WFE) between
+   them. Events signaled from lwIP callbacks (interrupt context) or from the other core wake the main loop right away.
+
+   NOTE:
+   THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+   WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+   TIME. AS A RESULT, THE AUTHOR SHALL NOT BE HELD LIABLE FOR ANY DIRECT,
+   INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING FROM
+   THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE CODING
+   INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCT.
+
+
+   NOTES:
+   Pico-MQTT_Example.c gives an example on how to use this module:
+     sched_init();
+     sched_add_task("Health check", 15000, EVENT_NETWORK, task_health_check, NULL);
+     while (1)
+     {
+       sched_poll();
+       sched_wait();
+     }
+
+   Each task is in the timer wheel slot of its next due tick (DueTick modulo SCHED_WHEEL_SLOTS): adding and expiring a task does not depend
+   on the number of tasks, and only the slots of the ticks elapsed since last pass are visited.
+
+   REVISION HISTORY:
+   =================
+   16-OCT-2026 1.00 - Initial release.
+                    - Add sched_set_next_run() to move the next run of a task (ex: reconnection attempts with exponential backoff).
+                    - A periodic task run by an event before it is due stays in its timer wheel slot (it used to be inserted a second time).
+                    - Log messages use the leveled macros of baseline.h with a compile-time threshold (SCHED_LOG_LEVEL, LOG_LEVEL_INFO by default).
+\* ============================================================================================================================================================= */
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                          Include files
+\* ============================================================================================================================================================= */
+/* Compile-time log level of this module (may be given on the compiler command line, ex: -DSCHED_LOG_LEVEL=LOG_LEVEL_DEBUG). */
+#ifndef SCHED_LOG_LEVEL
+#define SCHED_LOG_LEVEL  LOG_LEVEL_INFO
+#endif  // SCHED_LOG_LEVEL
+#define LOG_LEVEL  SCHED_LOG_LEVEL  // must be defined before baseline.h.
+
+#include "baseline.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include "string.h"
+
+#include "Pico-Scheduler-Module.h"
+
+
+
+/* $PAGE */
+/* $TITLE=Definitions and macros. */
+/* ============================================================================================================================================================= *\
+                                                                     Definitions and macros.
+\* ============================================================================================================================================================= */
+#define RELEASE_VERSION  ///
+
+
+
+/* $PAGE */
+/* $TITLE=Global variables declaration / definition. */
+/* ============================================================================================================================================================= *\
+                                                               Global variables declaration / definition.
+\* ============================================================================================================================================================= */
+extern struct struct_scheduler StructScheduler;
+
+
+
+/* $PAGE */
+/* $TITLE=Function prototypes. */
+/* ============================================================================================================================================================= *\
+                                                                Function prototypes (module internal).
+\* ============================================================================================================================================================= */
+/* Return the current timer wheel tick. */
+static UINT64 sched_current_tick(void);
+
+/* Return the tick of the next periodic task run. */
+static UINT64 sched_next_tick(void);
+
+/* Add a task to the timer wheel slot of its DueTick. */
+static void sched_wheel_insert(UINT8 TaskNumber);
+
+/* Take a task out of the timer wheel slot of its DueTick (if it is there). */
+static void sched_wheel_remove(UINT8 TaskNumber);
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_add_task() */
+/* ============================================================================================================================================================= *\
+                    Register a task. It runs every <PeriodMSec> (first run one period after registration, 0 means never on time) and as soon as
+                                     one of the events of <EventMask> is signaled. Tasks run in the order they have been registered.
+                                                Return the task number (see sched_run_now()) or -1 if there is no room left.
+\* ============================================================================================================================================================= */
+INT16 sched_add_task(const UCHAR *Name, UINT32 PeriodMSec, UINT32 EventMask, sched_task_t Function, void *Context)
+{
+  UINT8 TaskNumber;
+
+  struct sched_task *Task;
+
+
+  if ((Function == NULL) || (StructScheduler.TaskCount >= MAX_SCHED_TASKS))
+  {
+    log_error("Unable to add task <%s> (%u tasks already registered).\n", Name, StructScheduler.TaskCount);
+    return -1;
+  }
+
+  TaskNumber = StructScheduler.TaskCount;
+  Task       = &StructScheduler.Task[TaskNumber];
+  memset(Task, 0x00, sizeof(*Task));
+  Task->Name        = Name;
+  Task->Function    = Function;
+  Task->Context     = Context;
+  Task->EventMask   = EventMask;
+  Task->Next        = SCHED_NONE;
+  Task->PeriodTicks = ((UINT64)PeriodMSec * 1000ull + SCHED_TICK_USEC - 1) / SCHED_TICK_USEC;
+  ++StructScheduler.TaskCount;
+
+  if (Task->PeriodTicks)
+  {
+    Task->DueTick = sched_current_tick() + Task->PeriodTicks;
+    sched_wheel_insert(TaskNumber);
+  }
+
+  return TaskNumber;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_current_tick() */
+/* ============================================================================================================================================================= *\
+                                                                 Return the current timer wheel tick.
+\* ============================================================================================================================================================= */
+static UINT64 sched_current_tick(void)
+{
+  return (time_us_64() - StructScheduler.StartTime) / SCHED_TICK_USEC;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_display() */
+/* ============================================================================================================================================================= *\
+                                                                Display scheduler tasks and statistics.
+\* ============================================================================================================================================================= */
+void sched_display(void)
+{
+  UINT8 Loop1UInt8;
+
+  UINT64 CurrentTick;
+
+
+  CurrentTick = sched_current_tick();
+
+  log_printf(__LINE__, __func__, "========================================================================================================================\n");
+  log_printf(__LINE__, __func__, "                                                 Scheduler information\n");
+  log_printf(__LINE__, __func__, "========================================================================================================================\n");
+  log_printf(__LINE__, __func__, "Uptime:                        %llu sec\n", (CurrentTick * SCHED_TICK_USEC) / 1000000ull);
+  log_printf(__LINE__, __func__, "Main loop wake-ups:            %lu\n", StructScheduler.Wakeups);
+  log_printf(__LINE__, __func__, "Task runs:                     %lu\n", StructScheduler.TaskRuns);
+  for (Loop1UInt8 = 0; Loop1UInt8 < StructScheduler.TaskCount; ++Loop1UInt8)
+  {
+    log_printf(__LINE__, __func__, "Task %2u  %-20s  period: %6lu msec   events: 0x%8.8lX   runs: %6lu   longest: %7lu usec   next in: %lld msec\n",
+               Loop1UInt8, StructScheduler.Task[Loop1UInt8].Name,
+               (StructScheduler.Task[Loop1UInt8].PeriodTicks * SCHED_TICK_USEC) / 1000, StructScheduler.Task[Loop1UInt8].EventMask,
+               StructScheduler.Task[Loop1UInt8].RunCount, StructScheduler.Task[Loop1UInt8].MaxRunUSec,
+               (StructScheduler.Task[Loop1UInt8].FlagInWheel ? (((INT64)StructScheduler.Task[Loop1UInt8].DueTick - (INT64)CurrentTick) * SCHED_TICK_USEC) / 1000 : -1ll));
+  }
+  log_printf(__LINE__, __func__, "========================================================================================================================\n\n");
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_init() */
+/* ============================================================================================================================================================= *\
+                                                  Initialize the scheduler (must be called before any other sched_...() function).
+\* ============================================================================================================================================================= */
+void sched_init(void)
+{
+  if (!critical_section_is_initialized(&StructScheduler.Lock)) critical_section_init(&StructScheduler.Lock);
+
+  StructScheduler.TaskCount     = 0;
+  StructScheduler.StartTime     = time_us_64();
+  StructScheduler.CurrentTick   = 0;
+  StructScheduler.PendingEvents = 0;
+  StructScheduler.FlagRunNow    = FLAG_OFF;
+  StructScheduler.Wakeups       = 0;
+  StructScheduler.TaskRuns      = 0;
+  memset(StructScheduler.Wheel, SCHED_NONE, sizeof(StructScheduler.Wheel));
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_next_tick() */
+/* ============================================================================================================================================================= *\
+                   Return the tick of the next periodic task run. The slots of the next wheel revolution are checked first; if none of them has a task
+                          due during this revolution, the earliest task is searched (the main loop then sleeps for more than one revolution).
+\* ============================================================================================================================================================= */
+static UINT64 sched_next_tick(void)
+{
+  UINT8 Index;
+  UINT8 Loop1UInt8;
+
+  UINT64 NextTick;
+  UINT64 Tick;
+
+
+  for (Tick = StructScheduler.CurrentTick + 1; Tick <= (StructScheduler.CurrentTick + SCHED_WHEEL_SLOTS); ++Tick)
+    for (Index = StructScheduler.Wheel[Tick & (SCHED_WHEEL_SLOTS - 1)]; Index != SCHED_NONE; Index = StructScheduler.Task[Index].Next)
+      if (StructScheduler.Task[Index].DueTick == Tick) return Tick;
+
+  /* Nothing due during next revolution. */
+  NextTick = ~0ull;
+  for (Loop1UInt8 = 0; Loop1UInt8 < StructScheduler.TaskCount; ++Loop1UInt8)
+    if (StructScheduler.Task[Loop1UInt8].FlagInWheel && (StructScheduler.Task[Loop1UInt8].DueTick < NextTick)) NextTick = StructScheduler.Task[Loop1UInt8].DueTick;
+
+  return NextTick;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_poll() */
+/* ============================================================================================================================================================= *\
+                      Run the tasks that are due and the tasks waiting for the events that have been signaled. Never blocks. Only the wheel slots of
+                      the ticks elapsed since last pass are visited (all slots at most, when the main loop has been busy for more than one revolution).
+                                        A periodic task that has been late by more than one period runs once, not once per missed period.
+\* ============================================================================================================================================================= */
+void sched_poll(void)
+{
+  UINT8 Index;
+  UINT8 Loop1UInt8;
+  UINT8 Next;
+  UINT8 Previous;
+  UINT8 Due[MAX_SCHED_TASKS];
+  UINT8 Run[MAX_SCHED_TASKS];
+
+  UINT32 Events;
+  UINT32 RunTime;
+
+  UINT64 CurrentTick;
+  UINT64 StartTime;
+  UINT64 Tick;
+  UINT64 LastTick;
+
+  struct sched_task *Task;
+
+
+  memset(Due, FLAG_OFF, sizeof(Due));
+  memset(Run, FLAG_OFF, sizeof(Run));
+  CurrentTick = sched_current_tick();
+
+
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                                       Timer wheel: take out the tasks that are due.
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  LastTick = CurrentTick;
+  if ((LastTick - StructScheduler.CurrentTick) > SCHED_WHEEL_SLOTS) LastTick = StructScheduler.CurrentTick + SCHED_WHEEL_SLOTS;
+
+  for (Tick = StructScheduler.CurrentTick + 1; Tick <= LastTick; ++Tick)
+  {
+    Previous = SCHED_NONE;
+    for (Index = StructScheduler.Wheel[Tick & (SCHED_WHEEL_SLOTS - 1)]; Index != SCHED_NONE; Index = Next)
+    {
+      Next = StructScheduler.Task[Index].Next;
+      if (StructScheduler.Task[Index].DueTick > CurrentTick)
+      {
+        Previous = Index;
+        continue;
+      }
+
+      /* Task is due: unlink it from its slot. */
+      if (Previous == SCHED_NONE)
+        StructScheduler.Wheel[Tick & (SCHED_WHEEL_SLOTS - 1)] = Next;
+      else
+        StructScheduler.Task[Previous].Next = Next;
+      StructScheduler.Task[Index].FlagInWheel = FLAG_OFF;
+      Due[Index] = FLAG_ON;
+      Run[Index] = FLAG_ON;
+    }
+  }
+  StructScheduler.CurrentTick = CurrentTick;
+
+  /* Put the due tasks back in the wheel for their next run (a task without period only ran once, after sched_set_next_run()). */
+  for (Loop1UInt8 = 0; Loop1UInt8 < StructScheduler.TaskCount; ++Loop1UInt8)
+  {
+    if ((Due[Loop1UInt8] == FLAG_OFF) || (StructScheduler.Task[Loop1UInt8].PeriodTicks == 0)) continue;
+
+    Task = &StructScheduler.Task[Loop1UInt8];
+    Task->DueTick += Task->PeriodTicks;
+    if (Task->DueTick <= CurrentTick) Task->DueTick = CurrentTick + Task->PeriodTicks;
+    sched_wheel_insert(Loop1UInt8);
+  }
+
+
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                                 Events and run requests signaled since last pass (interrupt context or other core).
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  critical_section_enter_blocking(&StructScheduler.Lock);
+  Events = StructScheduler.PendingEvents;
+  StructScheduler.PendingEvents = 0;
+  if (Events || StructScheduler.FlagRunNow)
+  {
+    StructScheduler.FlagRunNow = FLAG_OFF;
+    for (Loop1UInt8 = 0; Loop1UInt8 < StructScheduler.TaskCount; ++Loop1UInt8)
+    {
+      if ((StructScheduler.Task[Loop1UInt8].EventMask & Events) || StructScheduler.Task[Loop1UInt8].FlagRunNow) Run[Loop1UInt8] = FLAG_ON;
+      StructScheduler.Task[Loop1UInt8].FlagRunNow = FLAG_OFF;
+    }
+  }
+  critical_section_exit(&StructScheduler.Lock);
+
+  if (Events) log_debug("Events signaled: 0x%8.8lX\n", Events);
+
+
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                                                Run the tasks, in registration order.
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  for (Loop1UInt8 = 0; Loop1UInt8 < StructScheduler.TaskCount; ++Loop1UInt8)
+  {
+    if (Run[Loop1UInt8] == FLAG_OFF) continue;
+
+    Task      = &StructScheduler.Task[Loop1UInt8];
+    StartTime = time_us_64();
+    Task->Function(Task->Context);
+    RunTime = (UINT32)(time_us_64() - StartTime);
+    if (RunTime > Task->MaxRunUSec) Task->MaxRunUSec = RunTime;
+    ++Task->RunCount;
+    ++StructScheduler.TaskRuns;
+  }
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_run_now() */
+/* ============================================================================================================================================================= *\
+                           Ask a task to run on next pass of the main loop. Its periodic schedule is not changed. May be called from interrupt
+                                                                   context or from the other core.
+\* ============================================================================================================================================================= */
+void sched_run_now(UINT8 TaskNumber)
+{
+  if (TaskNumber >= StructScheduler.TaskCount) return;
+
+  critical_section_enter_blocking(&StructScheduler.Lock);
+  StructScheduler.Task[TaskNumber].FlagRunNow = FLAG_ON;
+  StructScheduler.FlagRunNow = FLAG_ON;
+  critical_section_exit(&StructScheduler.Lock);
+
+  __sev();  // wake up the main loop.
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_set_next_run() */
+/* ============================================================================================================================================================= *\
+                    Set the next run of a task to <DelayMSec> from now (at least one tick), after which it goes on with its period. Must be called
+                                       from the main loop (a task may call it for itself, its next periodic run is then replaced).
+\* ============================================================================================================================================================= */
+void sched_set_next_run(UINT8 TaskNumber, UINT32 DelayMSec)
+{
+  UINT64 DelayTicks;
+  UINT64 Tick;
+
+
+  if (TaskNumber >= StructScheduler.TaskCount) return;
+
+  sched_wheel_remove(TaskNumber);
+
+  /* Slots before StructScheduler.CurrentTick + 1 will not be visited again before one revolution. */
+  Tick = sched_current_tick();
+  if (Tick < StructScheduler.CurrentTick) Tick = StructScheduler.CurrentTick;
+  DelayTicks = ((UINT64)DelayMSec * 1000ull + SCHED_TICK_USEC - 1) / SCHED_TICK_USEC;
+  if (DelayTicks == 0) DelayTicks = 1;
+
+  StructScheduler.Task[TaskNumber].DueTick = Tick + DelayTicks;
+  sched_wheel_insert(TaskNumber);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_signal() */
+/* ============================================================================================================================================================= *\
+                          Signal events: the tasks waiting for one of them run on next pass of the main loop, which is woken up right away.
+                                                        May be called from interrupt context or from the other core.
+\* ============================================================================================================================================================= */
+void sched_signal(UINT32 Events)
+{
+  critical_section_enter_blocking(&StructScheduler.Lock);
+  StructScheduler.PendingEvents |= Events;
+  critical_section_exit(&StructScheduler.Lock);
+
+  __sev();  // wake up the main loop.
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_wait() */
+/* ============================================================================================================================================================= *\
+                  Put the processor to sleep (WFE) until next task is due or until an event is signaled. An event signaled after the check below
+                                   sets the event register of the processor (__sev()), so the WFE returns at once and nothing is missed.
+\* ============================================================================================================================================================= */
+void sched_wait(void)
+{
+  UINT64 NextTick;
+
+
+  critical_section_enter_blocking(&StructScheduler.Lock);
+  if (StructScheduler.PendingEvents || StructScheduler.FlagRunNow)
+  {
+    critical_section_exit(&StructScheduler.Lock);
+    return;
+  }
+  critical_section_exit(&StructScheduler.Lock);
+
+  NextTick = sched_next_tick();
+  if (NextTick == ~0ull)
+  {
+    /* No periodic task: wait for an event only. */
+    ++StructScheduler.Wakeups;
+    __wfe();
+    return;
+  }
+
+  ++StructScheduler.Wakeups;
+  best_effort_wfe_or_timeout(from_us_since_boot(StructScheduler.StartTime + (NextTick * SCHED_TICK_USEC)));
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_wheel_insert() */
+/* ============================================================================================================================================================= *\
+                                                          Add a task to the timer wheel slot of its DueTick.
+\* ============================================================================================================================================================= */
+static void sched_wheel_insert(UINT8 TaskNumber)
+{
+  UINT8 Slot;
+
+
+  Slot = StructScheduler.Task[TaskNumber].DueTick & (SCHED_WHEEL_SLOTS - 1);
+  StructScheduler.Task[TaskNumber].Next        = StructScheduler.Wheel[Slot];
+  StructScheduler.Task[TaskNumber].FlagInWheel = FLAG_ON;
+  StructScheduler.Wheel[Slot] = TaskNumber;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sched_wheel_remove() */
+/* ============================================================================================================================================================= *\
+                                                   Take a task out of the timer wheel slot of its DueTick (if it is there).
+\* ============================================================================================================================================================= */
+static void sched_wheel_remove(UINT8 TaskNumber)
+{
+  UINT8 Index;
+  UINT8 Previous;
+  UINT8 Slot;
+
+
+  if (StructScheduler.Task[TaskNumber].FlagInWheel == FLAG_OFF) return;
+
+  Slot     = StructScheduler.Task[TaskNumber].DueTick & (SCHED_WHEEL_SLOTS - 1);
+  Previous = SCHED_NONE;
+  for (Index = StructScheduler.Wheel[Slot]; Index != SCHED_NONE; Index = StructScheduler.Task[Index].Next)
+  {
+    if (Index == TaskNumber)
+    {
+      if (Previous == SCHED_NONE)
+        StructScheduler.Wheel[Slot] = StructScheduler.Task[Index].Next;
+      else
+        StructScheduler.Task[Previous].Next = StructScheduler.Task[Index].Next;
+      StructScheduler.Task[Index].Next        = SCHED_NONE;
+      StructScheduler.Task[Index].FlagInWheel = FLAG_OFF;
+      return;
+    }
+    Previous = Index;
+  }
+
+  return;
+}
@@ -0,0 +1,106 @@
+/* ============================================================================================================================================================= *\
+   Pico-Scheduler-Module.h
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   Revision 16-OCT-2026
+   Langage: C
+\* ============================================================================================================================================================= */
+
+#ifndef __PICO_SCHEDULER_MODULE_H
+#define __PICO_SCHEDULER_MODULE_H
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                      Include files.
+\* ============================================================================================================================================================= */
+#include "pico/critical_section.h"
+
+
+
+/* $PAGE */
+/* $TITLE=Definitions. */
+/* ============================================================================================================================================================= *\
+                                                                        Definitions.
+\* ============================================================================================================================================================= */
+#define MAX_SCHED_TASKS             16  // maximum number of tasks (see sched_add_task()).
+#define SCHED_WHEEL_SLOTS           64  // number of slots of the timer wheel (must be a power of 2).
+#define SCHED_TICK_USEC          10000  // duration of one timer wheel tick (usec).
+#define SCHED_NONE                0xFF  // end of the task list of a timer wheel slot.
+
+
+
+/* $PAGE */
+/* $TITLE=Variable definitions. */
+/* ============================================================================================================================================================= *\
+                                                                      Variable definitions.
+\* ============================================================================================================================================================= */
+/* Task function, always called from the main loop (never from interrupt context). */
+typedef void (*sched_task_t)(void *Context);
+
+struct sched_task
+{
+  const UCHAR *Name;
+  sched_task_t Function;
+  void        *Context;
+  UINT32       PeriodTicks;  // period in timer wheel ticks (0: task only runs on events or after sched_run_now()).
+  UINT32       EventMask;    // events (see sched_signal()) that make the task run right away.
+  UINT64       DueTick;      // tick of the next periodic run.
+  UINT8        Next;         // next task in the same timer wheel slot, or SCHED_NONE.
+  UINT8        FlagRunNow;   // task must run on next pass of the main loop (see sched_run_now()).
+  UINT8        FlagInWheel;  // task is in the timer wheel slot of its DueTick.
+  UINT32       RunCount;     // number of times the task has run.
+  UINT32       MaxRunUSec;   // longest run time of the task (usec).
+};
+
+struct struct_scheduler
+{
+  UINT8              TaskCount;
+  UINT8              Wheel[SCHED_WHEEL_SLOTS];  // first task of each timer wheel slot (a task is in the slot of its DueTick).
+  UINT64             StartTime;                 // time_us_64() value of tick 0.
+  UINT64             CurrentTick;               // last tick processed by sched_poll().
+  volatile UINT32    PendingEvents;             // events signaled since last pass of the main loop.
+  volatile UINT8     FlagRunNow;                // at least one task has been asked to run now.
+  UINT32             Wakeups;                   // number of times the main loop has been put to sleep.
+  UINT32             TaskRuns;                  // total number of task runs.
+  critical_section_t Lock;                      // events may be signaled from interrupt context or from the other core.
+  struct sched_task  Task[MAX_SCHED_TASKS];
+};
+
+
+
+/* $PAGE */
+/* $TITLE=Function prototypes. */
+/* ============================================================================================================================================================= *\
+                                                                     Function prototypes.
+\* ============================================================================================================================================================= */
+/* Register a task, run every PeriodMSec (0: never on time) and as soon as one of the events of EventMask is signaled. Return its number or -1 if full. */
+INT16 sched_add_task(const UCHAR *Name, UINT32 PeriodMSec, UINT32 EventMask, sched_task_t Function, void *Context);
+
+/* Display scheduler tasks and statistics. */
+void sched_display(void);
+
+/* Initialize the scheduler (must be called before any other sched_...() function). */
+void sched_init(void);
+
+/* Run the tasks that are due and the tasks waiting for the events that have been signaled. Never blocks. */
+void sched_poll(void);
+
+/* Ask a task to run on next pass of the main loop (may be called from interrupt context or from the other core). */
+void sched_run_now(UINT8 TaskNumber);
+
+/* Set the next run of a task to <DelayMSec> from now, then it goes on with its period (main loop only, a task may call it for itself). */
+void sched_set_next_run(UINT8 TaskNumber, UINT32 DelayMSec);
+
+/* Signal events: the tasks waiting for them run right away (may be called from interrupt context or from the other core). */
+void sched_signal(UINT32 Events);
+
+/* Put the processor to sleep (WFE) until next task is due or until an event is signaled. */
+void sched_wait(void);
+
+/* Send a string to external monitor through Pico UART (or USB CDC). */
+extern void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...);
+
+#endif  // __PICO_SCHEDULER_MODULE_H
@@ -46,6 +46,54 @@ typedef double        DOUBLE;
 #define LOG_FUNCTION   16
 #define LOG_ALL      0xFF
 
+/* log_printf() output mode (see log_set_mode()). LOG_MODE_BINARY may be combined with both other modes. */
+#define LOG_MODE_DIRECT  0  // each line is sent to stdio by the caller.
+#define LOG_MODE_ASYNC   1  // each line is copied to a ring buffer of the calling core and sent to stdio by log_drain().
+#define LOG_MODE_BINARY  2  // each log call is sent as a binary record, decoded on the host (see host/log_decode.c).
+
+/* Log levels. A source file may define LOG_LEVEL before including baseline.h: log_error() ... log_trace() calls above this level are
+   removed at compile time, with their arguments and their format strings. Without LOG_LEVEL, all of them are kept. */
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4
+#define LOG_LEVEL_TRACE  5
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL  LOG_LEVEL_TRACE
+#endif  // LOG_LEVEL
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define log_error(...)  log_printf(__LINE__, __func__, __VA_ARGS__)
+#else
+#define log_error(...)  ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define log_warn(...)   log_printf(__LINE__, __func__, __VA_ARGS__)
+#else
+#define log_warn(...)   ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define log_info(...)   log_printf(__LINE__, __func__, __VA_ARGS__)
+#else
+#define log_info(...)   ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define log_debug(...)  log_printf(__LINE__, __func__, __VA_ARGS__)
+#else
+#define log_debug(...)  ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_TRACE
+#define log_trace(...)  log_printf(__LINE__, __func__, __VA_ARGS__)
+#else
+#define log_trace(...)  ((void)0)
+#endif
+
 
 /* Structure to contain time variables under "human" readable format instead of "tm" standard. */
 struct human_time
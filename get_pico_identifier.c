@@ -1,24 +1,99 @@
 #include "hardware/adc.h"
+#include "hardware/flash.h"
 
 #define ADC_VCC  29  // internal GPIO to determine if we are running on a Pico or PicoW.
 
+/* ------------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                                      Device identifiers: Pico Unique ID (board ID) to device name.
+   Tables are sorted by BoardId (the 8 bytes of the Unique ID, most significant byte first, in the same order as the Unique ID string) and searched
+   by binary search. The registry kept in the last PICO_IDENTIFIER_FLASH_SECTORS sectors of the flash memory is searched first, then the built-in
+   table below. The registry is built on Linux from a text file with host/pico_id_registry and written to the flash with picotool: devices may be
+   added without changing the code. It is ignored when its header is not valid (ex: erased flash).
+   NOTE: The Firmware and any other flash storage must not use the last PICO_IDENTIFIER_FLASH_SECTORS sectors of the flash memory. When the end of the
+         Firmware image (__flash_binary_end) gets into these sectors, the registry is ignored and an error is logged: loading a registry with picotool
+         would then overwrite code.
+\* ------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+#define PICO_IDENTIFIER_MAGIC   0x44494350  // "PCID", first word of the flash registry (must be the same as in host/pico_id_registry.c).
+#define PICO_IDENTIFIER_SIZE            24  // size of a device name in the tables, including its terminating null.
+
+#ifndef PICO_IDENTIFIER_FLASH_SECTORS
+#define PICO_IDENTIFIER_FLASH_SECTORS    4  // flash sectors reserved for the registry, at the end of the flash memory (511 devices).
+#endif  // PICO_IDENTIFIER_FLASH_SECTORS
+
+#define PICO_IDENTIFIER_FLASH_OFFSET  (PICO_FLASH_SIZE_BYTES - (PICO_IDENTIFIER_FLASH_SECTORS * FLASH_SECTOR_SIZE))
+#define PICO_IDENTIFIER_FLASH_MAX     (((PICO_IDENTIFIER_FLASH_SECTORS * FLASH_SECTOR_SIZE) - sizeof(struct pico_identifier_header)) / sizeof(struct pico_identifier))
+
+struct pico_identifier
+{
+  UINT64 BoardId;
+  UCHAR  Name[PICO_IDENTIFIER_SIZE];
+};
+
+/* Header of the flash registry, followed by <Count> entries sorted by BoardId. */
+struct pico_identifier_header
+{
+  UINT32 Magic;      // PICO_IDENTIFIER_MAGIC.
+  UINT16 Version;    // format version (1).
+  UINT16 Count;      // number of entries.
+  UINT32 EntrySize;  // sizeof(struct pico_identifier).
+  UINT32 Reserved;
+};
+
+/* End of the Firmware image in flash memory (Pico SDK linker script). */
+extern char __flash_binary_end;
+
+/* Built-in table (sorted by BoardId). */
+static const struct pico_identifier PicoIdentifierTable[] =
+{
+  {0xE6614103E72C2423ull, "Control"},
+  {0xE6614103E74E9221ull, "CallerId"},
+  {0xE6614103E7568321ull, "Alain"},
+  {0xE6614103E7701B25ull, "Kitchen"},
+  {0xE66164084316352Dull, "MultiSensor"},
+  {0xE661640843238B29ull, "BureauM"},
+  {0xE66164084329202Dull, "Lounge"},
+  {0xE661640843296029ull, "Atelier"},
+  {0xE661640843379121ull, "ChambreA"},
+  {0xE6616408433D3127ull, "Raymonde"},  // to be verified
+  {0xE6616408434A0826ull, "OfficeLong"},
+  {0xE6616408434B7A22ull, "Dining"},
+  {0xE6616408434D8521ull, "CallerId1"},
+  {0xE661640843549829ull, "SoundServer1"},
+  {0xE6616408436C4D2Bull, "PrintServer"},
+  {0xE6616408436E6924ull, "OfficeTest"},
+  {0xE6616408437CB024ull, "DualExpander"},
+  {0xE6616408437F732Aull, "SoundServer2"},
+};
+
+/* Return the device name of <BoardId> in a sorted table, or NULL if it is not there. */
+static const UCHAR *pico_identifier_search(const struct pico_identifier *Table, UINT16 Count, UINT64 BoardId);
+
 /* $PAGE */
 /* $TITLE=get_pico_identifier() */
 /* ============================================================================================================================================================= *\
                                                  Retrieve specific Pico identifier string from its Unique ID.
          This function attributes a "device name" (or "device ID") to each physical Pico, based on its "Unique ID" (serial number in Pico's flash memory).
         This way, we can use this "Device Name" as an MQTT client ID. If no Device Id is found corresponding to the Pico's Unique ID, the Unique ID itself
-        will be returned as the Device Name. If this happens, you should edit the <get_pico_identifier()> function and add the Pico's Unique ID along with
-                                                           its corresponding Device Name ("device ID").
+       will be returned as the Device Name. If this happens, add the Pico's Unique ID along with its corresponding Device Name ("device ID") to the flash
+                                          registry (see host/pico_id_registry.c) or to PicoIdentifierTable[] (keep it sorted).
 \* ============================================================================================================================================================= */
 void get_pico_identifier(UCHAR *PicoUniqueId, UCHAR *PicoIdentifier, UINT8 *PicoType)
 {
+  static const UCHAR HexDigit[] = "0123456789ABCDEF";
+
+  UINT Index;
   UINT Loop1UInt;
 
   UINT16 AdcValue;
 
+  UINT64 BoardId;
+
   float Volts;
 
+  const UCHAR *Name;
+
+  const struct pico_identifier_header *Registry;
+
   pico_unique_board_id_t board_id;
 
 
@@ -94,76 +169,73 @@ void get_pico_identifier(UCHAR *PicoUniqueId, UCHAR *PicoIdentifier, UINT8 *Pico
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
   pico_get_unique_board_id(&board_id);
 
-  /* Build the Unique ID string in hex. */
-  PicoUniqueId[0] = '\0';  // initialize as null string on entry.
+  /* Board ID as a 64-bit key and Unique ID string in hex ("XXXX-XXXX-XXXX-XXXX"). */
+  BoardId = 0ll;
+  Index   = 0;
   for (Loop1UInt = 0; Loop1UInt < PICO_UNIQUE_BOARD_ID_SIZE_BYTES; ++Loop1UInt)
   {
-    // log_info(__LINE__, __func__, "%2u - 0x%2.2X\n", Loop1UInt, board_id.id[Loop1UInt]);
-    sprintf(&PicoUniqueId[strlen(PicoUniqueId)], "%2.2X", board_id.id[Loop1UInt]);
-    if ((Loop1UInt % 2) && (Loop1UInt != 7)) sprintf(&PicoUniqueId[strlen(PicoUniqueId)], "-");
+    BoardId = (BoardId << 8) | board_id.id[Loop1UInt];
+    PicoUniqueId[Index++] = HexDigit[board_id.id[Loop1UInt] >> 4];
+    PicoUniqueId[Index++] = HexDigit[board_id.id[Loop1UInt] & 0x0F];
+    if ((Loop1UInt % 2) && (Loop1UInt != 7)) PicoUniqueId[Index++] = '-';
   }
+  PicoUniqueId[Index] = '\0';
 
 
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
                                                      Retrieve Pico Device ID corresponding to this Pico's Unique ID.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  /* Assign Pico's unique ID as default identifier in case this specific Pico Unique ID has not been tagged yet. */
-  sprintf(PicoIdentifier, "%s", PicoUniqueId);
-
-  if (strncmp(PicoUniqueId, "E661-4103-E756-8321", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "Alain");
-
-  if (strncmp(PicoUniqueId, "E661-6408-4329-6029", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "Atelier");
-
-  if (strncmp(PicoUniqueId, "E661-6408-4323-8B29", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "BureauM");
-
-  if (strncmp(PicoUniqueId, "E661-4103-E74E-9221", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "CallerId");
-
-  if (strncmp(PicoUniqueId, "E661-6408-434D-8521", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "CallerId1");
-
-  if (strncmp(PicoUniqueId, "E661-6408-4337-9121", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "ChambreA");
-
-  if (strncmp(PicoUniqueId, "E661-4103-E72C-2423", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "Control");
+  Name     = NULL;
+  Registry = (const struct pico_identifier_header *)(XIP_BASE + PICO_IDENTIFIER_FLASH_OFFSET);
+  if (&__flash_binary_end > (char *)Registry)
+  {
+    /* Firmware image has grown into the sectors of the registry: what is there is code, not a registry. */
+    log_printf(__LINE__, __func__, "ERROR - Firmware ends at 0x%p, past the start of the device registry (0x%p): registry ignored.\n", &__flash_binary_end, Registry);
+  }
+  else if ((Registry->Magic == PICO_IDENTIFIER_MAGIC) && (Registry->EntrySize == sizeof(struct pico_identifier)) && (Registry->Count <= PICO_IDENTIFIER_FLASH_MAX))
+    Name = pico_identifier_search((const struct pico_identifier *)(Registry + 1), Registry->Count, BoardId);
 
-  if (strncmp(PicoUniqueId, "E661-6408-434B-7A22", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "Dining");
+  if (Name == NULL) Name = pico_identifier_search(PicoIdentifierTable, sizeof(PicoIdentifierTable) / sizeof(PicoIdentifierTable[0]), BoardId);
 
-  if (strncmp(PicoUniqueId, "E661-6408-437C-B024", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "DualExpander");
+  /* Pico's unique ID is the default identifier in case this specific Pico Unique ID has not been tagged yet. */
+  if (Name == NULL)
+    sprintf(PicoIdentifier, "%s", PicoUniqueId);
+  else
+    sprintf(PicoIdentifier, "%.*s", PICO_IDENTIFIER_SIZE - 1, Name);
 
-  if (strncmp(PicoUniqueId, "E661-4103-E770-1B25", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "Kitchen");
+  return;
+}
 
-  if (strncmp(PicoUniqueId, "E661-6408-4329-202D", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "Lounge");
 
-  if (strncmp(PicoUniqueId, "E661-6408-4316-352D", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "MultiSensor");
 
-  if (strncmp(PicoUniqueId, "E661-6408-434A-0826", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "OfficeLong");
 
-  if (strncmp(PicoUniqueId, "E661-6408-436E-6924", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "OfficeTest");
 
-  if (strncmp(PicoUniqueId, "E661-6408-436C-4D2B", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "PrintServer");
+/* $PAGE */
+/* $TITLE=pico_identifier_search() */
+/* ============================================================================================================================================================= *\
+                                    Return the device name of <BoardId> in a table of <Count> entries sorted by BoardId (binary search),
+                                                                      or NULL if it is not there.
+\* ============================================================================================================================================================= */
+static const UCHAR *pico_identifier_search(const struct pico_identifier *Table, UINT16 Count, UINT64 BoardId)
+{
+  UINT16 High;
+  UINT16 Low;
+  UINT16 Middle;
 
-  if (strncmp(PicoUniqueId, "E661-6408-433D-3127", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "Raymonde");  // to be verified
 
-  if (strncmp(PicoUniqueId, "E661-6408-4354-9829", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "SoundServer1");
+  Low  = 0;
+  High = Count;
+  while (Low < High)
+  {
+    Middle = Low + ((High - Low) / 2);
+    if (Table[Middle].BoardId == BoardId) return Table[Middle].Name;
 
-  if (strncmp(PicoUniqueId, "E661-6408-437F-732A", strlen(PicoUniqueId)) == 0)
-    sprintf(PicoIdentifier, "SoundServer2");
+    if (Table[Middle].BoardId < BoardId)
+      Low = Middle + 1;
+    else
+      High = Middle;
+  }
 
-  return;
+  return NULL;
 }
@@ -0,0 +1,1385 @@
+/* ============================================================================================================================================================= *\
+   Pico-Host-Platform.c
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   Revision 16-OCT-2026
+   Langage: C
+
+   Linux host implementation of the Pico SDK and lwIP MQTT client services used by Pico-MQTT-Module.
+
+   NOTES:
+   - time_us_64() follows the Linux monotonic clock, plus a "simulated time" offset. By default, sleep_ms() does not really sleep: it only moves
+     the simulated time forward. This way, the many sleep_ms() calls of the firmware show up in the measurements without slowing down the benchmarks.
+   - The lwIP MQTT client is replaced by a loopback broker model: requests are accepted up to MQTT_REQ_MAX_IN_FLIGHT and their answers (CONNACK,
+     PUBACK, SUBACK, UNSUBACK) are delivered when host_mqtt_poll() is called, the same way lwIP delivers them when the broker answers.
+   - The SIO FIFOs of the two cores are simulated, but an interrupt cannot preempt a thread: a thread acting as an idle core runs its FIFO
+     interrupt handler by calling host_irq_wait(), which yields the processor until the FIFO has data.
+   - The broker model keeps one persistent session (clean session flag of the CONNECT packet, session present flag of CONNACK), with its
+     subscriptions and the publishes received while the client is disconnected.
+\* ============================================================================================================================================================= */
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                          Include files
+\* ============================================================================================================================================================= */
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <sched.h>
+#include <time.h>
+
+#include "Pico-Host-Platform.h"
+
+
+
+/* $PAGE */
+/* $TITLE=Definitions and macros. */
+/* ============================================================================================================================================================= *\
+                                                                     Definitions and macros.
+\* ============================================================================================================================================================= */
+#define HOST_CONN_DISCONNECTED   0  // simulated client is not connected to the broker.
+#define HOST_CONN_CONNECTING     1  // connect request sent, waiting for CONNACK.
+#define HOST_CONN_CONNECTED      2  // CONNACK received, client is connected.
+
+#define HOST_REQUEST_FREE        0  // request slot is available.
+#define HOST_REQUEST_PENDING     1  // request has been sent, waiting for the broker answer.
+
+#define HOST_CONNECT_CLEAN    0x02  // CONNECT flag: clean session.
+#define HOST_CONNACK_PRESENT  0x01  // CONNACK acknowledge flag: session present.
+#define HOST_SESSION_QUEUE       8  // number of publishes kept by the broker for a disconnected client with a persistent session.
+
+
+/* Persistent session kept by the simulated broker (one client). */
+struct host_session
+{
+  UINT8  FlagValid;
+  UCHAR  ClientId[64];
+  UINT16 Subscriptions;             // number of topic filters subscribed in this session.
+  UINT8  QueueCount;                // publishes received while the client was disconnected.
+  UCHAR  QueueTopic[HOST_SESSION_QUEUE][64];
+  UCHAR  QueuePayload[HOST_SESSION_QUEUE][128];
+  UINT16 QueueLength[HOST_SESSION_QUEUE];
+};
+
+
+
+/* $PAGE */
+/* $TITLE=Global variables declaration / definition. */
+/* ============================================================================================================================================================= *\
+                                                               Global variables declaration / definition.
+\* ============================================================================================================================================================= */
+static UINT8  FlagBrokerAvailable = FLAG_ON;
+static UINT8  FlagRealSleep       = FLAG_OFF;
+static UINT8  FlagStdioConnected  = FLAG_OFF;
+static UINT16 OutputStart;         // position of the next CONNECT packet in the output ring buffer (see host_mqtt_set_output_start()).
+static UINT64 MonotonicBase;       // monotonic clock value on first call to time_us_64().
+static UINT64 WarpUSec;            // simulated time added to the monotonic clock.
+static time_t RtcEpoch;            // real-time clock value (seconds since 1970) when it was last set.
+static UINT64 RtcSetTime;          // time_us_64() value when the real-time clock was last set.
+static struct host_session HostSession;
+
+static __thread UINT32 HostCoreNum;
+static __thread UINT32 HostException;  // exception number of the interrupt handler run by host_irq_wait() (0: thread mode).
+
+/* Simulated lwIP lock, recursive as the async context lock of cyw43_arch (the mutex is taken by the outermost cyw43_arch_lwip_begin() only). */
+static pthread_mutex_t LwipMutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread UINT32 LwipDepth;
+
+/* Simulated processor event register (set by __sev(), cleared when a WFE wakes up on it). */
+static pthread_mutex_t EventMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  EventCondition = PTHREAD_COND_INITIALIZER;
+static UINT8           FlagEvent;
+static UINT32          WfeCount;
+
+/* Simulated SIO FIFOs: Fifo[n] is read by core n only (FifoHead) and written by the other core only (FifoTail), without any lock, as the
+   hardware FIFOs. A core waiting for its FIFO or for room in the FIFO of the other core yields the processor. */
+static UINT32          Fifo[2][HOST_FIFO_DEPTH];
+static UINT8           FifoHead[2];
+static UINT8           FifoTail[2];
+static UINT32          FifoCount[2];
+static irq_handler_t   IrqHandler[HOST_IRQ_COUNT];
+static UINT8           IrqEnabled[HOST_IRQ_COUNT];
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=__dmb() */
+/* ============================================================================================================================================================= *\
+                                                  Data memory barrier: memory accesses before it are completed before the ones after it.
+\* ============================================================================================================================================================= */
+void __dmb(void)
+{
+  __sync_synchronize();
+
+  return;
+}
+
+
+
+
+
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=__get_current_exception() */
+/* ============================================================================================================================================================= *\
+                                   Return the exception number of the interrupt being serviced by the calling core, or 0 in thread mode.
+\* ============================================================================================================================================================= */
+UINT __get_current_exception(void)
+{
+  return HostException;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=__sev() */
+/* ============================================================================================================================================================= *\
+                                                 Send an event: wake up a core waiting in __wfe() (or set the event register).
+\* ============================================================================================================================================================= */
+void __sev(void)
+{
+  pthread_mutex_lock(&EventMutex);
+  FlagEvent = FLAG_ON;
+  pthread_cond_broadcast(&EventCondition);
+  pthread_mutex_unlock(&EventMutex);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=__wfe() */
+/* ============================================================================================================================================================= *\
+                                                          Wait for an event (return at once if the event register is set).
+\* ============================================================================================================================================================= */
+void __wfe(void)
+{
+  pthread_mutex_lock(&EventMutex);
+  ++WfeCount;
+  while (FlagEvent == FLAG_OFF) pthread_cond_wait(&EventCondition, &EventMutex);
+  FlagEvent = FLAG_OFF;
+  pthread_mutex_unlock(&EventMutex);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=best_effort_wfe_or_timeout() */
+/* ============================================================================================================================================================= *\
+                         Wait for an event or until <Timeout>. Return 1 if the timeout has been reached. Unless real sleep has been selected, waiting
+                                       for the timeout only moves the simulated time forward (the same way sleep_ms() does).
+\* ============================================================================================================================================================= */
+UINT8 best_effort_wfe_or_timeout(absolute_time_t Timeout)
+{
+  UINT64 CurrentTime;
+
+  struct timespec Deadline;
+
+
+  pthread_mutex_lock(&EventMutex);
+  ++WfeCount;
+
+  CurrentTime = time_us_64();
+  if ((FlagEvent == FLAG_OFF) && (CurrentTime < Timeout))
+  {
+    if (FlagRealSleep == FLAG_OFF)
+    {
+      WarpUSec += (Timeout - CurrentTime);
+    }
+    else
+    {
+      clock_gettime(CLOCK_REALTIME, &Deadline);
+      Deadline.tv_sec  += (Timeout - CurrentTime) / 1000000ull;
+      Deadline.tv_nsec += ((Timeout - CurrentTime) % 1000000ull) * 1000ull;
+      if (Deadline.tv_nsec >= 1000000000l)
+      {
+        ++Deadline.tv_sec;
+        Deadline.tv_nsec -= 1000000000l;
+      }
+      while ((FlagEvent == FLAG_OFF) && (pthread_cond_timedwait(&EventCondition, &EventMutex, &Deadline) == 0));
+    }
+  }
+
+  if (FlagEvent)
+  {
+    FlagEvent = FLAG_OFF;
+    pthread_mutex_unlock(&EventMutex);
+    return 0;
+  }
+  pthread_mutex_unlock(&EventMutex);
+
+  return 1;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=critical_section_enter_blocking() */
+/* ============================================================================================================================================================= *\
+                                                                        Enter a critical section.
+\* ============================================================================================================================================================= */
+void critical_section_enter_blocking(critical_section_t *CriticalSection)
+{
+  pthread_mutex_lock(&CriticalSection->Mutex);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=critical_section_exit() */
+/* ============================================================================================================================================================= *\
+                                                                        Exit a critical section.
+\* ============================================================================================================================================================= */
+void critical_section_exit(critical_section_t *CriticalSection)
+{
+  pthread_mutex_unlock(&CriticalSection->Mutex);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=critical_section_init() */
+/* ============================================================================================================================================================= *\
+                                                                     Initialize a critical section.
+\* ============================================================================================================================================================= */
+void critical_section_init(critical_section_t *CriticalSection)
+{
+  pthread_mutex_init(&CriticalSection->Mutex, NULL);
+  CriticalSection->FlagInitialized = FLAG_ON;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=critical_section_is_initialized() */
+/* ============================================================================================================================================================= *\
+                                                        Return FLAG_ON if the critical section has been initialized.
+\* ============================================================================================================================================================= */
+UINT8 critical_section_is_initialized(critical_section_t *CriticalSection)
+{
+  return CriticalSection->FlagInitialized;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=cyw43_arch_lwip_begin() */
+/* ============================================================================================================================================================= *\
+                                     Acquire the lwIP lock (recursive: lwIP callbacks run with it held, see host_mqtt_poll()).
+\* ============================================================================================================================================================= */
+void cyw43_arch_lwip_begin(void)
+{
+  if (LwipDepth++ == 0) pthread_mutex_lock(&LwipMutex);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=cyw43_arch_lwip_end() */
+/* ============================================================================================================================================================= *\
+                                                                      Release the lwIP lock.
+\* ============================================================================================================================================================= */
+void cyw43_arch_lwip_end(void)
+{
+  if (--LwipDepth == 0) pthread_mutex_unlock(&LwipMutex);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=from_us_since_boot() */
+/* ============================================================================================================================================================= *\
+                                                            Convert a number of usec since boot to an absolute time.
+\* ============================================================================================================================================================= */
+absolute_time_t from_us_since_boot(UINT64 USec)
+{
+  return USec;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=get_core_num() */
+/* ============================================================================================================================================================= *\
+                                                                Return the number of the calling core.
+\* ============================================================================================================================================================= */
+UINT32 get_core_num(void)
+{
+  return HostCoreNum;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=getchar_timeout_us() */
+/* ============================================================================================================================================================= *\
+                                    Read a character from the terminal. There is no terminal on the host, so always time out.
+\* ============================================================================================================================================================= */
+INT32 getchar_timeout_us(UINT32 TimeOutUSec)
+{
+  sleep_us(TimeOutUSec);
+
+  return PICO_ERROR_TIMEOUT;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_irq_wait() */
+/* ============================================================================================================================================================= *\
+       Wait until the SIO FIFO of the calling core has data, then run its interrupt handler if it is enabled (simulates an interrupt on an idle core).
+\* ============================================================================================================================================================= */
+void host_irq_wait(void)
+{
+  UINT Irq;
+
+  UINT32 Core;
+
+
+  Core = HostCoreNum & 0x01;
+  Irq  = SIO_IRQ_PROC0 + Core;
+
+  while (__atomic_load_n(&FifoCount[Core], __ATOMIC_ACQUIRE) == 0) sched_yield();
+
+  if (IrqEnabled[Irq] && IrqHandler[Irq])
+  {
+    HostException = 16 + Irq;  // Cortex-M: external interrupts start at exception number 16.
+    IrqHandler[Irq]();
+    HostException = 0;
+  }
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_mqtt_clear_sessions() */
+/* ============================================================================================================================================================= *\
+                                         Simulate a broker that has lost its persistent sessions (ex: restarted without persistence).
+\* ============================================================================================================================================================= */
+void host_mqtt_clear_sessions(void)
+{
+  memset(&HostSession, 0x00, sizeof(HostSession));
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_mqtt_drop_connection() */
+/* ============================================================================================================================================================= *\
+                                                         Simulate the loss of the connection with the broker.
+\* ============================================================================================================================================================= */
+void host_mqtt_drop_connection(mqtt_client_t *Client)
+{
+  UINT16 Loop1UInt16;
+
+
+  if ((Client == NULL) || (Client->ConnState == HOST_CONN_DISCONNECTED)) return;
+
+  Client->ConnState = HOST_CONN_DISCONNECTED;
+
+  /* Pending requests will never be answered: lwIP frees them without calling their callback (mqtt_close() / mqtt_clear_requests()). */
+  for (Loop1UInt16 = 0; Loop1UInt16 < MQTT_REQ_MAX_IN_FLIGHT; ++Loop1UInt16)
+    Client->Request[Loop1UInt16].State = HOST_REQUEST_FREE;
+
+  if (Client->ConnectCallback) Client->ConnectCallback(Client, Client->ConnectArgument, MQTT_CONNECT_DISCONNECTED);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_mqtt_inject_publish() */
+/* ============================================================================================================================================================= *\
+                                   Simulate the reception of a publish from the broker on a topic to which the client did subscribe.
+                      The payload is split in chunks the same way lwIP does: the first chunk shares the receive buffer with the topic.
+\* ============================================================================================================================================================= */
+void host_mqtt_inject_publish(mqtt_client_t *Client, const char *Topic, const void *Payload, u32_t PayloadLength)
+{
+  const u8_t *Data;
+
+  u32_t ChunkSize;
+  u32_t Offset;
+
+
+  if (Client == NULL) return;
+
+  if (Client->ConnState != HOST_CONN_CONNECTED)
+  {
+    /* Broker keeps the publish for a disconnected client having a persistent session with subscriptions. */
+    if (HostSession.FlagValid && HostSession.Subscriptions && (HostSession.QueueCount < HOST_SESSION_QUEUE) && (strcmp(HostSession.ClientId, Client->ClientId) == 0) &&
+        (strlen(Topic) < sizeof(HostSession.QueueTopic[0])) && (PayloadLength <= sizeof(HostSession.QueuePayload[0])))
+    {
+      strcpy(HostSession.QueueTopic[HostSession.QueueCount], Topic);
+      memcpy(HostSession.QueuePayload[HostSession.QueueCount], Payload, PayloadLength);
+      HostSession.QueueLength[HostSession.QueueCount] = PayloadLength;
+      ++HostSession.QueueCount;
+    }
+    return;
+  }
+
+  if (Client->PublishCallback) Client->PublishCallback(Client->InpubArgument, Topic, PayloadLength);
+  if (Client->DataCallback == NULL) return;
+
+  Data = (const u8_t *)Payload;
+
+  /* First chunk shares the variable header buffer with the topic length (2 bytes) and the topic itself. */
+  if ((strlen(Topic) + 2) < MQTT_VAR_HEADER_BUFFER_LEN)
+    ChunkSize = MQTT_VAR_HEADER_BUFFER_LEN - (strlen(Topic) + 2);
+  else
+    ChunkSize = 1;
+
+  Offset = 0;
+  do
+  {
+    if (ChunkSize > (PayloadLength - Offset)) ChunkSize = PayloadLength - Offset;
+    Client->DataCallback(Client->InpubArgument, &Data[Offset], (u16_t)ChunkSize, ((Offset + ChunkSize) >= PayloadLength) ? MQTT_DATA_FLAG_LAST : 0);
+    Offset   += ChunkSize;
+    ChunkSize = MQTT_VAR_HEADER_BUFFER_LEN;
+  } while (Offset < PayloadLength);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_mqtt_poll() */
+/* ============================================================================================================================================================= *\
+                                       Deliver the broker answers for the connect request and for all pending requests.
+\* ============================================================================================================================================================= */
+void host_mqtt_poll(mqtt_client_t *Client)
+{
+  UINT8 FlagPresent;
+  UINT8 Flags;
+  UINT8 Pending[MQTT_REQ_MAX_IN_FLIGHT];
+
+  UINT16 Index;
+  UINT16 Loop1UInt16;
+
+  struct host_request Request;
+
+
+  if (Client == NULL) return;
+
+  /* lwIP runs its callbacks with the lwIP lock held. */
+  cyw43_arch_lwip_begin();
+
+  /* Requests sent from the callbacks below are answered on next poll (next round trip), not right away. */
+  for (Loop1UInt16 = 0; Loop1UInt16 < MQTT_REQ_MAX_IN_FLIGHT; ++Loop1UInt16) Pending[Loop1UInt16] = Client->Request[Loop1UInt16].State;
+
+  if (Client->ConnState == HOST_CONN_CONNECTING)
+  {
+    if (FlagBrokerAvailable)
+    {
+      /* Broker reads the clean session flag of the CONNECT packet (after the remaining length, protocol name and protocol level). */
+      for (Index = 1; Client->output.buf[(Client->output.get + Index) % MQTT_OUTPUT_RINGBUF_SIZE] & 0x80; ++Index);
+      Flags = Client->output.buf[(Client->output.get + Index + 1 + 7) % MQTT_OUTPUT_RINGBUF_SIZE];
+      memset(&Client->output, 0x00, sizeof(Client->output));
+
+      FlagPresent = FLAG_OFF;
+      if (Flags & HOST_CONNECT_CLEAN)
+      {
+        HostSession.FlagValid = FLAG_OFF;
+      }
+      else
+      {
+        if (HostSession.FlagValid && (strcmp(HostSession.ClientId, Client->ClientId) == 0))
+          FlagPresent = FLAG_ON;
+        else
+          memset(&HostSession, 0x00, sizeof(HostSession));
+        HostSession.FlagValid = FLAG_ON;
+        strcpy(HostSession.ClientId, Client->ClientId);
+      }
+
+      /* CONNACK: fixed header, acknowledge flags, return code. */
+      Client->rx_buffer[0] = 0x20;
+      Client->rx_buffer[1] = 0x02;
+      Client->rx_buffer[2] = (FlagPresent ? HOST_CONNACK_PRESENT : 0x00);
+      Client->rx_buffer[3] = MQTT_CONNECT_ACCEPTED;
+      Client->ConnState = HOST_CONN_CONNECTED;
+      if (Client->ConnectCallback) Client->ConnectCallback(Client, Client->ConnectArgument, MQTT_CONNECT_ACCEPTED);
+
+      /* Publishes kept by the broker during the outage. */
+      for (Loop1UInt16 = 0; Loop1UInt16 < HostSession.QueueCount; ++Loop1UInt16)
+        host_mqtt_inject_publish(Client, HostSession.QueueTopic[Loop1UInt16], HostSession.QueuePayload[Loop1UInt16], HostSession.QueueLength[Loop1UInt16]);
+      HostSession.QueueCount = 0;
+    }
+    else
+    {
+      Client->ConnState = HOST_CONN_DISCONNECTED;
+      if (Client->ConnectCallback) Client->ConnectCallback(Client, Client->ConnectArgument, MQTT_CONNECT_TIMEOUT);
+    }
+  }
+
+  for (Loop1UInt16 = 0; Loop1UInt16 < MQTT_REQ_MAX_IN_FLIGHT; ++Loop1UInt16)
+  {
+    if ((Pending[Loop1UInt16] != HOST_REQUEST_PENDING) || (Client->Request[Loop1UInt16].State != HOST_REQUEST_PENDING)) continue;
+
+    /* Free the slot before calling back, so that the callback may submit a new request right away (lwIP behaves the same way). */
+    Request = Client->Request[Loop1UInt16];
+    Client->Request[Loop1UInt16].State = HOST_REQUEST_FREE;
+    if (Request.Callback) Request.Callback(Request.Argument, Request.Result);
+  }
+
+  cyw43_arch_lwip_end();
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_mqtt_request_count() */
+/* ============================================================================================================================================================= *\
+                                              Return the number of requests accepted so far by the simulated client.
+\* ============================================================================================================================================================= */
+UINT32 host_mqtt_request_count(mqtt_client_t *Client)
+{
+  return (Client ? Client->RequestCount : 0);
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_mqtt_set_broker_available() */
+/* ============================================================================================================================================================= *\
+                                              Simulate a broker that accepts or refuses new connection requests.
+\* ============================================================================================================================================================= */
+void host_mqtt_set_broker_available(UINT8 FlagAvailable)
+{
+  FlagBrokerAvailable = FlagAvailable;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_mqtt_set_output_start() */
+/* ============================================================================================================================================================= *\
+                       Simulate an output ring buffer where previous packets ended at Start: next CONNECT packets are written from there, so they
+                                                      may wrap around the end of the buffer, the same way they do in lwIP.
+\* ============================================================================================================================================================= */
+void host_mqtt_set_output_start(UINT16 Start)
+{
+  OutputStart = Start;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_output_byte() */
+/* ============================================================================================================================================================= *\
+                                                   Append one byte to the output ring buffer of a client (wraps around its end).
+\* ============================================================================================================================================================= */
+static void host_output_byte(mqtt_client_t *Client, UINT8 Byte)
+{
+  Client->output.buf[Client->output.put] = Byte;
+  Client->output.put = (Client->output.put + 1) % MQTT_OUTPUT_RINGBUF_SIZE;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_output_string() */
+/* ============================================================================================================================================================= *\
+                                                  Append a string, preceded by its 2-byte length, to the output buffer of a client.
+\* ============================================================================================================================================================= */
+static void host_output_string(mqtt_client_t *Client, const char *String)
+{
+  UINT16 Length;
+
+
+  Length = strlen(String);
+  host_output_byte(Client, Length >> 8);
+  host_output_byte(Client, Length & 0xFF);
+  while (*String) host_output_byte(Client, *String++);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_request_add() */
+/* ============================================================================================================================================================= *\
+                                              Keep track of a new request until its answer is delivered by host_mqtt_poll().
+\* ============================================================================================================================================================= */
+static err_t host_request_add(mqtt_client_t *Client, err_t Result, mqtt_request_cb_t Callback, void *Argument)
+{
+  UINT16 Loop1UInt16;
+
+
+  if ((Client == NULL) || (Client->ConnState != HOST_CONN_CONNECTED)) return ERR_CONN;
+
+  for (Loop1UInt16 = 0; Loop1UInt16 < MQTT_REQ_MAX_IN_FLIGHT; ++Loop1UInt16)
+  {
+    if (Client->Request[Loop1UInt16].State != HOST_REQUEST_FREE) continue;
+
+    Client->Request[Loop1UInt16].State    = HOST_REQUEST_PENDING;
+    Client->Request[Loop1UInt16].Result   = Result;
+    Client->Request[Loop1UInt16].Callback = Callback;
+    Client->Request[Loop1UInt16].Argument = Argument;
+    ++Client->RequestCount;
+
+    return ERR_OK;
+  }
+
+  /* All request slots are in use (same behavior as lwIP). */
+  return ERR_MEM;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_set_core_num() */
+/* ============================================================================================================================================================= *\
+                                      Select the core number returned by get_core_num() for the calling thread (the main thread is core 0).
+\* ============================================================================================================================================================= */
+void host_set_core_num(UINT32 CoreNum)
+{
+  HostCoreNum = CoreNum;
+
+  return;
+}
+
+
+
+
+
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_stdio_set_connected() */
+/* ============================================================================================================================================================= *\
+                                                   Turn On or Off the simulated USB CDC terminal connection.
+\* ============================================================================================================================================================= */
+void host_stdio_set_connected(UINT8 FlagConnected)
+{
+  FlagStdioConnected = FlagConnected;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_time_set_real_sleep() */
+/* ============================================================================================================================================================= *\
+                                         Select if sleep_ms() really sleeps or only moves the simulated time forward.
+\* ============================================================================================================================================================= */
+void host_time_set_real_sleep(UINT8 FlagSleep)
+{
+  FlagRealSleep = FlagSleep;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_time_warp_us() */
+/* ============================================================================================================================================================= *\
+                                                                 Move the simulated time forward.
+\* ============================================================================================================================================================= */
+void host_time_warp_us(UINT64 DeltaUSec)
+{
+  WarpUSec += DeltaUSec;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=host_wfe_count() */
+/* ============================================================================================================================================================= *\
+                                 Return the number of times the processor has been put to sleep by __wfe() / best_effort_wfe_or_timeout().
+\* ============================================================================================================================================================= */
+UINT32 host_wfe_count(void)
+{
+  return WfeCount;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=ip4addr_aton() */
+/* ============================================================================================================================================================= *\
+                                                  Convert an IPv4 address string to binary. Return 0 if the string is invalid.
+\* ============================================================================================================================================================= */
+int ip4addr_aton(const char *String, ip_addr_t *Address)
+{
+  struct in_addr InAddress;
+
+
+  if (inet_aton(String, &InAddress) == 0) return 0;
+  if (Address) Address->addr = InAddress.s_addr;
+
+  return 1;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=ip4addr_ntoa() */
+/* ============================================================================================================================================================= *\
+                                                   Convert a binary IPv4 address to a string (static buffer, like lwIP).
+\* ============================================================================================================================================================= */
+char *ip4addr_ntoa(const ip_addr_t *Address)
+{
+  struct in_addr InAddress;
+
+
+  InAddress.s_addr = Address->addr;
+
+  return inet_ntoa(InAddress);
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=irq_set_enabled() */
+/* ============================================================================================================================================================= *\
+                                                               Enable or disable an interrupt.
+\* ============================================================================================================================================================= */
+void irq_set_enabled(UINT Num, bool Enabled)
+{
+  if (Num < HOST_IRQ_COUNT) IrqEnabled[Num] = (Enabled ? FLAG_ON : FLAG_OFF);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=irq_set_exclusive_handler() */
+/* ============================================================================================================================================================= *\
+                                                               Set the handler of an interrupt.
+\* ============================================================================================================================================================= */
+void irq_set_exclusive_handler(UINT Num, irq_handler_t Handler)
+{
+  if (Num < HOST_IRQ_COUNT) IrqHandler[Num] = Handler;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_client_connect() */
+/* ============================================================================================================================================================= *\
+                                         Send a connect request to the simulated broker. CONNACK is delivered by host_mqtt_poll().
+\* ============================================================================================================================================================= */
+err_t mqtt_client_connect(mqtt_client_t *Client, const ip_addr_t *Address, u16_t Port, mqtt_connection_cb_t Callback, void *Argument, const struct mqtt_connect_client_info_t *ClientInfo)
+{
+  UINT8 Flags;
+
+  UINT16 Length;
+
+
+  if ((Client == NULL) || (Address == NULL) || (ClientInfo == NULL) || (ClientInfo->client_id == NULL) || (Port == 0)) return ERR_VAL;
+
+  /* CONNECT packet: lwIP always asks for a clean session. */
+  Flags  = HOST_CONNECT_CLEAN;
+  Length = 10 + 2 + strlen(ClientInfo->client_id);
+  if (ClientInfo->will_topic)
+  {
+    Flags  |= 0x04 | ((ClientInfo->will_qos & 0x03) << 3) | (ClientInfo->will_retain ? 0x20 : 0x00);
+    Length += 2 + strlen(ClientInfo->will_topic) + 2 + strlen(ClientInfo->will_msg);
+  }
+  if (ClientInfo->client_user)
+  {
+    Flags  |= 0x80;
+    Length += 2 + strlen(ClientInfo->client_user);
+  }
+  if (ClientInfo->client_pass)
+  {
+    Flags  |= 0x40;
+    Length += 2 + strlen(ClientInfo->client_pass);
+  }
+  if ((Length + 3) > MQTT_OUTPUT_RINGBUF_SIZE) return ERR_MEM;
+
+  /* lwIP returns ERR_ISCONN when already connected, the simulated client simply restarts the connection. */
+  Client->ConnState       = HOST_CONN_CONNECTING;
+  Client->ConnectCallback = Callback;
+  Client->ConnectArgument = Argument;
+  snprintf(Client->ClientId, sizeof(Client->ClientId), "%s", ClientInfo->client_id);
+
+  /* Packet waits in the output buffer until the TCP connection is established (host_mqtt_poll()). */
+  memset(&Client->output, 0x00, sizeof(Client->output));
+  Client->output.get = OutputStart % MQTT_OUTPUT_RINGBUF_SIZE;
+  Client->output.put = Client->output.get;
+  host_output_byte(Client, 0x10);
+  if (Length > 127)
+  {
+    host_output_byte(Client, (Length & 0x7F) | 0x80);
+    host_output_byte(Client, Length >> 7);
+  }
+  else
+  {
+    host_output_byte(Client, Length);
+  }
+  host_output_string(Client, "MQTT");
+  host_output_byte(Client, 0x04);  // protocol level (MQTT 3.1.1).
+  host_output_byte(Client, Flags);
+  host_output_byte(Client, ClientInfo->keep_alive >> 8);
+  host_output_byte(Client, ClientInfo->keep_alive & 0xFF);
+  host_output_string(Client, ClientInfo->client_id);
+  if (ClientInfo->will_topic)
+  {
+    host_output_string(Client, ClientInfo->will_topic);
+    host_output_string(Client, ClientInfo->will_msg);
+  }
+  if (ClientInfo->client_user) host_output_string(Client, ClientInfo->client_user);
+  if (ClientInfo->client_pass) host_output_string(Client, ClientInfo->client_pass);
+
+  return ERR_OK;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_client_free() */
+/* ============================================================================================================================================================= *\
+                                                                 Free a simulated MQTT client.
+\* ============================================================================================================================================================= */
+void mqtt_client_free(mqtt_client_t *Client)
+{
+  free(Client);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_client_is_connected() */
+/* ============================================================================================================================================================= *\
+                                                        Return 1 if the simulated client is connected to the broker.
+\* ============================================================================================================================================================= */
+u8_t mqtt_client_is_connected(mqtt_client_t *Client)
+{
+  return ((Client != NULL) && (Client->ConnState == HOST_CONN_CONNECTED));
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_client_new() */
+/* ============================================================================================================================================================= *\
+                                                                Allocate a new simulated MQTT client.
+\* ============================================================================================================================================================= */
+mqtt_client_t *mqtt_client_new(void)
+{
+  return (mqtt_client_t *)calloc(1, sizeof(mqtt_client_t));
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_disconnect() */
+/* ============================================================================================================================================================= *\
+                                               Disconnect the simulated client (lwIP does not call the connection callback in this case).
+\* ============================================================================================================================================================= */
+void mqtt_disconnect(mqtt_client_t *Client)
+{
+  if (Client == NULL) return;
+
+  Client->ConnState = HOST_CONN_DISCONNECTED;
+  memset(Client->Request, 0x00, sizeof(Client->Request));
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_publish() */
+/* ============================================================================================================================================================= *\
+                                           Publish on a topic. The publish acknowledge is delivered by host_mqtt_poll().
+\* ============================================================================================================================================================= */
+err_t mqtt_publish(mqtt_client_t *Client, const char *Topic, const void *Payload, u16_t PayloadLength, u8_t QoS, u8_t Retain, mqtt_request_cb_t Callback, void *Argument)
+{
+  if ((Topic == NULL) || (Topic[0] == '\0') || (QoS > 2) || (Retain > 1) || ((Payload == NULL) && PayloadLength)) return ERR_VAL;
+
+  return host_request_add(Client, ERR_OK, Callback, Argument);
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_set_inpub_callback() */
+/* ============================================================================================================================================================= *\
+                                                   Set the callbacks used to deliver incoming publishes to the application.
+\* ============================================================================================================================================================= */
+void mqtt_set_inpub_callback(mqtt_client_t *Client, mqtt_incoming_publish_cb_t PublishCallback, mqtt_incoming_data_cb_t DataCallback, void *Argument)
+{
+  if (Client == NULL) return;
+
+  Client->PublishCallback = PublishCallback;
+  Client->DataCallback    = DataCallback;
+  Client->InpubArgument   = Argument;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=mqtt_sub_unsub() */
+/* ============================================================================================================================================================= *\
+                                   Subscribe to or unsubscribe from a topic. SUBACK / UNSUBACK is delivered by host_mqtt_poll().
+\* ============================================================================================================================================================= */
+err_t mqtt_sub_unsub(mqtt_client_t *Client, const char *Topic, u8_t QoS, mqtt_request_cb_t Callback, void *Argument, u8_t Subscribe)
+{
+  if ((Topic == NULL) || (Topic[0] == '\0') || (QoS > 2)) return ERR_VAL;
+
+  /* A broker refuses filters where a multi-level wildcard is not the last character. */
+  if (Subscribe && strchr(Topic, '#') && (strchr(Topic, '#')[1] != '\0')) return host_request_add(Client, ERR_ABRT, Callback, Argument);
+
+  /* Subscriptions are kept in the persistent session of the client, if any. */
+  if (Subscribe && HostSession.FlagValid && mqtt_client_is_connected(Client)) ++HostSession.Subscriptions;
+
+  return host_request_add(Client, ERR_OK, Callback, Argument);
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=multicore_fifo_clear_irq() */
+/* ============================================================================================================================================================= *\
+                                           Clear the error flags of the SIO FIFOs (the simulated FIFOs have none).
+\* ============================================================================================================================================================= */
+void multicore_fifo_clear_irq(void)
+{
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=multicore_fifo_drain() */
+/* ============================================================================================================================================================= *\
+                                                Discard all data waiting in the SIO FIFO of the calling core.
+\* ============================================================================================================================================================= */
+void multicore_fifo_drain(void)
+{
+  while (multicore_fifo_rvalid()) multicore_fifo_pop_blocking();
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=multicore_fifo_pop_blocking() */
+/* ============================================================================================================================================================= *\
+                                    Read one word from the SIO FIFO of the calling core, wait for it if the FIFO is empty.
+\* ============================================================================================================================================================= */
+UINT32 multicore_fifo_pop_blocking(void)
+{
+  UINT32 Core;
+  UINT32 Data;
+
+
+  Core = HostCoreNum & 0x01;
+
+  while (__atomic_load_n(&FifoCount[Core], __ATOMIC_ACQUIRE) == 0) sched_yield();
+  Data           = Fifo[Core][FifoHead[Core]];
+  FifoHead[Core] = (FifoHead[Core] + 1) % HOST_FIFO_DEPTH;
+  __atomic_fetch_sub(&FifoCount[Core], 1, __ATOMIC_RELEASE);
+
+  return Data;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=multicore_fifo_push_blocking() */
+/* ============================================================================================================================================================= *\
+                                     Write one word to the SIO FIFO of the other core, wait for room if the FIFO is full.
+\* ============================================================================================================================================================= */
+void multicore_fifo_push_blocking(UINT32 Data)
+{
+  UINT32 Core;
+
+
+  Core = (HostCoreNum & 0x01) ^ 0x01;
+
+  while (__atomic_load_n(&FifoCount[Core], __ATOMIC_ACQUIRE) == HOST_FIFO_DEPTH) sched_yield();
+  Fifo[Core][FifoTail[Core]] = Data;
+  FifoTail[Core] = (FifoTail[Core] + 1) % HOST_FIFO_DEPTH;
+  __atomic_fetch_add(&FifoCount[Core], 1, __ATOMIC_RELEASE);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=multicore_fifo_rvalid() */
+/* ============================================================================================================================================================= *\
+                                                  Return true if the SIO FIFO of the calling core has data.
+\* ============================================================================================================================================================= */
+bool multicore_fifo_rvalid(void)
+{
+  return (__atomic_load_n(&FifoCount[HostCoreNum & 0x01], __ATOMIC_ACQUIRE) != 0);
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=multicore_fifo_wready() */
+/* ============================================================================================================================================================= *\
+                                          Return true if the SIO FIFO of the other core has room for one more word.
+\* ============================================================================================================================================================= */
+bool multicore_fifo_wready(void)
+{
+  return (__atomic_load_n(&FifoCount[(HostCoreNum & 0x01) ^ 0x01], __ATOMIC_ACQUIRE) < HOST_FIFO_DEPTH);
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=restore_interrupts() */
+/* ============================================================================================================================================================= *\
+                                           Restore the interrupts state returned by save_and_disable_interrupts() (nothing to do on the host).
+\* ============================================================================================================================================================= */
+void restore_interrupts(UINT32 Status)
+{
+  return;
+}
+
+
+
+
+
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=rtc_get_datetime() */
+/* ============================================================================================================================================================= *\
+                                                                Read the simulated real-time clock.
+\* ============================================================================================================================================================= */
+void rtc_get_datetime(datetime_t *DateTime)
+{
+  struct tm TimeStruct;
+
+  time_t Epoch;
+
+
+  Epoch = RtcEpoch + (time_t)((time_us_64() - RtcSetTime) / 1000000ull);
+  gmtime_r(&Epoch, &TimeStruct);
+
+  DateTime->year  = TimeStruct.tm_year + 1900;
+  DateTime->month = TimeStruct.tm_mon  + 1;
+  DateTime->day   = TimeStruct.tm_mday;
+  DateTime->dotw  = TimeStruct.tm_wday;
+  DateTime->hour  = TimeStruct.tm_hour;
+  DateTime->min   = TimeStruct.tm_min;
+  DateTime->sec   = TimeStruct.tm_sec;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=rtc_init() */
+/* ============================================================================================================================================================= *\
+                                                             Initialize the simulated real-time clock.
+\* ============================================================================================================================================================= */
+void rtc_init(void)
+{
+  RtcEpoch   = 0;
+  RtcSetTime = time_us_64();
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=rtc_set_datetime() */
+/* ============================================================================================================================================================= *\
+                                                                 Set the simulated real-time clock.
+\* ============================================================================================================================================================= */
+void rtc_set_datetime(datetime_t *DateTime)
+{
+  struct tm TimeStruct;
+
+
+  memset(&TimeStruct, 0x00, sizeof(TimeStruct));
+  TimeStruct.tm_year = DateTime->year  - 1900;
+  TimeStruct.tm_mon  = DateTime->month - 1;
+  TimeStruct.tm_mday = DateTime->day;
+  TimeStruct.tm_hour = DateTime->hour;
+  TimeStruct.tm_min  = DateTime->min;
+  TimeStruct.tm_sec  = DateTime->sec;
+
+  RtcEpoch   = timegm(&TimeStruct);
+  RtcSetTime = time_us_64();
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=save_and_disable_interrupts() */
+/* ============================================================================================================================================================= *\
+            Disable the interrupts of the calling core and return their previous state. There are no interrupts on the host: each simulated core is a
+                                                        thread, so nothing can preempt it from its own core.
+\* ============================================================================================================================================================= */
+UINT32 save_and_disable_interrupts(void)
+{
+  return 0;
+}
+
+
+
+
+
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sleep_ms() */
+/* ============================================================================================================================================================= *\
+                                                       Sleep (or move the simulated time forward) for a number of msec.
+\* ============================================================================================================================================================= */
+void sleep_ms(UINT32 MSec)
+{
+  sleep_us((UINT64)MSec * 1000ull);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=sleep_us() */
+/* ============================================================================================================================================================= *\
+                                                       Sleep (or move the simulated time forward) for a number of usec.
+\* ============================================================================================================================================================= */
+void sleep_us(UINT64 USec)
+{
+  struct timespec Delay;
+
+
+  if (FlagRealSleep == FLAG_OFF)
+  {
+    WarpUSec += USec;
+    return;
+  }
+
+  Delay.tv_sec  = USec / 1000000ull;
+  Delay.tv_nsec = (USec % 1000000ull) * 1000ull;
+  nanosleep(&Delay, NULL);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=stdio_init_all() */
+/* ============================================================================================================================================================= *\
+                                                                Nothing to initialize on the host.
+\* ============================================================================================================================================================= */
+void stdio_init_all(void)
+{
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=stdio_usb_connected() */
+/* ============================================================================================================================================================= *\
+                                                     Return the state of the simulated USB CDC terminal connection.
+\* ============================================================================================================================================================= */
+UINT8 stdio_usb_connected(void)
+{
+  return FlagStdioConnected;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=time_us_64() */
+/* ============================================================================================================================================================= *\
+                                              Return the number of usec since the first call, including the simulated time.
+\* ============================================================================================================================================================= */
+UINT64 time_us_64(void)
+{
+  struct timespec Now;
+
+  UINT64 Monotonic;
+
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  Monotonic = ((UINT64)Now.tv_sec * 1000000ull) + ((UINT64)Now.tv_nsec / 1000ull);
+  if (MonotonicBase == 0) MonotonicBase = Monotonic;
+
+  return (Monotonic - MonotonicBase) + WarpUSec;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=watchdog_update() */
+/* ============================================================================================================================================================= *\
+                                                                   There is no watchdog on the host.
+\* ============================================================================================================================================================= */
+void watchdog_update(void)
+{
+  return;
+}
@@ -0,0 +1,277 @@
+/* ============================================================================================================================================================= *\
+   Pico-Host-Platform.h
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   Revision 16-OCT-2026
+   Langage: C
+
+   Linux host replacement for the few Raspberry Pi Pico SDK and lwIP services used by Pico-MQTT-Module.
+   This allows the real module source code to be compiled, profiled and load-tested on a Linux box, without a Pico W.
+   The header files found under host/hardware, host/pico and host/lwip simply include this file, so that the original
+   #include directives of the module do not need to be changed.
+\* ============================================================================================================================================================= */
+
+#ifndef __PICO_HOST_PLATFORM_H
+#define __PICO_HOST_PLATFORM_H
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                      Include files.
+\* ============================================================================================================================================================= */
+#include <ctype.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "baseline.h"
+
+
+
+/* $PAGE */
+/* $TITLE=Definitions. */
+/* ============================================================================================================================================================= *\
+                                                                        Definitions.
+\* ============================================================================================================================================================= */
+#define PICO_MQTT_HOST                   1  // indicate that we are building for a Linux host instead of a Pico.
+#define PICO_ERROR_TIMEOUT              -1  // same value as the Pico SDK.
+#define SIO_IRQ_PROC0                   15  // SIO FIFO interrupt of core 0 (RP2040 numbering).
+#define SIO_IRQ_PROC1                   16  // SIO FIFO interrupt of core 1 (RP2040 numbering).
+#define HOST_FIFO_DEPTH                  8  // depth of each SIO FIFO (RP2040, the RP2350 has 4).
+#define HOST_IRQ_COUNT                  32  // number of interrupts of the simulated processor.
+
+/* lwIP compatible basic types and error codes. */
+typedef uint8_t  u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t   err_t;
+
+#define ERR_OK                           0  // no error, everything OK.
+#define ERR_MEM                         -1  // out of memory error (also returned when all request slots are in use).
+#define ERR_TIMEOUT                     -3  // timeout.
+#define ERR_INPROGRESS                  -5  // operation in progress.
+#define ERR_VAL                         -6  // illegal value.
+#define ERR_CONN                       -11  // not connected.
+#define ERR_ABRT                       -13  // connection aborted (also used for a refused subscription).
+
+/* lwIP MQTT client default parameters (see lwip/apps/mqtt_opts.h). */
+#define MQTT_REQ_MAX_IN_FLIGHT           4  // maximum number of pending subscribe, unsubscribe and publish requests to server.
+#define MQTT_VAR_HEADER_BUFFER_LEN     128  // size of the receive buffer, incoming payloads larger than this are delivered in several chunks.
+#define MQTT_DATA_FLAG_LAST              1  // flag set on the last chunk of an incoming payload.
+#define MQTT_OUTPUT_RINGBUF_SIZE       256  // size of the output ring buffer (outgoing packets wait there until TCP sends them).
+
+
+
+/* $PAGE */
+/* $TITLE=Variable definitions. */
+/* ============================================================================================================================================================= *\
+                                                                      Variable definitions.
+\* ============================================================================================================================================================= */
+/* Pico SDK date and time structure. */
+typedef struct
+{
+  int16_t year;
+  int8_t  month;
+  int8_t  day;
+  int8_t  dotw;   // 0 is Sunday.
+  int8_t  hour;
+  int8_t  min;
+  int8_t  sec;
+} datetime_t;
+
+
+/* Pico SDK absolute time (usec since boot). */
+typedef UINT64 absolute_time_t;
+
+
+/* Pico SDK interrupt handler. */
+typedef void (*irq_handler_t)(void);
+
+
+/* Pico SDK critical section (spin lock + interrupts disabled on the Pico, mutex on the host). */
+typedef struct
+{
+  pthread_mutex_t Mutex;
+  UINT8           FlagInitialized;
+} critical_section_t;
+
+
+/* lwIP IPv4 address. */
+typedef struct
+{
+  u32_t addr;
+} ip_addr_t;
+
+
+/* lwIP MQTT client. */
+typedef enum
+{
+  MQTT_CONNECT_ACCEPTED                 = 0,
+  MQTT_CONNECT_REFUSED_PROTOCOL_VERSION = 1,
+  MQTT_CONNECT_REFUSED_IDENTIFIER       = 2,
+  MQTT_CONNECT_REFUSED_SERVER           = 3,
+  MQTT_CONNECT_REFUSED_USERNAME_PASS    = 4,
+  MQTT_CONNECT_REFUSED_NOT_AUTHORIZED_  = 5,
+  MQTT_CONNECT_DISCONNECTED             = 256,
+  MQTT_CONNECT_TIMEOUT                  = 257
+} mqtt_connection_status_t;
+
+typedef struct mqtt_client_s mqtt_client_t;
+
+typedef void (*mqtt_connection_cb_t)(mqtt_client_t *client, void *arg, mqtt_connection_status_t status);
+typedef void (*mqtt_incoming_publish_cb_t)(void *arg, const char *topic, u32_t tot_len);
+typedef void (*mqtt_incoming_data_cb_t)(void *arg, const u8_t *data, u16_t len, u8_t flags);
+typedef void (*mqtt_request_cb_t)(void *arg, err_t err);
+
+struct mqtt_connect_client_info_t
+{
+  const char *client_id;
+  const char *client_user;
+  const char *client_pass;
+  u16_t       keep_alive;
+  const char *will_topic;
+  const char *will_msg;
+  u8_t        will_qos;
+  u8_t        will_retain;
+};
+
+/* lwIP MQTT client private structures (lwip/apps/mqtt_priv.h): only the members used by Pico-MQTT-Module have the same name as in lwIP. */
+struct host_request
+{
+  UINT8             State;
+  err_t             Result;
+  mqtt_request_cb_t Callback;
+  void             *Argument;
+};
+
+struct mqtt_ringbuf_t
+{
+  u16_t put;
+  u16_t get;
+  u8_t  buf[MQTT_OUTPUT_RINGBUF_SIZE];
+};
+
+struct mqtt_client_s
+{
+  UINT8                      ConnState;
+  mqtt_connection_cb_t       ConnectCallback;
+  void                      *ConnectArgument;
+  mqtt_incoming_publish_cb_t PublishCallback;
+  mqtt_incoming_data_cb_t    DataCallback;
+  void                      *InpubArgument;
+  UINT32                     RequestCount;
+  UCHAR                      ClientId[64];
+  struct host_request        Request[MQTT_REQ_MAX_IN_FLIGHT];
+  u8_t                       rx_buffer[MQTT_VAR_HEADER_BUFFER_LEN];  // fixed and variable header of the last packet received (ex: CONNACK).
+  struct mqtt_ringbuf_t      output;                                 // packets waiting to be sent (ex: CONNECT, until TCP connection is established).
+};
+
+
+
+/* $PAGE */
+/* $TITLE=Function prototypes. */
+/* ============================================================================================================================================================= *\
+                                                                     Function prototypes.
+\* ============================================================================================================================================================= */
+/* ----------------------------- Pico SDK replacement (pico/stdlib.h, pico/multicore.h, pico/cyw43_arch.h, hardware/irq.h, hardware/rtc.h). -------------------- */
+void   __dmb(void);
+UINT   __get_current_exception(void);
+void   __sev(void);
+void   __wfe(void);
+UINT8  best_effort_wfe_or_timeout(absolute_time_t Timeout);
+void   critical_section_enter_blocking(critical_section_t *CriticalSection);
+void   critical_section_exit(critical_section_t *CriticalSection);
+void   critical_section_init(critical_section_t *CriticalSection);
+UINT8  critical_section_is_initialized(critical_section_t *CriticalSection);
+void   cyw43_arch_lwip_begin(void);
+void   cyw43_arch_lwip_end(void);
+absolute_time_t from_us_since_boot(UINT64 USec);
+UINT32 get_core_num(void);
+INT32  getchar_timeout_us(UINT32 TimeOutUSec);
+void   irq_set_enabled(UINT Num, bool Enabled);
+void   irq_set_exclusive_handler(UINT Num, irq_handler_t Handler);
+void   multicore_fifo_clear_irq(void);
+void   multicore_fifo_drain(void);
+UINT32 multicore_fifo_pop_blocking(void);
+void   multicore_fifo_push_blocking(UINT32 Data);
+bool   multicore_fifo_rvalid(void);
+bool   multicore_fifo_wready(void);
+void   restore_interrupts(UINT32 Status);
+void   rtc_get_datetime(datetime_t *DateTime);
+void   rtc_init(void);
+void   rtc_set_datetime(datetime_t *DateTime);
+UINT32 save_and_disable_interrupts(void);
+void   sleep_ms(UINT32 MSec);
+void   sleep_us(UINT64 USec);
+void   stdio_init_all(void);
+UINT8  stdio_usb_connected(void);
+UINT64 time_us_64(void);
+void   watchdog_update(void);
+
+
+/* -------------------------------------------------------- lwIP replacement (lwip/ip_addr.h, lwip/apps/mqtt.h). ----------------------------------------------- */
+int    ip4addr_aton(const char *String, ip_addr_t *Address);
+char  *ip4addr_ntoa(const ip_addr_t *Address);
+
+#define ip_addr_isany(Address)  (((Address) == NULL) || ((Address)->addr == 0))
+
+err_t          mqtt_client_connect(mqtt_client_t *Client, const ip_addr_t *Address, u16_t Port, mqtt_connection_cb_t Callback, void *Argument, const struct mqtt_connect_client_info_t *ClientInfo);
+void           mqtt_client_free(mqtt_client_t *Client);
+u8_t           mqtt_client_is_connected(mqtt_client_t *Client);
+mqtt_client_t *mqtt_client_new(void);
+void           mqtt_disconnect(mqtt_client_t *Client);
+err_t          mqtt_publish(mqtt_client_t *Client, const char *Topic, const void *Payload, u16_t PayloadLength, u8_t QoS, u8_t Retain, mqtt_request_cb_t Callback, void *Argument);
+void           mqtt_set_inpub_callback(mqtt_client_t *Client, mqtt_incoming_publish_cb_t PublishCallback, mqtt_incoming_data_cb_t DataCallback, void *Argument);
+err_t          mqtt_sub_unsub(mqtt_client_t *Client, const char *Topic, u8_t QoS, mqtt_request_cb_t Callback, void *Argument, u8_t Subscribe);
+
+#define mqtt_subscribe(client, topic, qos, cb, arg)  mqtt_sub_unsub(client, topic, qos, cb, arg, 1)
+#define mqtt_unsubscribe(client, topic, cb, arg)     mqtt_sub_unsub(client, topic, 0, cb, arg, 0)
+
+
+/* --------------------------------------------------------- Host simulation controls (not part of any Pico API). ----------------------------------------------- */
+/* Wait until the SIO FIFO of the calling core has data, then run its interrupt handler if it is enabled (simulates an interrupt on an idle core). */
+void host_irq_wait(void);
+
+/* Simulate a broker that accepts (FLAG_ON) or refuses (FLAG_OFF) new connections. */
+void host_mqtt_set_broker_available(UINT8 FlagAvailable);
+
+/* Simulate an output ring buffer where previous packets ended at Start (next CONNECT packets wrap around the end of the buffer when Start is near it). */
+void host_mqtt_set_output_start(UINT16 Start);
+
+/* Simulate a broker that has lost its persistent sessions (ex: restarted without persistence). */
+void host_mqtt_clear_sessions(void);
+
+/* Simulate the loss of the connection with the broker. */
+void host_mqtt_drop_connection(mqtt_client_t *Client);
+
+/* Simulate the reception of a publish from the broker (payload is delivered in chunks, the same way lwIP does). While the client is
+   disconnected, the publish is kept by the broker if the client has a persistent session with subscriptions, and delivered after CONNACK. */
+void host_mqtt_inject_publish(mqtt_client_t *Client, const char *Topic, const void *Payload, u32_t PayloadLength);
+
+/* Deliver pending CONNACK and request completions, the same way lwIP would when the answers come back from the broker. */
+void host_mqtt_poll(mqtt_client_t *Client);
+
+/* Return the total number of publish and subscribe / unsubscribe requests accepted so far by the simulated client. */
+UINT32 host_mqtt_request_count(mqtt_client_t *Client);
+
+/* Return the number of times the processor has been put to sleep by __wfe() / best_effort_wfe_or_timeout(). */
+UINT32 host_wfe_count(void);
+
+/* Select the core number returned by get_core_num() for the calling thread (simulates a function running on core 1). */
+void host_set_core_num(UINT32 CoreNum);
+
+/* Turn On or Off the simulated USB CDC terminal connection (log_printf() output is bypassed when no terminal is connected). */
+void host_stdio_set_connected(UINT8 FlagConnected);
+
+/* Select if sleep_ms() really sleeps (FLAG_ON) or only moves the simulated time forward (FLAG_OFF, default). */
+void host_time_set_real_sleep(UINT8 FlagSleep);
+
+/* Move the simulated time forward (time_us_64() and the real-time clock both follow). */
+void host_time_warp_us(UINT64 DeltaUSec);
+
+#endif  // __PICO_HOST_PLATFORM_H
@@ -0,0 +1,7 @@
+/* Host replacement for <hardware/gpio.h> (see Pico-Host-Platform.h). */
+#ifndef __HOST_HARDWARE_GPIO_H
+#define __HOST_HARDWARE_GPIO_H
+
+#include "Pico-Host-Platform.h"
+
+#endif  // __HOST_HARDWARE_GPIO_H
@@ -0,0 +1,7 @@
+/* Host replacement for <hardware/sync.h> (see Pico-Host-Platform.h). */
+#ifndef __HOST_HARDWARE_SYNC_H
+#define __HOST_HARDWARE_SYNC_H
+
+#include "Pico-Host-Platform.h"
+
+#endif  // __HOST_HARDWARE_SYNC_H
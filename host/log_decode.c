@@ -0,0 +1,589 @@
+/* ============================================================================================================================================================= *\
+   log_decode.c
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   Revision 16-OCT-2026
+   Langage: C
+
+   Linux decoder for the binary log records of log_printf() (LOG_MODE_BINARY, see log_binary() in log_printf.c).
+
+   Usage: log_decode <Firmware ELF file> [binary log capture]   (the capture is read from stdin when no file name is given)
+
+   Each record gives the address of its format string and of its function name, relative to the address of log_printf(). They are found in the
+   ELF file (Pico-MQTT-Example.elf for the Pico, or mqtt_host_bench for the host build) and the line is formatted here, on the Linux computer.
+   Bytes that are not part of a record (plain printf() output of the Firmware) are copied as is.
+   NOTE: The ELF file must be the one that has been flashed, and it must not be stripped (log_printf symbol is needed). Format strings built
+         at run time (not in the Firmware image) cannot be decoded.
+\* ============================================================================================================================================================= */
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                          Include files
+\* ============================================================================================================================================================= */
+#include <elf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "baseline.h"
+
+
+
+/* $PAGE */
+/* $TITLE=Definitions and macros. */
+/* ============================================================================================================================================================= *\
+                                                                       Definitions and macros.
+\* ============================================================================================================================================================= */
+#define LOG_BINARY_SYNC    0xA0  // must be the same as in log_printf.c.
+#define LOG_BINARY_HEADER    16  // must be the same as in log_printf.c.
+#define MAX_SECTIONS        128  // maximum number of ELF sections kept.
+#define FUNCTION_SIZE        25  // space reserved for the function name, including the two "[]" (the same as log_printf()).
+
+
+/* ELF section header, 32-bit (Pico) or 64-bit (host build) format. */
+struct elf_header
+{
+  UINT32 Type;
+  UINT32 Link;
+  UINT64 Flags;
+  UINT64 Address;
+  UINT64 Offset;
+  UINT64 Size;
+  UINT64 EntrySize;
+};
+
+/* ELF section holding data of the Firmware image (ex: .rodata, .data). */
+struct elf_section
+{
+  UINT64 Address;
+  UINT64 Size;
+  UINT64 Offset;
+};
+
+
+
+/* $PAGE */
+/* $TITLE=Global variables declaration / definition. */
+/* ============================================================================================================================================================= *\
+                                                            Global variables declaration / definition.
+\* ============================================================================================================================================================= */
+static UCHAR *ElfImage;                          // the whole ELF file.
+static UINT64 ElfSize;
+static UINT8  FlagElf64;                         // 64-bit ELF file (host build).
+static UINT8  LongSize;                          // size of long and pointer arguments on the target (4 for the Pico, 8 for a 64-bit host).
+static UINT64 LogPrintfAddress;                  // address of log_printf() in the ELF file.
+static UINT16 SectionCount;
+static struct elf_section Section[MAX_SECTIONS];
+
+static UINT8  FlagTimeValid;
+static UINT32 LastTimestamp;
+static UINT64 Time;                              // time_us_64() of the last record (lower 32 bits wrap around every 71 minutes).
+
+
+
+/* $PAGE */
+/* $TITLE=Function prototypes. */
+/* ============================================================================================================================================================= *\
+                                                                     Function prototypes.
+\* ============================================================================================================================================================= */
+/* Read a section header of the ELF file. Return 0 if OK or -1 if out of the file. */
+static INT16 elf_header(UINT16 Index, struct elf_header *Header);
+
+/* Load the ELF file and find the address of log_printf(). */
+static INT16 elf_load(const char *FileName);
+
+/* Return the string at <Offset> from log_printf() in the Firmware image. */
+static const UCHAR *elf_string(INT32 Offset);
+
+/* Display one binary log record. */
+static void log_decode(const UCHAR *Record);
+
+/* Format the text of a record from its format string and its raw arguments. */
+static void log_format(const UCHAR *Format, const UCHAR *Argument, UINT ArgumentLength, UCHAR *Text, UINT TextSize);
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=main() */
+/* ============================================================================================================================================================= *\
+                                                                          Main program entry point.
+\* ============================================================================================================================================================= */
+int main(int argc, char *argv[])
+{
+  UCHAR Record[LOG_BINARY_HEADER + 256];
+
+  INT Character;
+
+  FILE *Input;
+
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <Firmware ELF file> [binary log capture]\n", argv[0]);
+    return 1;
+  }
+  if (elf_load(argv[1])) return 1;
+
+  Input = stdin;
+  if (argc > 2) Input = fopen(argv[2], "rb");
+  if (Input == NULL)
+  {
+    fprintf(stderr, "Unable to open log capture <%s>.\n", argv[2]);
+    return 1;
+  }
+
+  while ((Character = getc(Input)) != EOF)
+  {
+    /* Plain text between records is copied as is. */
+    if ((Character & 0xF0) != LOG_BINARY_SYNC)
+    {
+      putchar(Character);
+      continue;
+    }
+
+    Record[0] = Character;
+    if (fread(&Record[1], 1, LOG_BINARY_HEADER - 1, Input) != (LOG_BINARY_HEADER - 1)) break;
+    if (fread(&Record[LOG_BINARY_HEADER], 1, Record[1], Input) != Record[1]) break;
+    log_decode(Record);
+  }
+  if (Input != stdin) fclose(Input);
+
+  return 0;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=elf_header() */
+/* ============================================================================================================================================================= *\
+                                         Read a section header of the ELF file, 32-bit or 64-bit. Return 0 if OK or -1 if it is out of the file.
+\* ============================================================================================================================================================= */
+static INT16 elf_header(UINT16 Index, struct elf_header *Header)
+{
+  UINT64 Offset;
+
+  Elf32_Shdr *Header32;
+  Elf64_Shdr *Header64;
+
+
+  if (FlagElf64)
+  {
+    Offset = ((Elf64_Ehdr *)ElfImage)->e_shoff + ((UINT64)Index * ((Elf64_Ehdr *)ElfImage)->e_shentsize);
+    if ((Offset + sizeof(Elf64_Shdr)) > ElfSize) return -1;
+    Header64 = (Elf64_Shdr *)&ElfImage[Offset];
+    Header->Type      = Header64->sh_type;
+    Header->Link      = Header64->sh_link;
+    Header->Flags     = Header64->sh_flags;
+    Header->Address   = Header64->sh_addr;
+    Header->Offset    = Header64->sh_offset;
+    Header->Size      = Header64->sh_size;
+    Header->EntrySize = Header64->sh_entsize;
+  }
+  else
+  {
+    Offset = ((Elf32_Ehdr *)ElfImage)->e_shoff + ((UINT64)Index * ((Elf32_Ehdr *)ElfImage)->e_shentsize);
+    if ((Offset + sizeof(Elf32_Shdr)) > ElfSize) return -1;
+    Header32 = (Elf32_Shdr *)&ElfImage[Offset];
+    Header->Type      = Header32->sh_type;
+    Header->Link      = Header32->sh_link;
+    Header->Flags     = Header32->sh_flags;
+    Header->Address   = Header32->sh_addr;
+    Header->Offset    = Header32->sh_offset;
+    Header->Size      = Header32->sh_size;
+    Header->EntrySize = Header32->sh_entsize;
+  }
+
+  /* Section without data in the file (ex: .bss). */
+  if (Header->Type == SHT_NOBITS) Header->Size = 0;
+  if ((Header->Offset + Header->Size) > ElfSize) return -1;
+
+  return 0;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=elf_load() */
+/* ============================================================================================================================================================= *\
+                               Load the ELF file, keep the sections having data in the Firmware image and find the address of log_printf().
+                                                                 Return 0 if OK or -1 on error.
+\* ============================================================================================================================================================= */
+static INT16 elf_load(const char *FileName)
+{
+  UCHAR *Name;
+
+  UINT16 HeaderCount;
+  UINT16 Loop1UInt16;
+
+  UINT64 Loop1UInt64;
+  UINT64 SymbolOffset;
+  UINT64 Value;
+
+  struct elf_header Header;
+  struct elf_header Names;
+
+  FILE *Input;
+
+
+  Input = fopen(FileName, "rb");
+  if (Input == NULL)
+  {
+    fprintf(stderr, "Unable to open ELF file <%s>.\n", FileName);
+    return -1;
+  }
+  fseek(Input, 0, SEEK_END);
+  ElfSize = ftell(Input);
+  fseek(Input, 0, SEEK_SET);
+  ElfImage = malloc(ElfSize + 1);
+  if ((ElfImage == NULL) || (fread(ElfImage, 1, ElfSize, Input) != ElfSize) || (ElfSize < sizeof(Elf64_Ehdr)) || (memcmp(ElfImage, ELFMAG, SELFMAG)))
+  {
+    fprintf(stderr, "<%s> is not an ELF file.\n", FileName);
+    fclose(Input);
+    return -1;
+  }
+  fclose(Input);
+  ElfImage[ElfSize] = '\0';  // no string may go past the end of the file.
+
+  FlagElf64   = (ElfImage[EI_CLASS] == ELFCLASS64);
+  LongSize    = (FlagElf64 ? 8 : 4);
+  HeaderCount = (FlagElf64 ? ((Elf64_Ehdr *)ElfImage)->e_shnum : ((Elf32_Ehdr *)ElfImage)->e_shnum);
+
+  for (Loop1UInt16 = 0; Loop1UInt16 < HeaderCount; ++Loop1UInt16)
+  {
+    if (elf_header(Loop1UInt16, &Header)) continue;
+
+    /* Sections of the Firmware image: format strings, function names and other constant strings are found there. */
+    if ((Header.Type == SHT_PROGBITS) && (Header.Flags & SHF_ALLOC) && (SectionCount < MAX_SECTIONS))
+    {
+      Section[SectionCount].Address = Header.Address;
+      Section[SectionCount].Size    = Header.Size;
+      Section[SectionCount].Offset  = Header.Offset;
+      ++SectionCount;
+    }
+
+    /* Symbol table: find log_printf() (its names are in the string table of the <Link> section). */
+    if ((Header.Type != SHT_SYMTAB) || (Header.EntrySize == 0) || (elf_header(Header.Link, &Names))) continue;
+    for (Loop1UInt64 = 0; Loop1UInt64 < (Header.Size / Header.EntrySize); ++Loop1UInt64)
+    {
+      SymbolOffset = Header.Offset + (Loop1UInt64 * Header.EntrySize);
+      if (FlagElf64)
+      {
+        Name  = &ElfImage[Names.Offset + ((Elf64_Sym *)&ElfImage[SymbolOffset])->st_name];
+        Value = ((Elf64_Sym *)&ElfImage[SymbolOffset])->st_value;
+      }
+      else
+      {
+        Name  = &ElfImage[Names.Offset + ((Elf32_Sym *)&ElfImage[SymbolOffset])->st_name];
+        Value = ((Elf32_Sym *)&ElfImage[SymbolOffset])->st_value;
+      }
+      if ((Name < &ElfImage[ElfSize]) && (strcmp(Name, "log_printf") == 0) && (Value)) LogPrintfAddress = Value;
+    }
+  }
+
+  if (LogPrintfAddress == 0)
+  {
+    fprintf(stderr, "Symbol log_printf not found in <%s> (ELF file must not be stripped).\n", FileName);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=elf_string() */
+/* ============================================================================================================================================================= *\
+                             Return the string found at <Offset> from log_printf() in the Firmware image, or NULL if there is no string there.
+\* ============================================================================================================================================================= */
+static const UCHAR *elf_string(INT32 Offset)
+{
+  UINT16 Loop1UInt16;
+
+  UINT64 Address;
+
+
+  Address = LogPrintfAddress + (INT64)Offset;
+  for (Loop1UInt16 = 0; Loop1UInt16 < SectionCount; ++Loop1UInt16)
+  {
+    if ((Address >= Section[Loop1UInt16].Address) && (Address < (Section[Loop1UInt16].Address + Section[Loop1UInt16].Size)))
+      return &ElfImage[Section[Loop1UInt16].Offset + (Address - Section[Loop1UInt16].Address)];
+  }
+
+  return NULL;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=log_decode() */
+/* ============================================================================================================================================================= *\
+                        Display one binary log record with the same extra parameters as log_printf() in text mode (line number, core, time and function
+                                name), except that time is the time since power up (time_us_64()) instead of the real-time clock.
+\* ============================================================================================================================================================= */
+static void log_decode(const UCHAR *Record)
+{
+  UCHAR Function[FUNCTION_SIZE + 1];
+  UCHAR Text[1024];
+
+  const UCHAR *Format;
+  const UCHAR *FunctionName;
+  const UCHAR *Start;
+
+  UINT LineSize;
+  UINT Loop1UInt;
+
+  INT32 Offset;
+
+  UINT32 Timestamp;
+
+
+  memcpy(&Offset, &Record[4], sizeof(Offset));
+  Format = elf_string(Offset);
+  memcpy(&Offset, &Record[8], sizeof(Offset));
+  FunctionName = elf_string(Offset);
+  if (FunctionName == NULL) FunctionName = "?";
+  memcpy(&Timestamp, &Record[12], sizeof(Timestamp));
+
+  /* Rebuild the 64-bit time stamp from its lower 32 bits (records of both cores are close in time). */
+  if (FlagTimeValid == FLAG_OFF) Time = Timestamp;
+  else                           Time += (INT64)(INT32)(Timestamp - LastTimestamp);
+  FlagTimeValid = FLAG_ON;
+  LastTimestamp = Timestamp;
+
+  if (Format == NULL)
+  {
+    printf("[%5u %u] [%6llu.%6.6llu] [%s] - (format string not found in ELF file)\n", Record[2] + (Record[3] << 8), Record[0] & 0x0F, Time / 1000000, Time % 1000000, FunctionName);
+    return;
+  }
+  log_format(Format, &Record[LOG_BINARY_HEADER], Record[1], Text, sizeof(Text));
+
+  /* Special strings of log_printf(). */
+  if ((!strcmp(Text, "home")) || (!strcmp(Text, "HOME")))
+  {
+    printf("\x1B[H");
+    return;
+  }
+  if ((!strcmp(Text, "cls")) || (!strcmp(Text, "CLS")))
+  {
+    for (Loop1UInt = 0; Loop1UInt < 80; ++Loop1UInt) putchar('\n');
+    printf("\x1B[2J");
+    return;
+  }
+  if ((Text[0] == '\n') || (Text[0] == 0x1B))
+  {
+    printf("%s", Text);
+    return;
+  }
+
+  /* Function name, truncated with a tilde <~> when too long, the same as log_printf(). */
+  if (snprintf(Function, sizeof(Function), "[%s]", FunctionName) > FUNCTION_SIZE)
+  {
+    Function[FUNCTION_SIZE - 2] = '~';
+    Function[FUNCTION_SIZE - 1] = ']';
+  }
+  printf("[%5u %u] [%6llu.%6.6llu] %-*s- ", Record[2] + (Record[3] << 8), Record[0] & 0x0F, Time / 1000000, Time % 1000000, FUNCTION_SIZE, Function);
+
+  /* <xxx> heading: center the text on a line of xxx characters. */
+  Start    = Text;
+  LineSize = 0;
+  if ((Text[0] == '<') && (strchr(Text, '>')) && (((UCHAR *)strchr(Text, '>') - Text) < 6))
+  {
+    LineSize = atoi(&Text[1]);
+    Start    = strchr(Text, '>') + 1;
+  }
+  if ((LineSize > 5) && (LineSize < 200) && (LineSize > strlen(Start))) printf("%*s", (INT)(LineSize - strlen(Start) + 1) / 2, "");
+  printf("%s", Start);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=log_format() */
+/* ============================================================================================================================================================= *\
+              Format the text of a record from its format string and its raw arguments (same result as vsnprintf() on the target). When arguments are
+                    missing from the record (more than LOG_BINARY_ARGS bytes on the target), the rest of the format string is copied as is.
+\* ============================================================================================================================================================= */
+static void log_format(const UCHAR *Format, const UCHAR *Argument, UINT ArgumentLength, UCHAR *Text, UINT TextSize)
+{
+  UCHAR Spec[48];
+  UCHAR String[256];
+
+  const UCHAR *Scan;
+  const UCHAR *SpecStart;
+
+  UINT8 FlagMissing;
+  UINT8 LongCount;
+  UINT8 Size;
+
+  UINT Length;
+  UINT SpecLength;
+  UINT Used;
+
+  INT32 Star;
+
+  UINT64 Value;
+
+  DOUBLE Double;
+
+
+  Length      = 0;
+  Used        = 0;
+  FlagMissing = FLAG_OFF;
+  for (Scan = Format; (*Scan) && (Length < (TextSize - 1)); ++Scan)
+  {
+    if (*Scan != '%')
+    {
+      Text[Length++] = *Scan;
+      continue;
+    }
+    if (Scan[1] == '%')
+    {
+      Text[Length++] = '%';
+      ++Scan;
+      continue;
+    }
+
+    /* Rebuild the conversion specification, with each '*' replaced by its argument. */
+    SpecStart  = Scan;
+    SpecLength = 0;
+    Spec[SpecLength++] = *Scan++;
+    for (; (*Scan) && (strchr("-+ #0123456789.*", *Scan)) && (SpecLength < (sizeof(Spec) - 16)); ++Scan)
+    {
+      if (*Scan != '*')
+      {
+        Spec[SpecLength++] = *Scan;
+        continue;
+      }
+      if ((Used + sizeof(Star)) > ArgumentLength)
+      {
+        FlagMissing = FLAG_ON;
+        break;
+      }
+      memcpy(&Star, &Argument[Used], sizeof(Star));
+      Used += sizeof(Star);
+      SpecLength += sprintf(&Spec[SpecLength], "%d", Star);
+    }
+
+    /* Length modifiers: the value is always given to snprintf() as a long long. */
+    LongCount = 0;
+    for (; (*Scan) && (strchr("hlzj", *Scan)); ++Scan)
+    {
+      if ((*Scan == 'l') || (*Scan == 'z')) ++LongCount;
+      if (*Scan == 'j') LongCount = 2;
+    }
+
+    switch (*Scan)
+    {
+      case ('d'):
+      case ('i'):
+      case ('o'):
+      case ('u'):
+      case ('x'):
+      case ('X'):
+      case ('c'):
+      case ('p'):
+        Size = (LongCount >= 2) ? 8 : (((LongCount == 1) || (*Scan == 'p')) ? LongSize : 4);
+        if ((FlagMissing) || ((Used + Size) > ArgumentLength))
+        {
+          FlagMissing = FLAG_ON;
+          break;
+        }
+        Value = 0;
+        memcpy(&Value, &Argument[Used], Size);
+        Used += Size;
+
+        if (*Scan == 'c')
+        {
+          strcpy(&Spec[SpecLength], "c");
+          Length += snprintf(&Text[Length], TextSize - Length, Spec, (INT)Value);
+        }
+        else if (*Scan == 'p')
+        {
+          strcpy(&Spec[SpecLength], "#llx");
+          Length += snprintf(&Text[Length], TextSize - Length, Spec, Value);
+        }
+        else if ((*Scan == 'd') || (*Scan == 'i'))
+        {
+          if ((Size == 4) && (Value & 0x80000000ull)) Value |= 0xFFFFFFFF00000000ull;  // sign extension.
+          sprintf(&Spec[SpecLength], "ll%c", *Scan);
+          Length += snprintf(&Text[Length], TextSize - Length, Spec, (INT64)Value);
+        }
+        else
+        {
+          sprintf(&Spec[SpecLength], "ll%c", *Scan);
+          Length += snprintf(&Text[Length], TextSize - Length, Spec, Value);
+        }
+      break;
+
+      case ('a'):
+      case ('A'):
+      case ('e'):
+      case ('E'):
+      case ('f'):
+      case ('F'):
+      case ('g'):
+      case ('G'):
+        if ((FlagMissing) || ((Used + sizeof(Double)) > ArgumentLength))
+        {
+          FlagMissing = FLAG_ON;
+          break;
+        }
+        memcpy(&Double, &Argument[Used], sizeof(Double));
+        Used += sizeof(Double);
+        sprintf(&Spec[SpecLength], "%c", *Scan);
+        Length += snprintf(&Text[Length], TextSize - Length, Spec, Double);
+      break;
+
+      case ('s'):
+        if ((FlagMissing) || ((Used + 1) > ArgumentLength))
+        {
+          FlagMissing = FLAG_ON;
+          break;
+        }
+        Size = Argument[Used++];
+        if ((Used + Size) > ArgumentLength) Size = ArgumentLength - Used;
+        memcpy(String, &Argument[Used], Size);
+        String[Size] = '\0';
+        Used += Size;
+        strcpy(&Spec[SpecLength], "s");
+        Length += snprintf(&Text[Length], TextSize - Length, Spec, String);
+      break;
+
+      default:
+        /* Unknown conversion (or end of string): log_binary() stopped encoding there too. */
+        FlagMissing = FLAG_ON;
+      break;
+    }
+    if (Length >= TextSize) Length = TextSize - 1;
+
+    /* Copy the rest of the format string as is. */
+    if (FlagMissing)
+    {
+      Length += snprintf(&Text[Length], TextSize - Length, "%s", SpecStart);
+      if (Length >= TextSize) Length = TextSize - 1;
+      break;
+    }
+  }
+  Text[Length] = '\0';
+
+  return;
+}
@@ -0,0 +1,7 @@
+/* Host replacement for <lwip/apps/mqtt.h> (see Pico-Host-Platform.h). */
+#ifndef __HOST_LWIP_APPS_MQTT_H
+#define __HOST_LWIP_APPS_MQTT_H
+
+#include "Pico-Host-Platform.h"
+
+#endif  // __HOST_LWIP_APPS_MQTT_H
@@ -0,0 +1,7 @@
+/* Host replacement for <lwip/ip_addr.h> (see Pico-Host-Platform.h). */
+#ifndef __HOST_LWIP_IP_ADDR_H
+#define __HOST_LWIP_IP_ADDR_H
+
+#include "Pico-Host-Platform.h"
+
+#endif  // __HOST_LWIP_IP_ADDR_H
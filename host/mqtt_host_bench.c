@@ -0,0 +1,2130 @@
+/* ============================================================================================================================================================= *\
+   mqtt_host_bench.c
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   Revision 16-OCT-2026
+   Langage: C
+
+   Linux host benchmark for Pico-MQTT-Module. The real module source code is linked with the host platform layer (Pico-Host-Platform.c)
+   and exercised through the same callbacks that lwIP calls on the Pico W.
+
+   Usage: mqtt_host_bench [iterations]
+
+   Every performance change to the module should be measured with this program before it is flashed to the devices. Timings are only printed,
+   but the properties each change claims (no line lost or broken, round trips, reconnection delays, ...) are checked: each failed check prints
+   a line beginning with "***" and the program exits with the number of failed checks.
+\* ============================================================================================================================================================= */
+
+
+
+/* $PAGE */
+/* $TITLE=Definitions and macros. */
+/* ============================================================================================================================================================= *\
+                                                                       Definitions and macros.
+\* ============================================================================================================================================================= */
+#define RELEASE_VERSION
+#define DEFAULT_ITERATIONS  200000  // default number of iterations for each benchmark.
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                          Include files
+\* ============================================================================================================================================================= */
+#include "baseline.h"
+#include "hardware/rtc.h"
+#include "pico/stdlib.h"
+#include "stdarg.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Pico-Clock-Module.h"
+#include "Pico-MQTT-Module.h"
+#include "Pico-Scheduler-Module.h"
+
+
+
+/* $PAGE */
+/* $TITLE=Global variables declaration / definition. */
+/* ============================================================================================================================================================= *\
+                                                            Global variables declaration / definition.
+\* ============================================================================================================================================================= */
+UCHAR PicoUniqueId[40]   = "E661-4103-E72C-2423";
+UCHAR PicoIdentifier[40] = "Control";
+
+struct struct_clock     StructClock;
+struct struct_mqtt      StructMQTT;
+struct struct_scheduler StructScheduler;
+
+/* Day names. */
+UCHAR DayName[7][13] =
+{
+  {"Sunday"}, {"Monday"}, {"Tuesday"}, {"Wednesday"}, {"Thursday"}, {"Friday"}, {"Saturday"}
+};
+
+/* Short month names (3 letters). */
+UCHAR ShortMonth[13][4] =
+{
+  {" "}, {"JAN"}, {"FEB"}, {"MAR"}, {"APR"}, {"MAY"}, {"JUN"}, {"JUL"}, {"AUG"}, {"SEP"}, {"OCT"}, {"NOV"}, {"DEC"}
+};
+
+/* Typical ASTL Smart Home ecosystem messages. */
+static const struct
+{
+  const char *Topic;
+  const char *Payload;
+} BenchMessage[] =
+{
+  {"Control/TimeSet/TimeServer",            "4/16/10/2026/12/34/56"},
+  {"All/Temperature/Kitchen",               "21.5/45/1013"},
+  {"All/Status/SoundServer1/Volume/Level",  "35"},
+  {"SoundServer2/Play/Control",             "Doorbell/3/80"},
+};
+
+#define BENCH_MESSAGES  (sizeof(BenchMessage) / sizeof(BenchMessage[0]))
+
+/* Number of failed checks (see bench_fail()), returned by main(). */
+static UINT32 BenchFailures;
+
+/* Payloads delivered by lwIP in several chunks: one that fits in the payload buffer and one that must be streamed. */
+static UCHAR  BenchLargePayload[2048];
+static UINT32 BenchStreamBytes;
+
+/* Commands of a typical Control / SoundServer device, used to compare topic dispatch methods. */
+#define BENCH_COMMANDS  40
+static UCHAR  BenchCommand[BENCH_COMMANDS][16];
+static UINT32 BenchHandlerCalls;
+
+/* Outbound publish requests completed by the queue. */
+#define BENCH_ROUND_TRIP_MS  20  // simulated network round trip between the Pico and the broker.
+static UINT32 BenchPublishCompleted;
+static UINT32 BenchPumpRequests;
+
+/* Topic filters of the longest subscribe list (longer than the request queue, see bench_subscribe()). */
+#define BENCH_FILTERS  20
+
+/* Device topic filters given to the subscription replay cache (must stay valid, see mqtt_session_subscribe()). */
+static UCHAR                       BenchSessionFilter[4][32];
+static struct mqtt_subscription    BenchSessionList[4];
+static struct mqtt_subscribe_batch BenchSessionBatch;
+
+/* Log ring buffer half full (see log_set_wakeup()), and number of log lines of each core logged before the main loop drains the ring buffers. */
+#define BENCH_LOG_WAKEUP_LINES  8
+static volatile UINT8 BenchLogWakeup;
+
+/* Main loop scheduler: task runs and time of the last event signaled by the "interrupt" thread. */
+#define BENCH_EVENT         0x01
+#define BENCH_LOG_DRAIN_MS  2000  // safety period of the log drain task (LOG_DRAIN_MSEC in Pico-MQTT-Example.c).
+static volatile UINT32 BenchTaskRuns;
+static volatile UINT64 BenchSignalTime;
+static volatile UINT64 BenchEventLatency;
+
+/* MQTT engine on core 1: simulated application work of each incoming message and end of the core 1 thread. */
+#define BENCH_ENGINE_WORK_NS  2000
+static UINT32         BenchWorkNs;
+static volatile UINT8 BenchEngineStop;
+
+/* Snapshots read by core 1: messages copied, inconsistent snapshot copies (must be 0), inconsistent copies of the live buffers of core 0 and
+   held views whose topic and payload belong to different messages (must be 0, see mqtt_hold_view()). */
+#define BENCH_SNAPSHOT_PAYLOAD  120
+static volatile UINT32 BenchSnapshotReads;
+static volatile UINT32 BenchSnapshotTorn;
+static volatile UINT32 BenchLiveTorn;
+static volatile UINT32 BenchViewMixed;
+static volatile UINT8  BenchSnapshotStop;
+
+/* Receive buffers and arena of StructMQTT, and second MQTT instance connected to a backup broker with smaller receive buffers and no engine slots. */
+#define BENCH_BACKUP_BROKER_IP  "192.168.0.2"
+#define BENCH_BACKUP_BUFFER     64
+static UCHAR      BenchTopicBuffer[MAX_TOPIC_LENGTH];
+static UCHAR      BenchPayloadBuffer[MAX_PAYLOAD_LENGTH];
+static UCHAR      BenchArena[MQTT_ARENA_SIZE(MAX_TOPIC_LENGTH, MAX_PAYLOAD_LENGTH, MAX_MQTT_ENGINE_SLOTS)];
+static mqtt_ctx_t BenchBackup;
+static UCHAR      BenchBackupTopic[BENCH_BACKUP_BUFFER];
+static UCHAR      BenchBackupPayload[BENCH_BACKUP_BUFFER];
+static UCHAR      BenchBackupArena[MQTT_ARENA_SIZE(BENCH_BACKUP_BUFFER, BENCH_BACKUP_BUFFER, 0)];
+
+
+
+/* $PAGE */
+/* $TITLE=Function prototypes. */
+/* ============================================================================================================================================================= *\
+                                                                     Function prototypes.
+\* ============================================================================================================================================================= */
+/* Send data to log file. */
+void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...);
+
+#include "log_printf.c"
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_fail() */
+/* ============================================================================================================================================================= *\
+                                                   Report a failed check: print it, beginning with "***", and count it.
+\* ============================================================================================================================================================= */
+static void bench_fail(const char *Format, ...)
+{
+  va_list Arguments;
+
+
+  ++BenchFailures;
+  printf("*** ");
+  va_start(Arguments, Format);
+  vprintf(Format, Arguments);
+  va_end(Arguments);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_now_ns() */
+/* ============================================================================================================================================================= *\
+                                                               Return the current monotonic time in nsec.
+\* ============================================================================================================================================================= */
+static UINT64 bench_now_ns(void)
+{
+  struct timespec Now;
+
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+
+  return ((UINT64)Now.tv_sec * 1000000000ull) + (UINT64)Now.tv_nsec;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_report() */
+/* ============================================================================================================================================================= *\
+                                                                   Print one line of benchmark result.
+\* ============================================================================================================================================================= */
+static void bench_report(const char *Name, UINT32 Iterations, UINT64 ElapsedNs)
+{
+  printf("%-48s %10u iterations   %10.1f ns/op   %12.0f op/sec\n", Name, Iterations, (double)ElapsedNs / Iterations, (Iterations * 1e9) / (double)ElapsedNs);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_process_message() */
+/* ============================================================================================================================================================= *\
+                        Same processing as mqtt_process_message() in Pico-MQTT-Example.c, plus BenchWorkNs of simulated application work.
+\* ============================================================================================================================================================= */
+static void bench_process_message(mqtt_ctx_t *Ctx)
+{
+  UINT64 StartTime;
+
+
+  StartTime = bench_now_ns();
+
+  mqtt_display_topic(Ctx);
+  mqtt_display_payload(Ctx);
+
+  mqtt_dispatch(Ctx);
+
+  while ((bench_now_ns() - StartTime) < BenchWorkNs);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_incoming_data_cb() */
+/* ============================================================================================================================================================= *\
+                                  Same processing as mqtt_incoming_data_cb() in Pico-MQTT-Example.c, minus the application specific part.
+\* ============================================================================================================================================================= */
+static void bench_incoming_data_cb(void *ExtraArgument, const UINT8 *Payload, UINT16 PayloadLength, UINT8 Flags)
+{
+  mqtt_ctx_t *Ctx = ExtraArgument;
+
+
+  if (mqtt_reassemble_payload(Ctx, Payload, PayloadLength, Flags) == FLAG_OFF) return;
+
+  if (Ctx->Engine.FlagOn)
+    mqtt_engine_push(Ctx);
+  else
+    bench_process_message(Ctx);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_payload_stream() */
+/* ============================================================================================================================================================= *\
+                                                    Streaming handler for payloads too large for the payload buffer of the instance.
+\* ============================================================================================================================================================= */
+static void bench_payload_stream(mqtt_ctx_t *Ctx, const UINT8 *Chunk, UINT16 ChunkLength, UINT32 Offset, UINT8 Flags)
+{
+  BenchStreamBytes += ChunkLength;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_mqtt_initialization() */
+/* ============================================================================================================================================================= *\
+                                                Same sequence as mqtt_initialization() in Pico-MQTT-Example.c.
+\* ============================================================================================================================================================= */
+static void bench_mqtt_initialization(mqtt_ctx_t *Ctx)
+{
+  if (mqtt_init(Ctx)) return;
+
+  if (ip_addr_isany(&Ctx->BrokerAddress)) ip4addr_aton(MQTT_BROKER_IP, &Ctx->BrokerAddress);
+  Ctx->MqttClientInfo.client_id   = Ctx->PicoIdentifier;
+  Ctx->MqttClientInfo.client_user = "pi";
+  Ctx->MqttClientInfo.client_pass = MQTT_PASSWORD;
+  Ctx->MqttClientInfo.keep_alive  = 60;
+
+  mqtt_set_inpub_callback(Ctx->MqttClientInstance, mqtt_incoming_publish_cb, bench_incoming_data_cb, Ctx);
+
+  if (mqtt_client_connect(Ctx->MqttClientInstance, &Ctx->BrokerAddress, PORT, mqtt_connection_cb, Ctx, &Ctx->MqttClientInfo) == ERR_OK)
+  {
+    mqtt_session_request(Ctx);
+    mqtt_boot_mark(Ctx, MQTT_BOOT_CONNECT);
+  }
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_connect() */
+/* ============================================================================================================================================================= *\
+                                                         Bring the module to the "connected to broker" state.
+\* ============================================================================================================================================================= */
+static void bench_connect(void)
+{
+  host_mqtt_set_broker_available(FLAG_ON);
+  if (mqtt_check_connection(&StructMQTT, FLAG_ON) == 1) bench_mqtt_initialization(&StructMQTT);
+  host_mqtt_poll(StructMQTT.MqttClientInstance);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_incoming_fragmented() */
+/* ============================================================================================================================================================= *\
+                           Incoming publish with a payload delivered in several chunks: reassembled in the payload buffer, or streamed when too large.
+\* ============================================================================================================================================================= */
+static void bench_incoming_fragmented(UINT32 Iterations)
+{
+  UINT16 Loop1UInt16;
+
+  UINT32 Loop1UInt32;
+
+  UINT64 StartTime;
+
+
+  /* Slash-separated payload, like the ones used in the ASTL Smart Home ecosystem. */
+  for (Loop1UInt16 = 0; Loop1UInt16 < sizeof(BenchLargePayload); ++Loop1UInt16)
+    BenchLargePayload[Loop1UInt16] = ((Loop1UInt16 % 8) == 7) ? '/' : ('0' + (Loop1UInt16 % 10));
+
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+    host_mqtt_inject_publish(StructMQTT.MqttClientInstance, "All/Status/Inventory/Control", BenchLargePayload, 400);
+  bench_report("incoming publish, 400 bytes in 4 chunks", Iterations, bench_now_ns() - StartTime);
+  if (StructMQTT.PayloadLength != 400) bench_fail("reassembled payload length is %u instead of 400\n", StructMQTT.PayloadLength);
+
+  StructMQTT.mqtt_payload_stream = bench_payload_stream;
+  BenchStreamBytes = 0;
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+    host_mqtt_inject_publish(StructMQTT.MqttClientInstance, "All/Status/Inventory/Control", BenchLargePayload, sizeof(BenchLargePayload));
+  bench_report("incoming publish, 2048 bytes streamed", Iterations, bench_now_ns() - StartTime);
+  if (BenchStreamBytes != (Iterations * sizeof(BenchLargePayload))) bench_fail("%u bytes streamed instead of %u\n", BenchStreamBytes, Iterations * sizeof(BenchLargePayload));
+  StructMQTT.mqtt_payload_stream = NULL;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_incoming_publish() */
+/* ============================================================================================================================================================= *\
+                                    Complete incoming publish path: lwIP publish callback, data callback, parsing and display.
+\* ============================================================================================================================================================= */
+static void bench_incoming_publish(UINT32 Iterations)
+{
+  UINT32 Loop1UInt32;
+
+  UINT64 StartTime;
+
+
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+    host_mqtt_inject_publish(StructMQTT.MqttClientInstance, BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Topic, BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Payload, strlen(BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Payload));
+  bench_report("incoming publish (callbacks + parse + display)", Iterations, bench_now_ns() - StartTime);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_parse() */
+/* ============================================================================================================================================================= *\
+                                                        Parsing of the topic and of the payload of a typical message.
+\* ============================================================================================================================================================= */
+static void bench_parse(UINT32 Iterations)
+{
+  UINT32 Loop1UInt32;
+
+  UINT64 StartTime;
+
+
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    mqtt_wipe_packet(&StructMQTT);
+    strcpy(StructMQTT.Topic,   BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Topic);
+    strcpy(StructMQTT.Payload, BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Payload);
+    mqtt_parse_item(&StructMQTT, PARSE_TOPIC);
+    mqtt_parse_item(&StructMQTT, PARSE_PAYLOAD);
+  }
+  bench_report("wipe + copy + parse topic and payload", Iterations, bench_now_ns() - StartTime);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_wipe_packet() */
+/* ============================================================================================================================================================= *\
+                         Packet reset between two typical messages, with the original full clear and with the length-tracked clear (see mqtt_wipe_packet()).
+             NOTE: The host CPU clears 1 kbyte with a few wide vector stores, so the ns/op difference shown here underestimates the savings on the Pico,
+                   where memset() stores at most one 32-bit word per cycle. The number of bytes cleared per message is the portable measure.
+\* ============================================================================================================================================================= */
+static void bench_wipe_packet(UINT32 Iterations)
+{
+  UCHAR Name[64];
+
+  UINT8 Loop1UInt8;
+
+  UINT32 Loop1UInt32;
+
+  UINT64 BytesCleared;
+  UINT64 ElapsedNs[2];
+  UINT64 StartTime;
+
+
+  BytesCleared = 0;
+  for (Loop1UInt32 = 0; Loop1UInt32 < BENCH_MESSAGES; ++Loop1UInt32)
+    BytesCleared += strlen(BenchMessage[Loop1UInt32].Topic) + strlen(BenchMessage[Loop1UInt32].Payload) + 2;
+
+  for (Loop1UInt8 = MQTT_WIPE_TRACKED; Loop1UInt8 <= MQTT_WIPE_FULL; ++Loop1UInt8)
+  {
+    StructMQTT.WipeMode = Loop1UInt8;
+
+    StartTime = bench_now_ns();
+    for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+    {
+      mqtt_wipe_packet(&StructMQTT);
+      strcpy(StructMQTT.Topic,   BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Topic);
+      strcpy(StructMQTT.Payload, BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Payload);
+      mqtt_get_view(&StructMQTT);
+      __asm__ volatile("" ::: "memory");  // prevent the compiler from merging the iterations.
+    }
+    ElapsedNs[Loop1UInt8] = bench_now_ns() - StartTime;
+
+    sprintf(Name, "mqtt_wipe_packet() %s + copy + parse", (Loop1UInt8 == MQTT_WIPE_FULL) ? "full   " : "tracked");
+    bench_report(Name, Iterations, ElapsedNs[Loop1UInt8]);
+  }
+  StructMQTT.WipeMode = MQTT_WIPE_TRACKED;
+
+  printf("%-48s %10.1f bytes/msg (full: %u)   %10.1f ns/msg saved\n", "length-tracked reset", (double)BytesCleared / BENCH_MESSAGES, MAX_TOPIC_LENGTH + MAX_PAYLOAD_LENGTH,
+         (double)((INT64)ElapsedNs[MQTT_WIPE_FULL] - (INT64)ElapsedNs[MQTT_WIPE_TRACKED]) / Iterations);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_clock() */
+/* ============================================================================================================================================================= *\
+                   Cost of a log time stamp: real-time clock read + date and time formatting (previous log_printf()) compared to the cached strings of the
+                     soft clock and to a plain time stamp. Then the soft clock strings are checked against the C library over 3 days.
+\* ============================================================================================================================================================= */
+static void bench_clock(UINT32 Iterations)
+{
+  UCHAR ClockDate[CLOCK_DATE_SIZE];
+  UCHAR ClockTime[CLOCK_TIME_SIZE];
+  UCHAR RtcDate[CLOCK_DATE_SIZE + 8];
+  UCHAR RtcTime[CLOCK_TIME_SIZE + 8];
+
+  UINT8 Loop2UInt8;
+
+  UINT32 Loop1UInt32;
+  UINT32 Mismatches;
+  UINT32 Regenerations;
+  UINT32 Seconds;
+
+  UINT64 EndTime;
+  UINT64 StartTime;
+  UINT64 Total;
+
+  datetime_t DateTime;
+
+  struct tm TimeStruct;
+
+  time_t Epoch[2];
+
+
+  DateTime.dotw  = 5;
+  DateTime.day   = 16;
+  DateTime.month = 10;
+  DateTime.year  = 2026;
+  DateTime.hour  = 12;
+  DateTime.min   = 34;
+  DateTime.sec   = 56;
+  rtc_init();
+  rtc_set_datetime(&DateTime);
+  clock_set_datetime(&DateTime);
+
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    rtc_get_datetime(&DateTime);
+    sprintf(RtcDate, "%2.2d-%s-%2.2d", DateTime.day, ShortMonth[DateTime.month], DateTime.year);
+    sprintf(RtcTime, "%2.2d:%2.2d:%2.2d", DateTime.hour, DateTime.min, DateTime.sec);
+  }
+  EndTime = bench_now_ns();
+  bench_report("log time stamp: rtc_get_datetime() + sprintf()", Iterations, EndTime - StartTime);
+
+  Regenerations = StructClock.Cache[get_core_num()].Regenerations;
+  StartTime     = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+    clock_get_strings(ClockDate, ClockTime);
+  EndTime = bench_now_ns();
+  bench_report("log time stamp: clock_get_strings() (cached)", Iterations, EndTime - StartTime);
+  Regenerations = StructClock.Cache[get_core_num()].Regenerations - Regenerations;
+  Seconds       = (UINT32)((EndTime - StartTime) / 1000000000ull);
+  printf("clock_get_strings(): %u calls, %u regenerations\n", Iterations, Regenerations);
+  if (Regenerations > (Seconds + 2)) bench_fail("%u regenerations of the cached strings in %u seconds (at most one per second expected)\n", Regenerations, Seconds + 1);
+
+  Total     = 0;
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+    Total += clock_get_time();
+  EndTime = bench_now_ns();
+  bench_report("time stamp: clock_get_time()", Iterations, EndTime - StartTime);
+
+  /* Same date and time as the C library (gmtime_r()), one step of 0.997 second at a time (simulated). The second may change between the two
+     reads of the clock: the strings must match one of them. */
+  Mismatches = 0;
+  for (Loop1UInt32 = 0; Loop1UInt32 < 260000; ++Loop1UInt32)
+  {
+    host_time_warp_us(997000);
+    Epoch[0] = (time_t)(clock_get_time() / 1000000ull);
+    clock_get_strings(ClockDate, ClockTime);
+    Epoch[1] = (time_t)(clock_get_time() / 1000000ull);
+    for (Loop2UInt8 = 0; Loop2UInt8 < 2; ++Loop2UInt8)
+    {
+      gmtime_r(&Epoch[Loop2UInt8], &TimeStruct);
+      sprintf(RtcDate, "%2.2d-%s-%4.4d", TimeStruct.tm_mday, ShortMonth[TimeStruct.tm_mon + 1], TimeStruct.tm_year + 1900);
+      sprintf(RtcTime, "%2.2d:%2.2d:%2.2d", TimeStruct.tm_hour, TimeStruct.tm_min, TimeStruct.tm_sec);
+      if ((strcmp(RtcDate, ClockDate) == 0) && (strcmp(RtcTime, ClockTime) == 0)) break;
+    }
+    if (Loop2UInt8 == 2) ++Mismatches;
+  }
+  printf("soft clock vs C library: %u steps over %u days, %u mismatches (last: %s %s)\n", Loop1UInt32, (UINT32)((Loop1UInt32 * 997ull) / 86400000ull), Mismatches, ClockDate, ClockTime);
+  if (Mismatches) bench_fail("%u soft clock strings different from the C library\n", Mismatches);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_log_printf() */
+/* ============================================================================================================================================================= *\
+                                             log_printf() throughput with a terminal connected (output sent to /dev/null).
+\* ============================================================================================================================================================= */
+static void bench_log_printf(UINT32 Iterations)
+{
+  INT32 NullFile;
+  INT32 SavedStdout;
+
+  UINT32 Loop1UInt32;
+
+  UINT64 StartTime;
+  UINT64 EndTime;
+
+
+  fflush(stdout);
+  SavedStdout = dup(STDOUT_FILENO);
+  NullFile    = open("/dev/null", O_WRONLY);
+  dup2(NullFile, STDOUT_FILENO);
+  host_stdio_set_connected(FLAG_ON);
+
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+    log_printf(__LINE__, __func__, "Receiving a MQTT message on topic: <%s>   Payload length: %u\n", BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Topic, Loop1UInt32);
+  fflush(stdout);
+  EndTime = bench_now_ns();
+
+  host_stdio_set_connected(FLAG_OFF);
+  dup2(SavedStdout, STDOUT_FILENO);
+  close(SavedStdout);
+  close(NullFile);
+
+  bench_report("log_printf() with terminal connected", Iterations, EndTime - StartTime);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_log_stack_thread() */
+/* ============================================================================================================================================================= *\
+                                  Thread of bench_log_stack(): log one line with all extra parameters (or nothing when Argument is NULL).
+\* ============================================================================================================================================================= */
+static void *bench_log_stack_thread(void *Argument)
+{
+  if (Argument) log_printf(__LINE__, __func__, "Receiving a MQTT message on topic: <%s>   Payload length: %u\n", (UCHAR *)Argument, 123);
+
+  return NULL;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_log_stack() */
+/* ============================================================================================================================================================= *\
+                 Stack used by one log_printf() call, all extra parameters turned On: a thread runs on a stack filled with a pattern and the deepest
+             byte overwritten is found when it is done. The stack used by an empty thread is subtracted. Includes vsnprintf() of the host C library.
+\* ============================================================================================================================================================= */
+static void bench_log_stack(void)
+{
+  UINT8 Loop1UInt8;
+
+  INT32 NullFile;
+  INT32 SavedStdout;
+
+  UINT32 Loop1UInt32;
+  UINT32 Used[2];
+
+  static UCHAR Stack[65536] __attribute__((aligned(64)));
+
+  pthread_attr_t Attribute;
+  pthread_t      Thread;
+
+
+  fflush(stdout);
+  SavedStdout = dup(STDOUT_FILENO);
+  NullFile    = open("/dev/null", O_WRONLY);
+  dup2(NullFile, STDOUT_FILENO);
+  host_stdio_set_connected(FLAG_ON);
+  log_printf(__LINE__, __func__, "LOG MASK %X", LOG_ALL);
+
+  for (Loop1UInt8 = 0; Loop1UInt8 < 2; ++Loop1UInt8)
+  {
+    memset(Stack, 0xA5, sizeof(Stack));
+    pthread_attr_init(&Attribute);
+    pthread_attr_setstack(&Attribute, Stack, sizeof(Stack));
+    pthread_create(&Thread, &Attribute, bench_log_stack_thread, (Loop1UInt8 ? BenchMessage[0].Topic : NULL));
+    pthread_join(Thread, NULL);
+    pthread_attr_destroy(&Attribute);
+
+    /* Stack grows down: the first byte that is not the pattern any more is the deepest one used. */
+    for (Loop1UInt32 = 0; (Loop1UInt32 < sizeof(Stack)) && (Stack[Loop1UInt32] == 0xA5); ++Loop1UInt32);
+    Used[Loop1UInt8] = sizeof(Stack) - Loop1UInt32;
+  }
+  fflush(stdout);
+
+  log_printf(__LINE__, __func__, "LOG MASK 0x13");
+  host_stdio_set_connected(FLAG_OFF);
+  dup2(SavedStdout, STDOUT_FILENO);
+  close(SavedStdout);
+  close(NullFile);
+
+  printf("%-48s %10u bytes of stack (line buffer: %u bytes)\n", "log_printf() stack usage, all extra parameters", Used[1] - Used[0], LOG_LINE_SIZE);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_log_async_thread() */
+/* ============================================================================================================================================================= *\
+                                                  Simulated core 1 of bench_log_async(): log lines while core 0 logs its own lines.
+\* ============================================================================================================================================================= */
+static void *bench_log_async_thread(void *Argument)
+{
+  UINT32 Loop1UInt32;
+
+
+  host_set_core_num(1);
+  for (Loop1UInt32 = 0; Loop1UInt32 < *(UINT32 *)Argument; ++Loop1UInt32)
+    log_printf(__LINE__, __func__, "core 1 line %lu\n", Loop1UInt32);
+
+  return NULL;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_log_async() */
+/* ============================================================================================================================================================= *\
+                      log_printf() in LOG_MODE_ASYNC: two simulated cores log at the same time while core 0 drains the ring buffers every few lines.
+                   Output goes to a temporary file, then each line is checked: it must be complete and the lines of each core must come in order.
+\* ============================================================================================================================================================= */
+static void bench_log_async(UINT32 Iterations)
+{
+  UCHAR  FileName[] = "/tmp/mqtt_bench_log_XXXXXX";
+  UCHAR  Line[512];
+  UCHAR *Text;
+
+  UINT8 SavedMode;
+
+  INT32 LogFile;
+  INT32 SavedStdout;
+
+  UINT32 Broken;
+  UINT32 Core;
+  UINT32 Drained;
+  UINT32 Dropped;
+  UINT32 Expected[2];
+  UINT32 Intact;
+  UINT32 Loop1UInt32;
+  UINT32 Number;
+  UINT32 OutOfOrder;
+
+  UINT64 DrainNs;
+  UINT64 EndTime;
+  UINT64 StartTime;
+
+  FILE *Input;
+
+  pthread_t Core1;
+
+
+  fflush(stdout);
+  SavedStdout = dup(STDOUT_FILENO);
+  LogFile     = mkstemp(FileName);
+  dup2(LogFile, STDOUT_FILENO);
+  host_stdio_set_connected(FLAG_ON);
+  SavedMode = log_get_mode();
+  log_set_mode(LOG_MODE_ASYNC);
+
+  Drained = 0;
+  DrainNs = 0;
+  pthread_create(&Core1, NULL, bench_log_async_thread, &Iterations);
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    log_printf(__LINE__, __func__, "core 0 line %lu\n", Loop1UInt32);
+    if ((Loop1UInt32 % 16) == 15)
+    {
+      EndTime  = bench_now_ns();
+      Drained += log_drain();
+      DrainNs += bench_now_ns() - EndTime;
+    }
+  }
+  pthread_join(Core1, NULL);
+  while ((Loop1UInt32 = log_drain()) != 0) Drained += Loop1UInt32;
+  EndTime = bench_now_ns();
+
+  log_set_mode(SavedMode);
+  host_stdio_set_connected(FLAG_OFF);
+  fflush(stdout);
+  dup2(SavedStdout, STDOUT_FILENO);
+  close(SavedStdout);
+  close(LogFile);
+
+  /* Check every line sent to the log file. */
+  Broken      = 0;
+  Intact      = 0;
+  OutOfOrder  = 0;
+  Expected[0] = 0;
+  Expected[1] = 0;
+  Input = fopen(FileName, "r");
+  while (fgets(Line, sizeof(Line), Input))
+  {
+    if (strstr(Line, "[log_drain]")) continue;  // report of dropped lines.
+    Text = strstr(Line, "- core ");
+    if ((Text == NULL) || (sscanf(Text, "- core %lu line %lu\n", &Core, &Number) != 2) || (Core > 1) || (strchr(Text, '[') != NULL) || (Line[0] != '['))
+    {
+      ++Broken;
+      continue;
+    }
+    if (Number < Expected[Core]) ++OutOfOrder;
+    Expected[Core] = Number + 1;
+    ++Intact;
+  }
+  fclose(Input);
+  unlink(FileName);
+  Dropped = LogRing[0].Dropped + LogRing[1].Dropped;
+
+  bench_report("log_printf() async, 2 cores (lines + drain)", Iterations * 2, EndTime - StartTime - DrainNs);
+  bench_report("log_drain() (bytes)", Drained, DrainNs);
+  printf("    lines: %lu   intact: %lu   dropped (ring full): %lu   broken: %lu   out of order: %lu\n", Iterations * 2, Intact, Dropped, Broken, OutOfOrder);
+  if (Broken || OutOfOrder) bench_fail("%lu broken and %lu out of order log lines\n", Broken, OutOfOrder);
+  if ((Intact + Dropped) != (Iterations * 2)) bench_fail("%lu log lines neither sent nor counted as dropped\n", (Iterations * 2) - Intact - Dropped);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_log_wakeup_cb() */
+/* ============================================================================================================================================================= *\
+                                       Wakeup function of bench_log_wakeup(): signal the main loop that a log ring buffer is half full.
+\* ============================================================================================================================================================= */
+static void bench_log_wakeup_cb(void)
+{
+  BenchLogWakeup = FLAG_ON;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_log_wakeup() */
+/* ============================================================================================================================================================= *\
+                    log_printf() in LOG_MODE_ASYNC, both cores logging at the same pace, with the ring buffers drained by the main loop only when woken
+                   up by log_set_wakeup() (as task_log() does in Pico-MQTT-Example.c), BENCH_LOG_WAKEUP_LINES lines of each core after the wakeup.
+                                               No line may be dropped: the other half of the ring buffer covers the wakeup latency.
+\* ============================================================================================================================================================= */
+static void bench_log_wakeup(UINT32 Iterations)
+{
+  UINT8 SavedMode;
+
+  INT32 NullFile;
+  INT32 SavedStdout;
+
+  UINT32 Dropped;
+  UINT32 Loop1UInt32;
+  UINT32 Pending;
+  UINT32 Wakeups;
+
+
+  fflush(stdout);
+  SavedStdout = dup(STDOUT_FILENO);
+  NullFile    = open("/dev/null", O_WRONLY);
+  dup2(NullFile, STDOUT_FILENO);
+  host_stdio_set_connected(FLAG_ON);
+  SavedMode = log_get_mode();
+  log_set_mode(LOG_MODE_ASYNC);
+  log_set_wakeup(bench_log_wakeup_cb);
+
+  Dropped        = LogRing[0].Dropped + LogRing[1].Dropped;
+  BenchLogWakeup = FLAG_OFF;
+  Pending        = 0;
+  Wakeups        = 0;
+  for (Loop1UInt32 = 0; Loop1UInt32 < (Iterations * 2); ++Loop1UInt32)
+  {
+    host_set_core_num(Loop1UInt32 & 0x01);
+    log_printf(__LINE__, __func__, "core %lu line %lu\n", Loop1UInt32 & 0x01, Loop1UInt32 / 2);
+    host_set_core_num(0);
+    if ((BenchLogWakeup) && (++Pending >= (BENCH_LOG_WAKEUP_LINES * 2)))
+    {
+      BenchLogWakeup = FLAG_OFF;
+      Pending        = 0;
+      ++Wakeups;
+      log_drain();
+    }
+  }
+  log_drain();
+  Dropped = LogRing[0].Dropped + LogRing[1].Dropped - Dropped;
+
+  log_set_wakeup(NULL);
+  log_set_mode(SavedMode);
+  host_stdio_set_connected(FLAG_OFF);
+  fflush(stdout);
+  dup2(SavedStdout, STDOUT_FILENO);
+  close(SavedStdout);
+  close(NullFile);
+
+  printf("log_printf() async, drained on wakeup only: %lu lines   %lu wake-ups   dropped: %lu   (drain %u lines of each core after the wakeup)\n", Iterations * 2, Wakeups, Dropped, BENCH_LOG_WAKEUP_LINES);
+  if (Dropped) bench_fail("%lu log lines dropped although the ring buffers are drained when half full\n", Dropped);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_log_binary() */
+/* ============================================================================================================================================================= *\
+                  log_printf() in LOG_MODE_ASYNC, text lines against binary records (LOG_MODE_BINARY): time spent by the caller and bytes sent to the
+          terminal for each line. The binary capture is kept in /tmp/mqtt_host_bench.bin, to be decoded with: log_decode mqtt_host_bench /tmp/mqtt_host_bench.bin
+\* ============================================================================================================================================================= */
+static void bench_log_binary(UINT32 Iterations)
+{
+  UINT8 Loop1UInt8;
+  UINT8 SavedMode;
+
+  INT32 LogFile;
+  INT32 SavedStdout;
+
+  UINT32 Bytes[2];
+  UINT32 Loop1UInt32;
+
+  UINT64 ElapsedNs[2];
+  UINT64 StartTime;
+
+
+  fflush(stdout);
+  SavedMode   = log_get_mode();
+  SavedStdout = dup(STDOUT_FILENO);
+  host_stdio_set_connected(FLAG_ON);
+
+  for (Loop1UInt8 = 0; Loop1UInt8 < 2; ++Loop1UInt8)
+  {
+    LogFile = open((Loop1UInt8 ? "/tmp/mqtt_host_bench.bin" : "/dev/null"), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(LogFile, STDOUT_FILENO);
+    log_set_mode(LOG_MODE_ASYNC | (Loop1UInt8 ? LOG_MODE_BINARY : 0));
+
+    Bytes[Loop1UInt8]     = 0;
+    ElapsedNs[Loop1UInt8] = 0;
+    for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+    {
+      StartTime = bench_now_ns();
+      log_printf(__LINE__, __func__, "Receiving a MQTT message on topic: <%s>   Payload length: %u\n", BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Topic, Loop1UInt32);
+      ElapsedNs[Loop1UInt8] += bench_now_ns() - StartTime;
+      if ((Loop1UInt32 % 32) == 31) Bytes[Loop1UInt8] += log_drain();
+    }
+    Bytes[Loop1UInt8] += log_drain();
+
+    log_set_mode(SavedMode);
+    fflush(stdout);
+    close(LogFile);
+  }
+
+  host_stdio_set_connected(FLAG_OFF);
+  dup2(SavedStdout, STDOUT_FILENO);
+  close(SavedStdout);
+
+  bench_report("log_printf() async, text lines", Iterations, ElapsedNs[0]);
+  bench_report("log_printf() async, binary records", Iterations, ElapsedNs[1]);
+  printf("    bytes per line: text %.1f   binary %.1f   (binary capture: /tmp/mqtt_host_bench.bin)\n", (double)Bytes[0] / Iterations, (double)Bytes[1] / Iterations);
+  if (Bytes[1] >= Bytes[0]) bench_fail("binary records are not smaller than text lines (%u bytes against %u)\n", Bytes[1], Bytes[0]);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_publish_complete_cb() */
+/* ============================================================================================================================================================= *\
+                                                        Completion callback of the publish requests of the benchmark.
+\* ============================================================================================================================================================= */
+static void bench_publish_complete_cb(const struct mqtt_request *Request, err_t Result)
+{
+  if (Result == ERR_OK) ++BenchPublishCompleted;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_pump_status_cb() */
+/* ============================================================================================================================================================= *\
+                                    Status callback of the module: count the requests to pump the queue from the core of lwIP.
+\* ============================================================================================================================================================= */
+static void bench_pump_status_cb(mqtt_ctx_t *Ctx, UINT16 Status)
+{
+  if (Status == MQTT_PUMP_REQUEST) ++BenchPumpRequests;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_publish() */
+/* ============================================================================================================================================================= *\
+                  Outbound publish burst: CPU cost of the request queue, then simulated throughput with a fixed broker round trip, compared to the
+                   previous way of doing it (one publish, then sleep_ms(100) to wait for the publish callback). The CPU cost is measured again once
+                                          core 1 reads the queue statistics (copied on each change from then on).
+\* ============================================================================================================================================================= */
+static void bench_publish(UINT32 Iterations)
+{
+  UINT32 Loop1UInt32;
+  UINT32 Messages;
+  UINT32 Requests;
+  UINT32 RoundTrips;
+
+  UINT64 ReaderNs;
+  UINT64 StartTime;
+
+  static UCHAR LongPayload[MAX_PAYLOAD_LENGTH];
+  static UCHAR LongTopic[MAX_TOPIC_LENGTH];
+
+  struct mqtt_statistics_snapshot Statistics;
+
+
+  /* CPU cost: keep the queue full, let the broker answer whenever lwIP has no free in-flight slot left. */
+  BenchPublishCompleted = 0;
+  RoundTrips            = 0;
+  StartTime             = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    while (mqtt_publish_async(&StructMQTT, BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Topic, BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Payload, strlen(BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Payload), 0, 0, bench_publish_complete_cb, NULL) == -2)
+    {
+      host_mqtt_poll(StructMQTT.MqttClientInstance);
+      ++RoundTrips;
+    }
+  }
+  while (mqtt_queue_depth(&StructMQTT, NULL))
+  {
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+    ++RoundTrips;
+  }
+  bench_report("publish through request queue", Iterations, bench_now_ns() - StartTime);
+  printf("    %u completed, %.2f broker round trips per publish, highest queue depth %u\n", BenchPublishCompleted, (double)RoundTrips / Iterations, StructMQTT.Queue.HighWater);
+  if (BenchPublishCompleted != Iterations) bench_fail("%u of %u queued publish completed\n", BenchPublishCompleted, Iterations);
+  if (RoundTrips > ((Iterations + MQTT_REQ_MAX_IN_FLIGHT - 1) / MQTT_REQ_MAX_IN_FLIGHT)) bench_fail("%u broker round trips for %u publish (%u in flight)\n", RoundTrips, Iterations, MQTT_REQ_MAX_IN_FLIGHT);
+
+  /* Simulated time: one second worth of publish with the previous handshake. */
+  Messages  = 0;
+  StartTime = time_us_64();
+  while ((time_us_64() - StartTime) < 1000000ull)
+  {
+    mqtt_publish(StructMQTT.MqttClientInstance, BenchMessage[0].Topic, BenchMessage[0].Payload, strlen(BenchMessage[0].Payload), 0, 0, mqtt_pub_request_cb, &StructMQTT);
+    sleep_ms(BENCH_ROUND_TRIP_MS);
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+    sleep_ms(100 - BENCH_ROUND_TRIP_MS);
+    ++Messages;
+  }
+  printf("publish + sleep_ms(100) handshake                 %6u publish/sec (simulated, %u ms round trip)\n", Messages, BENCH_ROUND_TRIP_MS);
+
+  /* Simulated time: one second worth of publish through the queue. */
+  BenchPublishCompleted = 0;
+  StartTime             = time_us_64();
+  while ((time_us_64() - StartTime) < 1000000ull)
+  {
+    while (mqtt_publish_async(&StructMQTT, BenchMessage[0].Topic, BenchMessage[0].Payload, strlen(BenchMessage[0].Payload), 0, 0, bench_publish_complete_cb, NULL) == 0);
+    sleep_ms(BENCH_ROUND_TRIP_MS);
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+  }
+  while (mqtt_queue_depth(&StructMQTT, NULL)) host_mqtt_poll(StructMQTT.MqttClientInstance);
+  printf("publish through request queue                     %6u publish/sec (simulated, %u ms round trip, %u in flight)\n", BenchPublishCompleted, BENCH_ROUND_TRIP_MS, MQTT_REQ_MAX_IN_FLIGHT);
+  if (BenchPublishCompleted < (MQTT_REQ_MAX_IN_FLIGHT * (1000 / BENCH_ROUND_TRIP_MS))) bench_fail("request queue does not keep %u publish in flight on each round trip\n", MQTT_REQ_MAX_IN_FLIGHT);
+
+  /* Publish from core 1 (ex: a message handler run by the engine): lwIP is left to core 0, which is asked once to pump the queue. */
+  BenchPublishCompleted = 0;
+  BenchPumpRequests     = 0;
+  StructMQTT.mqtt_status = bench_pump_status_cb;
+  Requests = host_mqtt_request_count(StructMQTT.MqttClientInstance);
+  host_set_core_num(1);
+  for (Loop1UInt32 = 0; Loop1UInt32 < MAX_MQTT_REQUESTS; ++Loop1UInt32)
+    mqtt_publish_async(&StructMQTT, BenchMessage[0].Topic, BenchMessage[0].Payload, strlen(BenchMessage[0].Payload), 0, 0, bench_publish_complete_cb, NULL);
+  host_set_core_num(0);
+  Requests = host_mqtt_request_count(StructMQTT.MqttClientInstance) - Requests;
+  mqtt_queue_pump(&StructMQTT);
+  while (mqtt_queue_depth(&StructMQTT, NULL)) host_mqtt_poll(StructMQTT.MqttClientInstance);
+  StructMQTT.mqtt_status = NULL;
+  printf("publish from core 1: %u queued   %u given to lwIP by core 1   %u pump requests to core 0   %u completed\n", MAX_MQTT_REQUESTS, Requests, BenchPumpRequests, BenchPublishCompleted);
+  if ((Requests != 0) || (BenchPumpRequests != 1) || (BenchPublishCompleted != MAX_MQTT_REQUESTS)) bench_fail("publish from core 1 not handed over to core 0\n");
+
+  /* Core 1 reads the queue statistics: the first read asks core 0 for a copy, then each change of the queue is copied. */
+  BenchPumpRequests      = 0;
+  StructMQTT.mqtt_status = bench_pump_status_cb;
+  host_set_core_num(1);
+  mqtt_snapshot_statistics(&StructMQTT, &Statistics);
+  host_set_core_num(0);
+  mqtt_queue_pump(&StructMQTT);
+  StructMQTT.mqtt_status = NULL;
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < (Iterations / 10); ++Loop1UInt32)
+  {
+    while (mqtt_publish_async(&StructMQTT, BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Topic, BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Payload, strlen(BenchMessage[Loop1UInt32 % BENCH_MESSAGES].Payload), 0, 0, bench_publish_complete_cb, NULL) == -2)
+      host_mqtt_poll(StructMQTT.MqttClientInstance);
+  }
+  while (mqtt_queue_depth(&StructMQTT, NULL)) host_mqtt_poll(StructMQTT.MqttClientInstance);
+  ReaderNs = bench_now_ns() - StartTime;
+  host_set_core_num(1);
+  mqtt_snapshot_statistics(&StructMQTT, &Statistics);
+  host_set_core_num(0);
+  printf("publish through request queue, core 1 reading statistics   %.1f ns/op   (%u pump request, %lu submitted in the copy of core 1, %lu in the queue)\n", (double)ReaderNs / (Iterations / 10), BenchPumpRequests, Statistics.TotalSubmitted, StructMQTT.Queue.TotalSubmitted);
+  if ((BenchPumpRequests != 1) || (Statistics.TotalSubmitted != StructMQTT.Queue.TotalSubmitted)) bench_fail("statistics read by core 1 are not up to date\n");
+  StructMQTT.Snapshot.Wanted = 0;  // other measurements run without reader on core 1.
+  StructMQTT.Snapshot.Served = 0;
+
+  /* Topic and payload as long as the receive buffers of the instance allow: queued like mqtt_publish() took them before the request queue. */
+  memset(LongTopic, 'T', sizeof(LongTopic) - 1);
+  memset(LongPayload, 'P', sizeof(LongPayload));
+  BenchPublishCompleted = 0;
+  Requests  = (mqtt_publish_async(&StructMQTT, LongTopic, LongPayload, sizeof(LongPayload), 0, 0, bench_publish_complete_cb, NULL) == 0);
+  Requests += (mqtt_publish_async(&StructMQTT, LongTopic, LongPayload, sizeof(LongPayload) + 1, 0, 0, bench_publish_complete_cb, NULL) == -1);
+  while (mqtt_queue_depth(&StructMQTT, NULL)) host_mqtt_poll(StructMQTT.MqttClientInstance);
+  printf("publish of a %u-character topic and a %u-byte payload: %u completed (one byte more: refused)\n", sizeof(LongTopic) - 1, sizeof(LongPayload), BenchPublishCompleted);
+  if ((Requests != 2) || (BenchPublishCompleted != 1)) bench_fail("publish as long as the receive buffers not queued\n");
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_latency() */
+/* ============================================================================================================================================================= *\
+                     Publish-to-ack latency histograms: QoS 1 publish with a 20 ms broker round trip, except 1 out of 50 which takes 300 ms (Wi-Fi
+                                                      retries), then QoS 0 publish answered right away.
+\* ============================================================================================================================================================= */
+static void bench_latency(void)
+{
+  UINT8 Loop1UInt8;
+
+  UINT32 Loop1UInt32;
+
+  UINT64 EndTime;
+  UINT64 StartTime;
+
+  struct mqtt_latency_report Report;
+
+
+  mqtt_reset_latency(&StructMQTT);
+  for (Loop1UInt32 = 0; Loop1UInt32 < 1000; ++Loop1UInt32)
+  {
+    mqtt_publish_async(&StructMQTT, BenchMessage[0].Topic, BenchMessage[0].Payload, strlen(BenchMessage[0].Payload), 1, 0, NULL, NULL);
+    sleep_ms(((Loop1UInt32 % 50) == 49) ? 300 : BENCH_ROUND_TRIP_MS);
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+  }
+  for (Loop1UInt32 = 0; Loop1UInt32 < 1000; ++Loop1UInt32)
+  {
+    mqtt_publish_async(&StructMQTT, BenchMessage[0].Topic, BenchMessage[0].Payload, strlen(BenchMessage[0].Payload), 0, 0, NULL, NULL);
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+  }
+
+  for (Loop1UInt8 = 0; Loop1UInt8 < 2; ++Loop1UInt8)
+  {
+    StartTime = bench_now_ns();
+    mqtt_get_latency(&StructMQTT, Loop1UInt8, &Report);
+    EndTime = bench_now_ns();
+    printf("publish-to-ack latency, QoS %u:                    %u publish   average %lu usec   p50 %lu usec   p99 %lu usec   max %lu usec   (query: %llu ns)\n",
+           Loop1UInt8, Report.Count, Report.Average, Report.P50, Report.P99, Report.Max, EndTime - StartTime);
+
+    /* Percentiles are the upper limit of their histogram bucket (4 buckets per power of 2): up to 19 % above the latency itself. */
+    if (Report.Count != 1000) bench_fail("%u QoS %u publish-to-ack latencies recorded instead of 1000\n", Report.Count, Loop1UInt8);
+    if (Loop1UInt8 == 0)
+    {
+      /* QoS 0: answered right away, before any broker round trip. */
+      if (Report.P99 >= (BENCH_ROUND_TRIP_MS * 1000)) bench_fail("QoS 0 publish-to-ack p99 of %lu usec (answered without round trip)\n", Report.P99);
+    }
+    else
+    {
+      /* QoS 1: one round trip for 49 publish out of 50 (p50), the 2 % taking 300 ms are the p99 and the maximum. */
+      if ((Report.P50 < (BENCH_ROUND_TRIP_MS * 1000)) || (Report.P50 > (BENCH_ROUND_TRIP_MS * 1190))) bench_fail("QoS 1 publish-to-ack p50 of %lu usec for a %u ms round trip\n", Report.P50, BENCH_ROUND_TRIP_MS);
+      if ((Report.P99 < 300000) || (Report.P99 > 357000) || (Report.Max > 357000)) bench_fail("QoS 1 publish-to-ack p99 of %lu usec and maximum of %lu usec for 2 %% of publish taking 300 ms\n", Report.P99, Report.Max);
+    }
+  }
+  mqtt_reset_latency(&StructMQTT);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_subscribe() */
+/* ============================================================================================================================================================= *\
+                      Time to get ready after a (re)connection with <FilterCount> topic filters: one subscribe request at a time followed by sleep_ms(300)
+                 (the previous mqtt_device_subscribe()), against one pipelined list (mqtt_subscribe_list()). A list longer than the request queue is
+                                              also checked against a connection lost in the middle of the list.
+\* ============================================================================================================================================================= */
+static void bench_subscribe(UINT8 FilterCount)
+{
+  UCHAR Filter[BENCH_FILTERS][32];
+
+  UINT8 Loop1UInt8;
+  UINT8 RoundTrips;
+
+  UINT16 Polls;
+
+  UINT64 SequentialTime;
+  UINT64 StartTime;
+
+  struct mqtt_reconnect       Reconnect;
+  struct mqtt_subscribe_batch Batch;
+  struct mqtt_subscription    List[BENCH_FILTERS];
+
+
+  if (FilterCount > BENCH_FILTERS) FilterCount = BENCH_FILTERS;
+
+  memset(&Batch, 0x00, sizeof(Batch));
+  for (Loop1UInt8 = 0; Loop1UInt8 < FilterCount; ++Loop1UInt8)
+  {
+    sprintf(Filter[Loop1UInt8], "Bench%u/#", Loop1UInt8);
+    List[Loop1UInt8].Filter = Filter[Loop1UInt8];
+    List[Loop1UInt8].QoS    = 1;
+  }
+
+  /* Previous way: one filter at a time, then wait for the callback. */
+  StartTime = time_us_64();
+  for (Loop1UInt8 = 0; Loop1UInt8 < FilterCount; ++Loop1UInt8)
+  {
+    mqtt_subscribe(StructMQTT.MqttClientInstance, Filter[Loop1UInt8], 1, mqtt_sub_request_cb, &StructMQTT);
+    sleep_ms(BENCH_ROUND_TRIP_MS);
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+    sleep_ms(300 - BENCH_ROUND_TRIP_MS);
+  }
+  SequentialTime = time_us_64() - StartTime;
+
+  /* Pipelined list: each poll is one broker round trip. */
+  RoundTrips = 0;
+  StartTime  = time_us_64();
+  mqtt_subscribe_list(&StructMQTT, &Batch, List, FilterCount, NULL, NULL);
+  while (Batch.Remaining)
+  {
+    sleep_ms(BENCH_ROUND_TRIP_MS);
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+    ++RoundTrips;
+  }
+
+  printf("subscribe %u filters: sleep_ms(300) each %6.0f ms   pipelined list %4.0f ms (%u round trips, %u failed, simulated)\n", FilterCount, SequentialTime / 1e3, (time_us_64() - StartTime) / 1e3, RoundTrips, Batch.Failed);
+  if (Batch.Failed) bench_fail("%u of %u topic filters failed\n", Batch.Failed, FilterCount);
+  if (RoundTrips != ((FilterCount + MQTT_REQ_MAX_IN_FLIGHT - 1) / MQTT_REQ_MAX_IN_FLIGHT)) bench_fail("%u round trips to subscribe %u filters (%u in flight)\n", RoundTrips, FilterCount, MQTT_REQ_MAX_IN_FLIGHT);
+
+  /* Connection lost while the list is in progress: filters in flight are queued again and sent after the next CONNACK. */
+  if (FilterCount > MAX_MQTT_REQUESTS)
+  {
+    Reconnect = StructMQTT.Reconnect;  // the reconnection benchmarks start from the same jitter sequence.
+    mqtt_subscribe_list(&StructMQTT, &Batch, List, FilterCount, NULL, NULL);
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+    host_mqtt_drop_connection(StructMQTT.MqttClientInstance);
+    mqtt_check_connection(&StructMQTT, FLAG_ON);
+    bench_mqtt_initialization(&StructMQTT);
+    for (Polls = 0; (Batch.Remaining) && (Polls < 1000); ++Polls) host_mqtt_poll(StructMQTT.MqttClientInstance);
+    StructMQTT.Reconnect = Reconnect;
+    printf("    connection lost in the middle of the list: %u of %u filters answered, %u failed\n", FilterCount - Batch.Remaining, FilterCount, Batch.Failed);
+    if ((Batch.Remaining) || (Batch.Failed)) bench_fail("topic filters lost with the connection have not been subscribed again\n");
+  }
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_reconnect() */
+/* ============================================================================================================================================================= *\
+                      Broker outage: simulated time needed to get back online. The health check runs every 15 seconds, right away when the connection
+                           is lost and, while the broker is down, when the reconnection policy allows the next attempt (same as task_health_check()).
+                      After each check, core 1 displays the connection status and an early check is made: neither may use up a reconnection attempt.
+                                                           Return the time needed to reconnect (usec).
+\* ============================================================================================================================================================= */
+static UINT64 bench_reconnect(UINT32 OutageSec, UINT8 FlagDisplay)
+{
+  INT16 ReturnCode;
+  INT16 Status;
+
+  UINT32 Attempts;
+  UINT32 Checks;
+  UINT32 Delay;
+  UINT32 Unexpected;
+
+  UINT64 CurrentTimer;
+  UINT64 DropTime;
+  UINT64 NextCheck;
+
+
+  host_mqtt_drop_connection(StructMQTT.MqttClientInstance);
+  host_mqtt_set_broker_available(FLAG_OFF);
+
+  Checks     = 0;
+  Unexpected = 0;
+  DropTime   = time_us_64();
+  NextCheck  = DropTime;  // mqtt_status_cb() wakes the health check right away.
+  while (mqtt_client_is_connected(StructMQTT.MqttClientInstance) == 0)
+  {
+    CurrentTimer = time_us_64();
+    if ((CurrentTimer - DropTime) >= (OutageSec * 1000000ull)) host_mqtt_set_broker_available(FLAG_ON);
+
+    if (CurrentTimer >= NextCheck)
+    {
+      ++Checks;
+      ReturnCode = mqtt_check_connection(&StructMQTT, FLAG_ON);
+      if (ReturnCode == 1) bench_mqtt_initialization(&StructMQTT);
+
+      Attempts = StructMQTT.Reconnect.TotalAttempts;
+      host_set_core_num(1);
+      Status = mqtt_get_connection_status(&StructMQTT);
+      host_set_core_num(0);
+      if ((ReturnCode == 1) && (mqtt_check_connection(&StructMQTT, FLAG_ON) != 2)) ++Unexpected;
+      if ((ReturnCode < 0) || (Status != 1) || (Attempts != StructMQTT.Reconnect.TotalAttempts)) ++Unexpected;
+
+      NextCheck = CurrentTimer + 15000000ull;
+      Delay     = mqtt_reconnect_delay(&StructMQTT);
+      if ((ReturnCode != 0) && (Delay < 15000)) NextCheck = CurrentTimer + (Delay * 1000ull);
+    }
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+    sleep_ms(10);
+  }
+  mqtt_check_connection(&StructMQTT, FLAG_ON);  // next health check sees the connection restored.
+
+  if (FlagDisplay)
+    printf("broker outage of %4u sec                         back online after %6.1f sec (simulated)   %u attempts   %u connection checks\n", OutageSec, StructMQTT.Reconnect.LastTimeToReconnect / 1e6, StructMQTT.Reconnect.LastAttempts, Checks);
+  if (Unexpected) bench_fail("%u connection checks with an unexpected status, or display and early checks using up reconnection attempts\n", Unexpected);
+
+  /* Once the broker is back, the next attempt comes at most MQTT_RECONNECT_MAX later, seen by the next health check (15 seconds). */
+  if ((StructMQTT.Reconnect.LastTimeToReconnect < (OutageSec * 1000000ull)) || (StructMQTT.Reconnect.LastTimeToReconnect > ((OutageSec * 1000000ull) + (MQTT_RECONNECT_MAX * 1000ull) + 15000000ull)))
+    bench_fail("back online %.1f sec after a broker outage of %u sec (maximum reconnection delay: %u sec)\n", StructMQTT.Reconnect.LastTimeToReconnect / 1e6, OutageSec, MQTT_RECONNECT_MAX / 1000);
+
+  return StructMQTT.Reconnect.LastTimeToReconnect;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_reconnect_fleet() */
+/* ============================================================================================================================================================= *\
+                   Broker restart seen by <Devices> devices at the same time: the jitter, seeded from each unique board ID, spreads their reconnections.
+\* ============================================================================================================================================================= */
+static void bench_reconnect_fleet(UINT8 Devices, UINT32 OutageSec)
+{
+  UCHAR UniqueId[40];
+
+  UINT8 Loop1UInt8;
+
+  UINT64 MaxTime;
+  UINT64 MinTime;
+  UINT64 Time;
+
+
+  strcpy(UniqueId, StructMQTT.PicoUniqueId);
+  MinTime = ~0ull;
+  MaxTime = 0;
+  for (Loop1UInt8 = 0; Loop1UInt8 < Devices; ++Loop1UInt8)
+  {
+    sprintf(StructMQTT.PicoUniqueId, "E661-4103-E72C-%4.4X", 0x2400 + Loop1UInt8);
+    StructMQTT.Reconnect.Seed = 0;  // seed again from the new unique ID.
+    Time = bench_reconnect(OutageSec, FLAG_OFF);
+    if (Time < MinTime) MinTime = Time;
+    if (Time > MaxTime) MaxTime = Time;
+  }
+  strcpy(StructMQTT.PicoUniqueId, UniqueId);
+  StructMQTT.Reconnect.Seed = 0;
+
+  printf("broker restart of %3u sec seen by %u devices:    reconnections spread from %6.1f to %6.1f sec (simulated, fixed 60 sec retries: all at the same time)\n", OutageSec, Devices, MinTime / 1e6, MaxTime / 1e6);
+  if ((MaxTime - MinTime) < 1000000ull) bench_fail("%u devices reconnect within one second of each other\n", Devices);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_session() */
+/* ============================================================================================================================================================= *\
+                   Short broker outage with a device having 4 topic filters, while 3 commands are published for it: clean session (filters subscribed
+                        again, commands lost) against persistent session (session resumed without any SUBSCRIBE, commands delivered on reconnection).
+\* ============================================================================================================================================================= */
+static void bench_session(UINT8 FlagPersistent)
+{
+  UINT8 Loop1UInt8;
+  UINT8 RoundTrips;
+
+  UINT64 StartTime;
+
+
+  mqtt_set_persistent_session(&StructMQTT, FlagPersistent);
+  host_mqtt_clear_sessions();
+  for (Loop1UInt8 = 0; Loop1UInt8 < 4; ++Loop1UInt8)
+  {
+    sprintf(BenchSessionFilter[Loop1UInt8], "Session%u/#", Loop1UInt8);
+    BenchSessionList[Loop1UInt8].Filter = BenchSessionFilter[Loop1UInt8];
+    BenchSessionList[Loop1UInt8].QoS    = 1;
+  }
+  strcpy(BenchSessionFilter[0], "Control/#");  // commands of this device.
+
+  /* First connection in this mode: the session is new, filters are subscribed. */
+  host_mqtt_drop_connection(StructMQTT.MqttClientInstance);
+  mqtt_check_connection(&StructMQTT, FLAG_ON);
+  bench_mqtt_initialization(&StructMQTT);
+  host_mqtt_poll(StructMQTT.MqttClientInstance);
+  mqtt_session_subscribe(&StructMQTT, &BenchSessionBatch, BenchSessionList, 4, NULL, NULL);
+  while (BenchSessionBatch.Remaining) host_mqtt_poll(StructMQTT.MqttClientInstance);
+
+  /* Outage: commands are published for this device while it is offline. */
+  host_mqtt_drop_connection(StructMQTT.MqttClientInstance);
+  mqtt_check_connection(&StructMQTT, FLAG_ON);
+  BenchHandlerCalls = 0;
+  for (Loop1UInt8 = 0; Loop1UInt8 < 3; ++Loop1UInt8) host_mqtt_inject_publish(StructMQTT.MqttClientInstance, "Control/Command00/Session", "1", 1);
+
+  /* Reconnection: ready when all filters are subscribed again (each poll is one broker round trip). The CONNECT packet wraps around the end
+     of lwIP output ring buffer, in the middle of the protocol name: its clean session flag must be turned Off all the same. */
+  RoundTrips = 0;
+  StartTime  = time_us_64();
+  host_mqtt_set_output_start(MQTT_OUTPUT_RINGBUF_SIZE - 6);
+  bench_mqtt_initialization(&StructMQTT);
+  host_mqtt_set_output_start(0);
+  sleep_ms(BENCH_ROUND_TRIP_MS);
+  host_mqtt_poll(StructMQTT.MqttClientInstance);
+  while (BenchSessionBatch.Remaining)
+  {
+    sleep_ms(BENCH_ROUND_TRIP_MS);
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+    ++RoundTrips;
+  }
+
+  printf("reconnect, %s session:   session present: %u   %u SUBSCRIBE round trips   ready after %5.0f ms   %u/3 offline commands received (simulated)\n",
+         (FlagPersistent ? "persistent" : "clean     "), StructMQTT.Session.FlagPresent, RoundTrips, (time_us_64() - StartTime) / 1e3, BenchHandlerCalls);
+  if (StructMQTT.Session.FlagPresent != FlagPersistent) bench_fail("clean session flag of a CONNECT packet wrapping around lwIP output buffer not handled\n");
+  if (FlagPersistent && ((RoundTrips != 0) || (BenchHandlerCalls != 3))) bench_fail("persistent session resumed with %u SUBSCRIBE round trips and %u/3 offline commands\n", RoundTrips, BenchHandlerCalls);
+  if ((FlagPersistent == FLAG_OFF) && (BenchHandlerCalls != 0)) bench_fail("%u offline commands received with a clean session\n", BenchHandlerCalls);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_boot() */
+/* ============================================================================================================================================================= *\
+                    Boot phases from the IP address to the device online (4 topic filters of the replay cache subscribed), with a clean session. The
+                                  previous mqtt_initialization() added 800 msec of sleep_ms() between the IP address and the CONNECT packet.
+\* ============================================================================================================================================================= */
+static void bench_boot(void)
+{
+  UINT64 StartTime;
+
+
+  mqtt_set_persistent_session(&StructMQTT, FLAG_OFF);
+  host_mqtt_clear_sessions();
+  host_mqtt_drop_connection(StructMQTT.MqttClientInstance);
+  mqtt_check_connection(&StructMQTT, FLAG_ON);
+  memset(&StructMQTT.Boot, 0x00, sizeof(StructMQTT.Boot));
+
+  /* IP address received: the health check connects to the broker right away, the filters are pipelined on CONNACK. */
+  StartTime = time_us_64();
+  mqtt_boot_mark(&StructMQTT, MQTT_BOOT_DHCP);
+  bench_mqtt_initialization(&StructMQTT);
+  while (StructMQTT.Boot.FlagReached[MQTT_BOOT_SUBACK] == FLAG_OFF)
+  {
+    sleep_ms(BENCH_ROUND_TRIP_MS);
+    host_mqtt_poll(StructMQTT.MqttClientInstance);
+  }
+
+  printf("boot from IP address:   connect request %5.1f ms   CONNACK %5.1f ms   SUBACK %5.1f ms   (simulated, previous sequence: 800 ms more)\n",
+         (mqtt_boot_time(&StructMQTT, MQTT_BOOT_CONNECT) - StartTime) / 1e3, (mqtt_boot_time(&StructMQTT, MQTT_BOOT_CONNACK) - StartTime) / 1e3, (mqtt_boot_time(&StructMQTT, MQTT_BOOT_SUBACK) - StartTime) / 1e3);
+  if ((mqtt_boot_time(&StructMQTT, MQTT_BOOT_SUBACK) - StartTime) >= (3 * BENCH_ROUND_TRIP_MS * 1000ull)) bench_fail("device not online within 2 round trips of its IP address\n");
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_engine_thread() */
+/* ============================================================================================================================================================= *\
+                            Simulated core 1 of bench_engine(): start the MQTT engine, then run its SIO FIFO interrupt until told to stop.
+\* ============================================================================================================================================================= */
+static void *bench_engine_thread(void *Argument)
+{
+  host_set_core_num(1);
+  mqtt_engine_start(&StructMQTT, bench_process_message);
+  while (BenchEngineStop == FLAG_OFF) host_irq_wait();
+
+  return NULL;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_engine() */
+/* ============================================================================================================================================================= *\
+                     Incoming publishes to the 40 command handlers of bench_router(), each with BENCH_ENGINE_WORK_NS of application work: processed
+                   in the lwIP callback of core 0, against handed off to the MQTT engine of core 1. Core 0 time is the time spent in the callbacks.
+                           When all slots are in use, the next publish is held back, the same way the TCP window would hold it back.
+\* ============================================================================================================================================================= */
+static void bench_engine(UINT32 Iterations)
+{
+  UCHAR Topic[BENCH_COMMANDS][48];
+
+  UINT8 Loop1UInt8;
+
+  UINT32 Loop1UInt32;
+
+  UINT64 CallbackTime;
+  UINT64 Core0Time;
+  UINT64 StartTime;
+
+  pthread_t Core1;
+
+
+  for (Loop1UInt8 = 0; Loop1UInt8 < BENCH_COMMANDS; ++Loop1UInt8)
+    sprintf(Topic[Loop1UInt8], "Control/%s/SoundServer1", BenchCommand[Loop1UInt8]);
+  BenchWorkNs = BENCH_ENGINE_WORK_NS;
+
+  /* Handlers run in the lwIP callback of core 0. */
+  BenchHandlerCalls = 0;
+  Core0Time         = 0;
+  StartTime         = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    CallbackTime = bench_now_ns();
+    host_mqtt_inject_publish(StructMQTT.MqttClientInstance, Topic[Loop1UInt32 % BENCH_COMMANDS], "35/80", 5);
+    Core0Time += bench_now_ns() - CallbackTime;
+  }
+  printf("incoming publish, handlers on core 0       %8u messages   core 0: %7.0f ns/message   %9.0f messages/sec\n", Iterations, (double)Core0Time / Iterations, (Iterations * 1e9) / (double)(bench_now_ns() - StartTime));
+  if (BenchHandlerCalls != Iterations) bench_fail("%u handler calls instead of %u\n", BenchHandlerCalls, Iterations);
+
+  /* Messages handed off to core 1. */
+  BenchEngineStop = FLAG_OFF;
+  pthread_create(&Core1, NULL, bench_engine_thread, NULL);
+  while (StructMQTT.Engine.FlagOn == FLAG_OFF) sched_yield();
+
+  BenchHandlerCalls = 0;
+  Core0Time         = 0;
+  StartTime         = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    while ((StructMQTT.Engine.Head - StructMQTT.Engine.Tail) >= StructMQTT.Engine.SlotCount) sched_yield();
+    CallbackTime = bench_now_ns();
+    host_mqtt_inject_publish(StructMQTT.MqttClientInstance, Topic[Loop1UInt32 % BENCH_COMMANDS], "35/80", 5);
+    Core0Time += bench_now_ns() - CallbackTime;
+  }
+  while (StructMQTT.Engine.Tail != StructMQTT.Engine.Head) sched_yield();
+  printf("incoming publish, MQTT engine on core 1    %8u messages   core 0: %7.0f ns/message   %9.0f messages/sec   (highest: %u of %u slots, %u dropped, %ld host CPUs)\n", Iterations, (double)Core0Time / Iterations, (Iterations * 1e9) / (double)(bench_now_ns() - StartTime), StructMQTT.Engine.HighWater, StructMQTT.Engine.SlotCount, StructMQTT.Engine.Dropped, sysconf(_SC_NPROCESSORS_ONLN));
+  if (BenchHandlerCalls != Iterations) bench_fail("%u handler calls instead of %u\n", BenchHandlerCalls, Iterations);
+  if (StructMQTT.Engine.Dropped) bench_fail("%u messages dropped by the MQTT engine while core 0 was holding them back\n", StructMQTT.Engine.Dropped);
+
+  /* Stop core 1 and process the next messages on core 0 again. */
+  BenchEngineStop = FLAG_ON;
+  multicore_fifo_push_blocking(0);
+  pthread_join(Core1, NULL);
+  StructMQTT.Engine.FlagOn = FLAG_OFF;
+  BenchWorkNs = 0;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_snapshot_check() */
+/* ============================================================================================================================================================= *\
+                             Return 0 if a message of bench_snapshot() is consistent: its payload is the number of its topic, repeated.
+\* ============================================================================================================================================================= */
+static UINT8 bench_snapshot_check(const UCHAR *Topic, const UCHAR *Payload)
+{
+  UCHAR Expected[BENCH_SNAPSHOT_PAYLOAD + 16];
+
+  UINT32 Number;
+
+
+  if (sscanf(Topic, "Snapshot/%u", &Number) != 1) return 1;
+
+  Expected[0] = '\0';
+  while (strlen(Expected) < BENCH_SNAPSHOT_PAYLOAD) sprintf(&Expected[strlen(Expected)], "%u/", Number);
+
+  return (strcmp(Payload, Expected) ? 1 : 0);
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_snapshot_thread() */
+/* ============================================================================================================================================================= *\
+                   Simulated core 1 of bench_snapshot(): copy the last message with mqtt_snapshot_message() and, for comparison, straight from the
+                   buffers of core 0 (as mqtt_display_client() did), until told to stop. Copies are checked once core 0 has received the first message
+                                           of bench_snapshot() (<Argument> points to the number of messages received before).
+\* ============================================================================================================================================================= */
+static void *bench_snapshot_thread(void *Argument)
+{
+  static struct mqtt_message_snapshot Message;
+  static UCHAR                        HeldTopic[MAX_TOPIC_LENGTH];
+  static UCHAR                        LivePayload[MAX_PAYLOAD_LENGTH];
+  static UCHAR                        LiveTopic[MAX_TOPIC_LENGTH];
+  static UCHAR                        MessagePayload[MAX_PAYLOAD_LENGTH];
+  static UCHAR                        MessageTopic[MAX_TOPIC_LENGTH];
+
+
+  host_set_core_num(1);
+  Message.Topic   = MessageTopic;
+  Message.Payload = MessagePayload;
+  while (BenchSnapshotStop == FLAG_OFF)
+  {
+    mqtt_snapshot_message(&StructMQTT, &Message);
+    if (Message.Number <= *(UINT32 *)Argument) continue;
+
+    ++BenchSnapshotReads;
+    if (bench_snapshot_check(Message.Topic, Message.Payload)) ++BenchSnapshotTorn;
+
+    memcpy(LiveTopic,   StructMQTT.Topic,   sizeof(LiveTopic));
+    memcpy(LivePayload, StructMQTT.Payload, sizeof(LivePayload));
+    LiveTopic[MAX_TOPIC_LENGTH - 1]     = '\0';
+    LivePayload[MAX_PAYLOAD_LENGTH - 1] = '\0';
+    if (bench_snapshot_check(LiveTopic, LivePayload)) ++BenchLiveTorn;
+
+    /* Topic and payload taken from two calls to mqtt_get_view(), as mqtt_process_message() does, while core 0 keeps on receiving. */
+    mqtt_hold_view(&StructMQTT, FLAG_ON);
+    strcpy(HeldTopic, mqtt_get_view(&StructMQTT)->Topic);
+    sched_yield();
+    if (bench_snapshot_check(HeldTopic, mqtt_get_view(&StructMQTT)->Payload)) ++BenchViewMixed;
+    mqtt_hold_view(&StructMQTT, FLAG_OFF);
+  }
+
+  return NULL;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_snapshot() */
+/* ============================================================================================================================================================= *\
+                   Incoming publishes on core 0 while core 1 keeps on reading the last message: every copy taken with mqtt_snapshot_message() must be
+                     consistent, while copies taken straight from the buffers of core 0 catch messages being received. Core 0 time includes the
+                                                                  snapshot of each message.
+\* ============================================================================================================================================================= */
+static void bench_snapshot(UINT32 Iterations)
+{
+  UCHAR Payload[BENCH_SNAPSHOT_PAYLOAD + 16];
+  UCHAR Topic[32];
+
+  UINT32 Loop1UInt32;
+  UINT32 Received;
+  UINT32 Retries;
+
+  UINT64 CallbackTime;
+  UINT64 Core0Time;
+
+  pthread_t Core1;
+
+
+  BenchSnapshotReads = 0;
+  BenchSnapshotTorn  = 0;
+  BenchLiveTorn      = 0;
+  BenchViewMixed     = 0;
+  BenchSnapshotStop  = FLAG_OFF;
+  Retries            = StructMQTT.Snapshot.MessageLock.Retries;
+  Received           = StructMQTT.Snapshot.MessageNumber;
+  pthread_create(&Core1, NULL, bench_snapshot_thread, &Received);
+
+  Core0Time = 0;
+  for (Loop1UInt32 = 1; Loop1UInt32 <= Iterations; ++Loop1UInt32)
+  {
+    sprintf(Topic, "Snapshot/%u", Loop1UInt32);
+    Payload[0] = '\0';
+    while (strlen(Payload) < BENCH_SNAPSHOT_PAYLOAD) sprintf(&Payload[strlen(Payload)], "%u/", Loop1UInt32);
+
+    CallbackTime = bench_now_ns();
+    host_mqtt_inject_publish(StructMQTT.MqttClientInstance, Topic, Payload, strlen(Payload));
+    Core0Time += bench_now_ns() - CallbackTime;
+  }
+
+  BenchSnapshotStop = FLAG_ON;
+  pthread_join(Core1, NULL);
+
+  printf("incoming publish with snapshot, core 1 reading   %8u messages   core 0: %7.0f ns/message   (%ld host CPUs)\n", Iterations, (double)Core0Time / Iterations, sysconf(_SC_NPROCESSORS_ONLN));
+  printf("   core 1 copies: %u   inconsistent snapshots: %u   retries: %u   inconsistent copies of the live buffers: %u   mixed held views: %u\n", BenchSnapshotReads, BenchSnapshotTorn, StructMQTT.Snapshot.MessageLock.Retries - Retries, BenchLiveTorn, BenchViewMixed);
+  if (BenchSnapshotTorn) bench_fail("%u inconsistent snapshots\n", BenchSnapshotTorn);
+  if (BenchViewMixed)    bench_fail("%u held views mixing two messages\n", BenchViewMixed);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_instance_handler() */
+/* ============================================================================================================================================================= *\
+                                          Handler registered by bench_instances(): count the messages of the instance given as context.
+\* ============================================================================================================================================================= */
+static void bench_instance_handler(const struct mqtt_view *View, void *Context)
+{
+  ++*(UINT32 *)Context;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_instances() */
+/* ============================================================================================================================================================= *\
+                     Two MQTT instances of the same device (main broker and backup broker) receiving interleaved messages: each instance must see
+                                     only the messages of its own broker, in its own buffers and through its own topic router.
+\* ============================================================================================================================================================= */
+static void bench_instances(UINT32 Iterations)
+{
+  UINT32 BackupCalls;
+  UINT32 Loop1UInt32;
+  UINT32 MainCalls;
+
+  UINT64 StartTime;
+
+
+  if (mqtt_ctx_init(&BenchBackup, BenchBackupTopic, sizeof(BenchBackupTopic), BenchBackupPayload, sizeof(BenchBackupPayload), BenchBackupArena, sizeof(BenchBackupArena), 0))
+  {
+    bench_fail("unable to initialize the second MQTT instance\n");
+    return;
+  }
+  ip4addr_aton(BENCH_BACKUP_BROKER_IP, &BenchBackup.BrokerAddress);
+  if (mqtt_check_connection(&BenchBackup, FLAG_ON) == 1) bench_mqtt_initialization(&BenchBackup);
+  host_mqtt_poll(BenchBackup.MqttClientInstance);
+  if (mqtt_client_is_connected(BenchBackup.MqttClientInstance) == 0)
+  {
+    bench_fail("second MQTT instance is not connected\n");
+    return;
+  }
+
+  MainCalls   = 0;
+  BackupCalls = 0;
+  mqtt_register_handler(&StructMQTT,  "Instance/+/Main",   bench_instance_handler, &MainCalls);
+  mqtt_register_handler(&BenchBackup, "Instance/+/Backup", bench_instance_handler, &BackupCalls);
+
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    if (Loop1UInt32 & 1)
+      host_mqtt_inject_publish(BenchBackup.MqttClientInstance, "Instance/Volume/Backup", "35", 2);
+    else
+      host_mqtt_inject_publish(StructMQTT.MqttClientInstance, "Instance/Volume/Main", "80/2", 4);
+  }
+  bench_report("incoming publish, two instances interleaved", Iterations, bench_now_ns() - StartTime);
+
+  printf("   main broker %s: %u messages   backup broker %s: %u messages (%u-byte buffers)\n", MQTT_BROKER_IP, MainCalls, BENCH_BACKUP_BROKER_IP, BackupCalls, BENCH_BACKUP_BUFFER);
+  if ((MainCalls != ((Iterations + 1) / 2)) || (BackupCalls != (Iterations / 2))) bench_fail("messages routed to the wrong instance\n");
+  if ((Iterations > 1) && ((strcmp(BenchBackup.Topic, "Instance/Volume/Backup") != 0) || (strcmp(BenchBackup.Payload, "35") != 0))) bench_fail("second instance buffers overwritten\n");
+  if ((strcmp(StructMQTT.Topic, "Instance/Volume/Main") != 0) || (strcmp(StructMQTT.Payload, "80/2") != 0)) bench_fail("first instance buffers overwritten\n");
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_breakdown() */
+/* ============================================================================================================================================================= *\
+                  Record breakdowns in the history (start, end and duration of the most recent one). The history is saved and given back after the
+                                                         benchmark so that the outages of the other benchmarks are kept.
+\* ============================================================================================================================================================= */
+static void bench_breakdown(UINT32 Iterations)
+{
+  static struct mqtt_breakdown_history Saved;
+
+  UINT32 Loop1UInt32;
+
+  UINT64 EndTime;
+  UINT64 StartTime;
+  UINT64 Total;
+
+
+  memcpy(&Saved, &StructMQTT.Breakdown, sizeof(Saved));
+  Total     = 0;
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    mqtt_breakdown_start(&StructMQTT);
+    mqtt_breakdown_end(&StructMQTT);
+    Total += mqtt_breakdown_duration(&StructMQTT, 0);
+  }
+  EndTime = bench_now_ns();
+  bench_report("breakdown history (start + end + duration)", Iterations, EndTime - StartTime);
+  printf("breakdown history: %u entries kept in %u bytes   (measured durations: %llu usec)\n", StructMQTT.Breakdown.Count, (UINT32)sizeof(StructMQTT.Breakdown), Total);
+  if ((Iterations >= MAX_MQTT_BREAKDOWN_HISTORY) && (StructMQTT.Breakdown.Count != MAX_MQTT_BREAKDOWN_HISTORY)) bench_fail("%u breakdowns kept instead of %u\n", StructMQTT.Breakdown.Count, MAX_MQTT_BREAKDOWN_HISTORY);
+  memcpy(&StructMQTT.Breakdown, &Saved, sizeof(Saved));
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_availability() */
+/* ============================================================================================================================================================= *\
+                     Connection availability after <Days> simulated days with a 60-second broker outage every 12 hours (on top of the outages of
+                                          the previous benchmarks, which get out of the one-week rolling window as days go by).
+\* ============================================================================================================================================================= */
+static void bench_availability(UINT16 Days)
+{
+  UINT16 Loop1UInt16;
+
+  UINT64 EndTime;
+  UINT64 StartTime;
+
+  struct mqtt_availability_report Report;
+
+
+  for (Loop1UInt16 = 0; Loop1UInt16 < (Days * 2); ++Loop1UInt16)
+  {
+    sleep_ms(12 * 3600 * 1000);
+    bench_reconnect(60, FLAG_OFF);
+  }
+
+  StartTime = bench_now_ns();
+  mqtt_get_availability(&StructMQTT, &Report);
+  EndTime = bench_now_ns();
+
+  printf("availability after %u days (simulated):           %u.%2.2u %%   last %u hours: %u.%2.2u %%   %u failures   MTBF %llu sec   MTTR %llu sec   longest %llu sec   (query: %llu ns)\n",
+         Days, Report.Availability / 100, Report.Availability % 100, (Report.WindowLength + 3599) / 3600, Report.WindowAvailability / 100, Report.WindowAvailability % 100,
+         Report.Failures, Report.MTBF / 1000000, Report.MTTR / 1000000, Report.LongestOutage / 1000000, EndTime - StartTime);
+  if ((Report.Failures < (Days * 2)) || (Report.LongestOutage < 60000000ull) || (Report.WindowAvailability >= 10000))
+    bench_fail("availability does not account for the %u broker outages of 60 sec\n", Days * 2);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_route_handler() */
+/* ============================================================================================================================================================= *\
+                                                          Handler registered in the topic router by bench_router().
+\* ============================================================================================================================================================= */
+static void bench_route_handler(const struct mqtt_view *View, void *Context)
+{
+  ++BenchHandlerCalls;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_router() */
+/* ============================================================================================================================================================= *\
+                  Topic dispatch of a device handling BENCH_COMMANDS commands: topic router (mqtt_dispatch()) against a chain of sub-topic compares.
+\* ============================================================================================================================================================= */
+static void bench_router(UINT32 Iterations)
+{
+  UCHAR Deep[((MAX_SUB_TOPICS + 1) * 2) + 1];
+  UCHAR Filter[32];
+  UCHAR Topic[BENCH_COMMANDS][48];
+
+  UINT8 Loop1UInt8;
+
+  UINT32 Loop1UInt32;
+
+  UINT64 StartTime;
+
+  const struct mqtt_view *View;
+
+
+  for (Loop1UInt8 = 0; Loop1UInt8 < BENCH_COMMANDS; ++Loop1UInt8)
+  {
+    sprintf(BenchCommand[Loop1UInt8], "Command%2.2u", Loop1UInt8);
+    sprintf(Topic[Loop1UInt8], "Control/%s/SoundServer1", BenchCommand[Loop1UInt8]);
+    sprintf(Filter, "+/%s/#", BenchCommand[Loop1UInt8]);
+    mqtt_register_handler(&StructMQTT, Filter, bench_route_handler, NULL);
+  }
+
+  /* Topic router. */
+  BenchHandlerCalls = 0;
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    mqtt_wipe_packet(&StructMQTT);
+    strcpy(StructMQTT.Topic, Topic[Loop1UInt32 % BENCH_COMMANDS]);
+    mqtt_dispatch(&StructMQTT);
+  }
+  bench_report("dispatch, topic router (40 commands)", Iterations, bench_now_ns() - StartTime);
+  if (BenchHandlerCalls != Iterations) bench_fail("%u handler calls instead of %u\n", BenchHandlerCalls, Iterations);
+
+  /* Chain of sub-topic compares, as mqtt_incoming_data_cb() used to do. */
+  BenchHandlerCalls = 0;
+  StartTime = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    mqtt_wipe_packet(&StructMQTT);
+    strcpy(StructMQTT.Topic, Topic[Loop1UInt32 % BENCH_COMMANDS]);
+    View = mqtt_get_view(&StructMQTT);
+    for (Loop1UInt8 = 0; Loop1UInt8 < BENCH_COMMANDS; ++Loop1UInt8)
+    {
+      if (mqtt_view_topic_is(View, 1, BenchCommand[Loop1UInt8]))
+      {
+        bench_route_handler(View, NULL);
+        break;
+      }
+    }
+  }
+  bench_report("dispatch, strcmp chain (40 commands)", Iterations, bench_now_ns() - StartTime);
+  if (BenchHandlerCalls != Iterations) bench_fail("%u handler calls instead of %u\n", BenchHandlerCalls, Iterations);
+
+  /* Exact filter of MAX_SUB_TOPICS levels: a topic one level deeper must not match it, a filter one level deeper must be refused. */
+  for (Loop1UInt8 = 0; Loop1UInt8 <= MAX_SUB_TOPICS; ++Loop1UInt8) strcpy(&Deep[Loop1UInt8 * 2], "D/");
+  Deep[(MAX_SUB_TOPICS * 2) - 1] = '\0';
+  mqtt_register_handler(&StructMQTT, Deep, bench_route_handler, NULL);
+  BenchHandlerCalls = 0;
+  mqtt_wipe_packet(&StructMQTT);
+  strcpy(StructMQTT.Topic, Deep);
+  mqtt_dispatch(&StructMQTT);
+  Deep[(MAX_SUB_TOPICS * 2) - 1] = '/';
+  Deep[(MAX_SUB_TOPICS * 2) + 1] = '\0';
+  mqtt_wipe_packet(&StructMQTT);
+  strcpy(StructMQTT.Topic, Deep);
+  mqtt_dispatch(&StructMQTT);
+  printf("topics of %u and %u levels against an exact filter of %u levels: %u of 2 dispatched (1 expected)\n", MAX_SUB_TOPICS, MAX_SUB_TOPICS + 1, MAX_SUB_TOPICS, BenchHandlerCalls);
+  if (BenchHandlerCalls != 1) bench_fail("topic deeper than MAX_SUB_TOPICS levels matched a shorter filter\n");
+  if (mqtt_register_handler(&StructMQTT, Deep, bench_route_handler, NULL) != -1) bench_fail("filter deeper than MAX_SUB_TOPICS levels accepted\n");
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_task() */
+/* ============================================================================================================================================================= *\
+                                              Scheduler tasks: periodic task counts its runs, event task measures its wake-up latency.
+\* ============================================================================================================================================================= */
+static void bench_task(void *Context)
+{
+  ++BenchTaskRuns;
+
+  return;
+}
+
+
+
+static void bench_event_task(void *Context)
+{
+  BenchEventLatency = time_us_64() - BenchSignalTime;
+
+  return;
+}
+
+
+
+static void *bench_event_thread(void *Argument)
+{
+  usleep(20000);
+  BenchSignalTime = time_us_64();
+  sched_signal(BENCH_EVENT);
+
+  return NULL;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_scheduler() */
+/* ============================================================================================================================================================= *\
+                Main loop wake-ups during <Seconds> of idle time with the tasks of Pico-MQTT-Example.c (15 seconds, 60 seconds and log drain): the
+                  previous loop woke up every 200 msec to check its timers, the timer wheel sleeps (WFE) until the next task is due. Then the latency between an event signaled by another
+                                                           thread (lwIP callback on the Pico) and the run of its task (real time).
+\* ============================================================================================================================================================= */
+static void bench_scheduler(UINT32 Seconds)
+{
+  UINT8 Loop1UInt8;
+
+  UINT32 StartWakeups;
+
+  UINT64 EndTime;
+  UINT64 MaxLatency;
+  UINT64 TotalLatency;
+
+  pthread_t Thread;
+
+
+  sched_init();
+  sched_add_task("15 seconds", 15000, 0, bench_task, NULL);
+  sched_add_task("60 seconds", 60000, 0, bench_task, NULL);
+  sched_add_task("Log drain", BENCH_LOG_DRAIN_MS, 0, bench_task, NULL);
+  sched_add_task("Event", 0, BENCH_EVENT, bench_event_task, NULL);
+
+  BenchTaskRuns = 0;
+  StartWakeups  = host_wfe_count();
+  EndTime       = time_us_64() + (Seconds * 1000000ull);
+  while (time_us_64() < EndTime)
+  {
+    sched_poll();
+    sched_wait();
+  }
+  printf("main loop idle %u sec: sleep_ms(200) %u wake-ups   timer wheel + WFE %u wake-ups (%u task runs, log drain every %u msec, simulated)\n", Seconds, Seconds * 5, host_wfe_count() - StartWakeups, BenchTaskRuns, BENCH_LOG_DRAIN_MS);
+  if ((host_wfe_count() - StartWakeups) >= (Seconds * 5)) bench_fail("idle main loop wakes up as often as the sleep_ms(200) loop\n");
+
+  /* Event latency, with real sleeps. */
+  host_time_set_real_sleep(FLAG_ON);
+  MaxLatency   = 0;
+  TotalLatency = 0;
+  for (Loop1UInt8 = 0; Loop1UInt8 < 10; ++Loop1UInt8)
+  {
+    BenchEventLatency = 0;
+    pthread_create(&Thread, NULL, bench_event_thread, NULL);
+    while (BenchEventLatency == 0)
+    {
+      sched_poll();
+      if (BenchEventLatency == 0) sched_wait();
+    }
+    pthread_join(Thread, NULL);
+    TotalLatency += BenchEventLatency;
+    if (BenchEventLatency > MaxLatency) MaxLatency = BenchEventLatency;
+  }
+  host_time_set_real_sleep(FLAG_OFF);
+  printf("event to task latency: average %llu usec   max %llu usec (previous loop: up to 200000 usec)\n", TotalLatency / 10, MaxLatency);
+  if (MaxLatency >= 200000) bench_fail("event to task latency of %llu usec, no better than the previous loop\n", MaxLatency);
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=Main program entry point. */
+/* ============================================================================================================================================================= *\
+                                                                      Main program entry point.
+\* ============================================================================================================================================================= */
+int main(int argc, char *argv[])
+{
+  UINT32 Iterations;
+
+
+  Iterations = DEFAULT_ITERATIONS;
+  if (argc > 1) Iterations = strtoul(argv[1], NULL, 10);
+  if (Iterations == 0) Iterations = 1;
+
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  mqtt_ctx_init(&StructMQTT, BenchTopicBuffer, sizeof(BenchTopicBuffer), BenchPayloadBuffer, sizeof(BenchPayloadBuffer), BenchArena, sizeof(BenchArena), MAX_MQTT_ENGINE_SLOTS);
+  printf("MQTT client instance: %zu bytes, arena: %zu bytes (%u engine slots)\n", sizeof(mqtt_ctx_t), sizeof(BenchArena), MAX_MQTT_ENGINE_SLOTS);
+  bench_connect();
+  if (mqtt_client_is_connected(StructMQTT.MqttClientInstance) == 0)
+  {
+    printf("Unable to connect to the simulated broker.\n");
+    return 1;
+  }
+
+  printf("========================================================================================================================\n");
+  printf("Pico-MQTT-Module host benchmark (%u iterations)\n", Iterations);
+  printf("========================================================================================================================\n");
+  bench_wipe_packet(Iterations);
+  bench_parse(Iterations);
+  bench_incoming_publish(Iterations);
+  bench_incoming_fragmented(Iterations / 10 + 1);
+  bench_router(Iterations);
+  bench_engine(Iterations / 10 + 1);
+  bench_snapshot(Iterations);
+  bench_instances(Iterations);
+  bench_clock(Iterations);
+  bench_log_printf(Iterations / 10 + 1);
+  bench_log_stack();
+  bench_log_async(Iterations / 10 + 1);
+  bench_log_wakeup(Iterations / 10 + 1);
+  bench_log_binary(Iterations / 10 + 1);
+  bench_publish(Iterations);
+  bench_latency();
+  bench_subscribe(2);
+  bench_subscribe(8);
+  bench_subscribe(20);
+  bench_reconnect(5, FLAG_ON);
+  bench_reconnect(300, FLAG_ON);
+  bench_reconnect_fleet(20, 30);
+  bench_session(FLAG_OFF);
+  bench_session(FLAG_ON);
+  bench_boot();
+  bench_breakdown(Iterations);
+  bench_availability(10);
+  bench_scheduler(600);
+  printf("========================================================================================================================\n");
+  if (BenchFailures) printf("*** %u failed checks\n", BenchFailures);
+
+  return (BenchFailures ? 1 : 0);
+}
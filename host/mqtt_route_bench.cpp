@@ -0,0 +1,216 @@
+/* ============================================================================================================================================================= *\
+   mqtt_route_bench.cpp
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   Revision 16-OCT-2026
+   Langage: C++17
+
+   Linux host benchmark for the compile-time routing table of Pico-MQTT-Router.hpp. The same set of commands is dispatched with:
+   - a linear chain of strcmp() on the whole topic (the way devices used to do it),
+   - the topic router of Pico-MQTT-Module (mqtt_register_handler() / mqtt_dispatch()),
+   - the perfect-hash table keyed on the whole topic,
+   - the perfect-hash table keyed on the command level of the topic.
+
+   Usage: mqtt_route_bench [iterations]   (exits with 1 when a method did not call one handler for each topic)
+\* ============================================================================================================================================================= */
+
+
+
+/* $PAGE */
+/* $TITLE=Definitions and macros. */
+/* ============================================================================================================================================================= *\
+                                                                       Definitions and macros.
+\* ============================================================================================================================================================= */
+#define DEFAULT_ITERATIONS  1000000  // default number of iterations for each benchmark.
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                          Include files
+\* ============================================================================================================================================================= */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "Pico-Clock-Module.h"
+#include "Pico-MQTT-Router.hpp"
+
+
+
+/* $PAGE */
+/* $TITLE=Global variables declaration / definition. */
+/* ============================================================================================================================================================= *\
+                                                            Global variables declaration / definition.
+\* ============================================================================================================================================================= */
+extern "C"
+{
+UCHAR PicoUniqueId[40]   = "E661-4103-E72C-2423";
+UCHAR PicoIdentifier[40] = "SoundServer1";
+
+struct struct_clock StructClock;
+struct struct_mqtt  StructMQTT;
+
+UCHAR DayName[7][13];
+UCHAR ShortMonth[13][4];
+
+/* Logging is not benchmarked here. */
+void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...) {}
+}
+
+static UCHAR  BenchTopicBuffer[MAX_TOPIC_LENGTH];
+static UCHAR  BenchPayloadBuffer[MAX_PAYLOAD_LENGTH];
+static UCHAR  BenchArena[MQTT_ARENA_SIZE(MAX_TOPIC_LENGTH, MAX_PAYLOAD_LENGTH, 0)];
+static UINT32 HandlerCalls;
+static UINT32 Failures;  // methods that did not call one handler for each topic (returned by main()).
+
+
+
+/* $PAGE */
+/* $TITLE=Routing tables. */
+/* ============================================================================================================================================================= *\
+                                  Commands of a typical ASTL SoundServer device: <Destination>/<Command>/<Source> topics, declared once.
+\* ============================================================================================================================================================= */
+static void bench_handler(const struct mqtt_view *View, void *Context)
+{
+  ++HandlerCalls;
+
+  return;
+}
+
+#define BENCH_COMMAND_LIST(X) \
+  X(Balance)   X(Bass)       X(Beep)      X(Chime)     X(Doorbell)  X(Fade)      X(Loudness)  X(Mute)      X(Next)      X(Pause) \
+  X(Play)      X(Playlist)   X(Previous)  X(Random)    X(Record)    X(Repeat)    X(Reset)     X(Resume)    X(Scan)      X(Seek) \
+  X(Shuffle)   X(Sleep)      X(Source)    X(Standby)   X(Status)    X(Stop)      X(Timer)     X(TimeSet)   X(Track)     X(Treble) \
+  X(Tune)      X(Unmute)     X(Version)   X(Volume)    X(VolumeUp)  X(VolumeDn)  X(Wake)      X(Zone)      X(ZoneAll)   X(ZoneOff)
+
+#define BENCH_TOPIC(Command)  "SoundServer1/" #Command "/Control",
+#define BENCH_LEVEL(Command)  #Command,
+
+static const char *const BenchTopic[] = { BENCH_COMMAND_LIST(BENCH_TOPIC) };
+static const char *const BenchLevel[] = { BENCH_COMMAND_LIST(BENCH_LEVEL) };
+
+#define BENCH_COMMANDS  (sizeof(BenchTopic) / sizeof(BenchTopic[0]))
+
+/* Perfect-hash tables, built at compile time and placed in .rodata (flash on the Pico). */
+#define BENCH_TOPIC_ROUTE(Command)  {"SoundServer1/" #Command "/Control", bench_handler},
+#define BENCH_LEVEL_ROUTE(Command)  {#Command, bench_handler},
+
+constexpr pico_mqtt::Route TopicRoute[] = { BENCH_COMMAND_LIST(BENCH_TOPIC_ROUTE) };
+constexpr pico_mqtt::Route LevelRoute[] = { BENCH_COMMAND_LIST(BENCH_LEVEL_ROUTE) };
+
+constexpr auto TopicTable = pico_mqtt::make_route_table(TopicRoute);
+constexpr auto LevelTable = pico_mqtt::make_route_table<1>(LevelRoute);
+
+
+
+/* $PAGE */
+/* $TITLE=bench_now_ns() */
+/* ============================================================================================================================================================= *\
+                                                               Return the current monotonic time in nsec.
+\* ============================================================================================================================================================= */
+static UINT64 bench_now_ns(void)
+{
+  struct timespec Now;
+
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+
+  return ((UINT64)Now.tv_sec * 1000000000ull) + (UINT64)Now.tv_nsec;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=bench_run() */
+/* ============================================================================================================================================================= *\
+                              Dispatch <Iterations> incoming topics with one method and print the result (the packet reset is included).
+\* ============================================================================================================================================================= */
+template <typename Dispatch>
+static void bench_run(const char *Name, UINT32 Iterations, Dispatch Method)
+{
+  UINT32 Loop1UInt32;
+
+  UINT64 ElapsedNs;
+  UINT64 StartTime;
+
+
+  HandlerCalls = 0;
+  StartTime    = bench_now_ns();
+  for (Loop1UInt32 = 0; Loop1UInt32 < Iterations; ++Loop1UInt32)
+  {
+    mqtt_wipe_packet(&StructMQTT);
+    strcpy((char *)StructMQTT.Topic, BenchTopic[Loop1UInt32 % BENCH_COMMANDS]);
+    Method();
+  }
+  ElapsedNs = bench_now_ns() - StartTime;
+
+  printf("%-48s %10u iterations   %10.1f ns/op   %12.0f op/sec\n", Name, Iterations, (double)ElapsedNs / Iterations, (Iterations * 1e9) / (double)ElapsedNs);
+  if (HandlerCalls != Iterations)
+  {
+    printf("*** %u handler calls instead of %u\n", HandlerCalls, Iterations);
+    ++Failures;
+  }
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=Main program entry point. */
+/* ============================================================================================================================================================= *\
+                                                                      Main program entry point.
+\* ============================================================================================================================================================= */
+int main(int argc, char *argv[])
+{
+  UCHAR Filter[32];
+
+  UINT8 Loop1UInt8;
+
+  UINT32 Iterations;
+
+
+  Iterations = DEFAULT_ITERATIONS;
+  if (argc > 1) Iterations = strtoul(argv[1], NULL, 10);
+  if (Iterations == 0) Iterations = 1;
+
+  mqtt_ctx_init(&StructMQTT, BenchTopicBuffer, sizeof(BenchTopicBuffer), BenchPayloadBuffer, sizeof(BenchPayloadBuffer), BenchArena, sizeof(BenchArena), 0);
+
+  for (Loop1UInt8 = 0; Loop1UInt8 < BENCH_COMMANDS; ++Loop1UInt8)
+  {
+    snprintf((char *)Filter, sizeof(Filter), "+/%s/#", BenchLevel[Loop1UInt8]);
+    mqtt_register_handler(&StructMQTT, Filter, bench_handler, NULL);
+  }
+
+  printf("========================================================================================================================\n");
+  printf("Topic dispatch benchmark: %zu commands (%u iterations)\n", BENCH_COMMANDS, Iterations);
+  printf("perfect-hash table sizes: whole topic %zu bytes, command level %zu bytes (read-only data)\n", sizeof(TopicTable), sizeof(LevelTable));
+  printf("========================================================================================================================\n");
+
+  bench_run("strcmp() chain on whole topic", Iterations, []
+  {
+    for (UINT8 Loop1UInt8 = 0; Loop1UInt8 < BENCH_COMMANDS; ++Loop1UInt8)
+    {
+      if (strcmp((const char *)StructMQTT.Topic, BenchTopic[Loop1UInt8]) == 0)
+      {
+        bench_handler(mqtt_get_view(&StructMQTT), NULL);
+        break;
+      }
+    }
+  });
+
+  bench_run("topic router (mqtt_dispatch())", Iterations, [] { mqtt_dispatch(&StructMQTT); });
+  bench_run("perfect hash, whole topic", Iterations, [] { TopicTable.dispatch(&StructMQTT, StructMQTT.Topic); });
+  bench_run("perfect hash, command level", Iterations, [] { LevelTable.dispatch(&StructMQTT); });
+
+  printf("========================================================================================================================\n");
+
+  return (Failures ? 1 : 0);
+}
@@ -0,0 +1,7 @@
+/* Host replacement for <pico/critical_section.h> (see Pico-Host-Platform.h). */
+#ifndef __HOST_PICO_CRITICAL_SECTION_H
+#define __HOST_PICO_CRITICAL_SECTION_H
+
+#include "Pico-Host-Platform.h"
+
+#endif  // __HOST_PICO_CRITICAL_SECTION_H
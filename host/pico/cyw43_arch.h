@@ -0,0 +1,7 @@
+/* Host replacement for <pico/cyw43_arch.h> (see Pico-Host-Platform.h). */
+#ifndef __HOST_PICO_CYW43_ARCH_H
+#define __HOST_PICO_CYW43_ARCH_H
+
+#include "Pico-Host-Platform.h"
+
+#endif  // __HOST_PICO_CYW43_ARCH_H
@@ -0,0 +1,7 @@
+/* Host replacement for <pico/multicore.h> (see Pico-Host-Platform.h). */
+#ifndef __HOST_PICO_MULTICORE_H
+#define __HOST_PICO_MULTICORE_H
+
+#include "Pico-Host-Platform.h"
+
+#endif  // __HOST_PICO_MULTICORE_H
@@ -0,0 +1,7 @@
+/* Host replacement for <pico/stdlib.h> (see Pico-Host-Platform.h). */
+#ifndef __HOST_PICO_STDLIB_H
+#define __HOST_PICO_STDLIB_H
+
+#include "Pico-Host-Platform.h"
+
+#endif  // __HOST_PICO_STDLIB_H
@@ -0,0 +1,282 @@
+/* ============================================================================================================================================================= *\
+   pico_id_registry.c
+   St-Louys Andre - October 2026
+   astlouys@gmail.com
+   Revision 16-OCT-2026
+   Langage: C
+
+   Linux builder of the device identifier registry searched by get_pico_identifier() (see get_pico_identifier.c).
+
+   Usage: pico_id_registry <text file> <binary file> [flash size in bytes]
+
+   Each line of the text file gives a Pico Unique ID and its device name, ex:
+     E661-4103-E72C-2423   Control
+   Empty lines and lines beginning with <#> are ignored. The entries are sorted by board ID and written to the binary file, which is then written
+   to the last sectors of the flash memory with picotool (the command line is displayed, for a 2 MB flash memory by default):
+     picotool load registry.bin -t bin -o 0x101FC000
+   NOTE: PICO_IDENTIFIER_FLASH_SECTORS must be the same here and in the Firmware.
+\* ============================================================================================================================================================= */
+
+
+
+/* $PAGE */
+/* $TITLE=Include files. */
+/* ============================================================================================================================================================= *\
+                                                                          Include files
+\* ============================================================================================================================================================= */
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "baseline.h"
+
+
+
+/* $PAGE */
+/* $TITLE=Definitions and macros. */
+/* ============================================================================================================================================================= *\
+                                                                       Definitions and macros.
+\* ============================================================================================================================================================= */
+#define PICO_IDENTIFIER_MAGIC          0x44494350  // must be the same as in get_pico_identifier.c.
+#define PICO_IDENTIFIER_SIZE                   24  // must be the same as in get_pico_identifier.c.
+#define PICO_IDENTIFIER_FLASH_SECTORS           4  // must be the same as in get_pico_identifier.c.
+#define PICO_IDENTIFIER_HEADER                 16  // size of the registry header.
+#define PICO_IDENTIFIER_ENTRY    (8 + PICO_IDENTIFIER_SIZE)  // size of a registry entry (board ID + device name).
+#define FLASH_SECTOR_SIZE                    4096  // flash sector size of the Pico.
+#define FLASH_SIZE_DEFAULT    (2 * 1024 * 1024)    // flash size of the Pico and Pico W (4 MB on the Pico 2 and Pico 2 W).
+#define XIP_BASE                       0x10000000  // address of the flash memory in the Pico address space.
+#define MAX_ENTRIES   (((PICO_IDENTIFIER_FLASH_SECTORS * FLASH_SECTOR_SIZE) - PICO_IDENTIFIER_HEADER) / PICO_IDENTIFIER_ENTRY)
+
+
+struct registry_entry
+{
+  UINT64 BoardId;
+  UCHAR  Name[PICO_IDENTIFIER_SIZE];
+  UINT32 LineNumber;
+};
+
+
+
+/* $PAGE */
+/* $TITLE=Global variables declaration / definition. */
+/* ============================================================================================================================================================= *\
+                                                            Global variables declaration / definition.
+\* ============================================================================================================================================================= */
+static struct registry_entry Entry[MAX_ENTRIES];
+static UINT32                EntryCount;
+
+
+
+/* $PAGE */
+/* $TITLE=Function prototypes. */
+/* ============================================================================================================================================================= *\
+                                                                     Function prototypes.
+\* ============================================================================================================================================================= */
+/* Sort order of the registry entries (board ID). */
+static int registry_compare(const void *First, const void *Second);
+
+/* Read the text file. Return 0 if all lines are valid. */
+static int registry_read(const char *FileName);
+
+/* Write a value of <Size> bytes, least significant byte first (the Pico is little endian). */
+static void registry_write_value(UCHAR *Buffer, UINT64 Value, UINT8 Size);
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=registry_compare() */
+/* ============================================================================================================================================================= *\
+                                                                  Sort order of the registry entries (board ID).
+\* ============================================================================================================================================================= */
+static int registry_compare(const void *First, const void *Second)
+{
+  const struct registry_entry *Entry1 = First;
+  const struct registry_entry *Entry2 = Second;
+
+
+  if (Entry1->BoardId < Entry2->BoardId) return -1;
+  if (Entry1->BoardId > Entry2->BoardId) return 1;
+
+  return 0;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=registry_read() */
+/* ============================================================================================================================================================= *\
+                                       Read the text file: one "Unique ID   device name" per line (the dashes of the Unique ID are optional).
+                                                                      Return 0 if all lines are valid.
+\* ============================================================================================================================================================= */
+static int registry_read(const char *FileName)
+{
+  UCHAR Line[256];
+  UCHAR *Scan;
+
+  UINT8 Digits;
+
+  UINT32 Errors;
+  UINT32 LineNumber;
+  UINT32 NameLength;
+
+  UINT64 BoardId;
+
+  FILE *File;
+
+
+  File = fopen(FileName, "r");
+  if (File == NULL)
+  {
+    fprintf(stderr, "Unable to open text file <%s>.\n", FileName);
+    return -1;
+  }
+
+  Errors     = 0;
+  LineNumber = 0;
+  while (fgets(Line, sizeof(Line), File) != NULL)
+  {
+    ++LineNumber;
+    Scan = Line;
+    while (isspace(*Scan)) ++Scan;
+    if ((*Scan == '\0') || (*Scan == '#')) continue;
+
+    /* Unique ID: 16 hex digits. */
+    BoardId = 0ll;
+    Digits  = 0;
+    while (isxdigit(*Scan) || (*Scan == '-'))
+    {
+      if (*Scan != '-')
+      {
+        BoardId = (BoardId << 4) | (isdigit(*Scan) ? (*Scan - '0') : (toupper(*Scan) - 'A' + 10));
+        ++Digits;
+      }
+      ++Scan;
+    }
+
+    /* Device name: first word after the Unique ID. */
+    while (isspace(*Scan)) ++Scan;
+    for (NameLength = 0; (Scan[NameLength] != '\0') && (isspace(Scan[NameLength]) == 0); ++NameLength);
+
+    if ((Digits != 16) || (NameLength == 0) || (NameLength >= PICO_IDENTIFIER_SIZE))
+    {
+      fprintf(stderr, "%s:%u: invalid line (expecting a 16-digit Unique ID and a device name of 1 to %u characters).\n", FileName, LineNumber, PICO_IDENTIFIER_SIZE - 1);
+      ++Errors;
+      continue;
+    }
+
+    if (EntryCount >= MAX_ENTRIES)
+    {
+      fprintf(stderr, "%s:%u: too many devices (the registry holds %u devices).\n", FileName, LineNumber, MAX_ENTRIES);
+      ++Errors;
+      break;
+    }
+
+    Entry[EntryCount].BoardId    = BoardId;
+    Entry[EntryCount].LineNumber = LineNumber;
+    memcpy(Entry[EntryCount].Name, Scan, NameLength);
+    Entry[EntryCount].Name[NameLength] = '\0';
+    ++EntryCount;
+  }
+  fclose(File);
+
+  return (Errors ? -1 : 0);
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=registry_write_value() */
+/* ============================================================================================================================================================= *\
+                                             Write a value of <Size> bytes, least significant byte first (the Pico is little endian).
+\* ============================================================================================================================================================= */
+static void registry_write_value(UCHAR *Buffer, UINT64 Value, UINT8 Size)
+{
+  UINT8 Loop1UInt8;
+
+
+  for (Loop1UInt8 = 0; Loop1UInt8 < Size; ++Loop1UInt8)
+    Buffer[Loop1UInt8] = (UCHAR)(Value >> (Loop1UInt8 * 8));
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=Main program entry point. */
+/* ============================================================================================================================================================= *\
+                                                                      Main program entry point.
+\* ============================================================================================================================================================= */
+int main(int argc, char *argv[])
+{
+  static UCHAR Image[PICO_IDENTIFIER_FLASH_SECTORS * FLASH_SECTOR_SIZE];
+
+  UINT32 FlashSize;
+  UINT32 ImageSize;
+  UINT32 Loop1UInt32;
+
+  FILE *File;
+
+
+  if (argc < 3)
+  {
+    fprintf(stderr, "Usage: %s <text file> <binary file> [flash size in bytes]\n", argv[0]);
+    return 1;
+  }
+
+  FlashSize = FLASH_SIZE_DEFAULT;
+  if (argc > 3) FlashSize = strtoul(argv[3], NULL, 0);
+
+  if (registry_read(argv[1])) return 1;
+
+  /* Sorted by board ID for the binary search of get_pico_identifier(), without duplicates. */
+  qsort(Entry, EntryCount, sizeof(Entry[0]), registry_compare);
+  for (Loop1UInt32 = 1; Loop1UInt32 < EntryCount; ++Loop1UInt32)
+  {
+    if (Entry[Loop1UInt32].BoardId == Entry[Loop1UInt32 - 1].BoardId)
+    {
+      fprintf(stderr, "%s:%u: Unique ID %16.16llX already given to <%s> (line %u).\n", argv[1], Entry[Loop1UInt32].LineNumber, Entry[Loop1UInt32].BoardId,
+              Entry[Loop1UInt32 - 1].Name, Entry[Loop1UInt32 - 1].LineNumber);
+      return 1;
+    }
+  }
+
+  /* Header, then the entries (the rest of the last sector stays erased). */
+  memset(Image, 0xFF, sizeof(Image));
+  memset(Image, 0x00, PICO_IDENTIFIER_HEADER);
+  registry_write_value(&Image[0], PICO_IDENTIFIER_MAGIC, 4);
+  registry_write_value(&Image[4], 1, 2);
+  registry_write_value(&Image[6], EntryCount, 2);
+  registry_write_value(&Image[8], PICO_IDENTIFIER_ENTRY, 4);
+  for (Loop1UInt32 = 0; Loop1UInt32 < EntryCount; ++Loop1UInt32)
+  {
+    registry_write_value(&Image[PICO_IDENTIFIER_HEADER + (Loop1UInt32 * PICO_IDENTIFIER_ENTRY)], Entry[Loop1UInt32].BoardId, 8);
+    memset(&Image[PICO_IDENTIFIER_HEADER + (Loop1UInt32 * PICO_IDENTIFIER_ENTRY) + 8], 0x00, PICO_IDENTIFIER_SIZE);
+    strcpy(&Image[PICO_IDENTIFIER_HEADER + (Loop1UInt32 * PICO_IDENTIFIER_ENTRY) + 8], Entry[Loop1UInt32].Name);
+  }
+  ImageSize = PICO_IDENTIFIER_HEADER + (EntryCount * PICO_IDENTIFIER_ENTRY);
+  ImageSize = ((ImageSize + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE;
+
+  File = fopen(argv[2], "wb");
+  if ((File == NULL) || (fwrite(Image, 1, ImageSize, File) != ImageSize))
+  {
+    fprintf(stderr, "Unable to write binary file <%s>.\n", argv[2]);
+    return 1;
+  }
+  fclose(File);
+
+  printf("%u devices (maximum %u) written to <%s> (%u bytes).\n", EntryCount, MAX_ENTRIES, argv[2], ImageSize);
+  printf("picotool load %s -t bin -o 0x%8.8X\n", argv[2], XIP_BASE + FlashSize - (PICO_IDENTIFIER_FLASH_SECTORS * FLASH_SECTOR_SIZE));
+
+  return 0;
+}
@@ -1,6 +1,306 @@
+/* $PAGE */
+/* $TITLE=Log ring buffers. */
+/* Updated 16-OCT-2026 */
+/* ============================================================================================================================================================= *\
+                                           Log ring buffers used when log_printf() is in asynchronous mode (see log_set_mode()).
+   In LOG_MODE_ASYNC, log_printf() only builds one complete log line and copies it into the ring buffer of the core it runs on. The ring buffers are
+   written to stdio by log_drain(), in large chunks, from the main loop. Only the core owning a ring buffer writes into it (interrupts of this core
+   are masked for the time of the copy), and only log_drain() reads from it: no lock is shared between the two cores, and lines coming from the
+   two cores are never mixed together.
+   A line is dropped (and counted) when the ring buffer of its core is full: log_printf() never waits for the terminal.
+
+   NOTE: log_drain() must always be called from the same place (for example a main loop task), never from two cores at the same time.
+\* ============================================================================================================================================================= */
+#define LOG_BINARY_SYNC    0xA0  // high nibble of the first byte of a binary log record (low nibble is the core number).
+#define LOG_BINARY_HEADER    16  // size of the header of a binary log record.
+#define LOG_BINARY_ARGS     240  // maximum size of the arguments of a binary log record.
+
+#ifndef LOG_LINE_SIZE
+#define LOG_LINE_SIZE   320  // size of the log line buffer of log_printf(), on the stack of the caller (longer lines are truncated).
+#endif  // LOG_LINE_SIZE
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE  4096  // size of the log ring buffer of each core (must be a power of 2).
+#endif  // LOG_RING_SIZE
+
+struct log_ring
+{
+  volatile UINT32 Head;             // bytes written since power up (only modified by the core owning the ring buffer).
+  volatile UINT32 Tail;             // bytes sent to stdio since power up (only modified by log_drain()).
+  volatile UINT32 Dropped;          // lines dropped because the ring buffer was full.
+  UINT32          DroppedReported;  // dropped lines already reported by log_drain().
+  UCHAR           Buffer[LOG_RING_SIZE];
+};
+
+static struct log_ring LogRing[2];                  // one ring buffer for each core.
+static volatile UINT8  LogMode = LOG_MODE_DIRECT;   // LOG_MODE_DIRECT, or LOG_MODE_ASYNC and / or LOG_MODE_BINARY.
+static volatile UINT8  LogDirect[2];                // for each core: text lines of this core are sent right away to stdio (see log_set_direct()).
+static void          (*LogWakeup)(void);            // optional function called when a ring buffer gets half full (see log_set_wakeup()).
+
+/* Send a string to log file (its address is the reference of the addresses sent in binary records). */
+void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...);
+
+/* Encode a log call as a binary record (LOG_MODE_BINARY). */
+static void log_binary(UINT LineNumber, const UCHAR *FunctionName, const UCHAR *Format, va_list argp);
+
+/* Send one complete log line to stdio or to the ring buffer of the calling core. */
+static void log_write(const UCHAR *Line, UINT Length);
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=log_binary() */
+/* ============================================================================================================================================================= *\
+                   Encode a log call as a binary record, without formatting it (LOG_MODE_BINARY). The record is decoded on a Linux computer by
+                   host/log_decode.c, which finds the format string and the function name in the ELF file of the Firmware. Record layout:
+                   Byte  0      LOG_BINARY_SYNC + core number.
+                   Byte  1      Size of the arguments following the header.
+                   Bytes 2-3    Source code line number.
+                   Bytes 4-7    Address of the format string, relative to the address of log_printf() (signed).
+                   Bytes 8-11   Address of the function name, relative to the address of log_printf() (signed).
+                   Bytes 12-15  time_us_64() (lower 32 bits).
+                   Arguments, in the order of the format string, in their native size and byte order (a string is sent as one byte for its
+                   length followed by its characters). Arguments that do not fit in LOG_BINARY_ARGS bytes are left out.
+\* ============================================================================================================================================================= */
+static void log_binary(UINT LineNumber, const UCHAR *FunctionName, const UCHAR *Format, va_list argp)
+{
+  UCHAR Record[LOG_BINARY_HEADER + LOG_BINARY_ARGS];
+
+  const UCHAR *Scan;
+  const UCHAR *String;
+
+  UINT8 FlagStop;
+  UINT8 LongCount;
+
+  UINT Length;
+  UINT Size;
+
+  INT32 Offset;
+
+  UINT32 Timestamp;
+
+  unsigned long Long;
+  UINT   Int;
+  UINT64 LongLong;
+  DOUBLE Double;
+  void  *Pointer;
+
+
+  FlagStop = FLAG_OFF;
+  Length   = LOG_BINARY_HEADER;
+  for (Scan = Format; (*Scan) && (FlagStop == FLAG_OFF); ++Scan)
+  {
+    if (*Scan != '%') continue;
+    ++Scan;
+    if (*Scan == '\0') break;
+    if (*Scan == '%') continue;
+
+    /* Flags, width and precision (a '*' takes an int argument). */
+    for (; (*Scan) && (strchr("-+ #0123456789.*", *Scan)); ++Scan)
+    {
+      if (*Scan != '*') continue;
+      Int = va_arg(argp, INT);
+      if ((Length + sizeof(Int)) > sizeof(Record)) FlagStop = FLAG_ON;
+      if (FlagStop) break;
+      memcpy(&Record[Length], &Int, sizeof(Int));
+      Length += sizeof(Int);
+    }
+
+    /* Length modifiers. */
+    LongCount = 0;
+    for (; (*Scan) && (strchr("hlzj", *Scan)); ++Scan)
+    {
+      if ((*Scan == 'l') || (*Scan == 'z')) ++LongCount;
+      if (*Scan == 'j') LongCount = 2;
+    }
+    if ((*Scan == '\0') || (FlagStop)) break;
+
+    /* Conversion. */
+    Size = 0;
+    switch (*Scan)
+    {
+      case ('d'):
+      case ('i'):
+      case ('o'):
+      case ('u'):
+      case ('x'):
+      case ('X'):
+      case ('c'):
+        if (LongCount >= 2)
+        {
+          LongLong = va_arg(argp, UINT64);
+          Pointer  = &LongLong;
+          Size     = sizeof(LongLong);
+        }
+        else if (LongCount == 1)
+        {
+          Long    = va_arg(argp, unsigned long);
+          Pointer = &Long;
+          Size    = sizeof(Long);
+        }
+        else
+        {
+          Int     = va_arg(argp, UINT);
+          Pointer = &Int;
+          Size    = sizeof(Int);
+        }
+      break;
+
+      case ('p'):
+        Pointer = va_arg(argp, void *);
+        Long    = (unsigned long)Pointer;
+        Pointer = &Long;
+        Size    = sizeof(void *);
+      break;
+
+      case ('a'):
+      case ('A'):
+      case ('e'):
+      case ('E'):
+      case ('f'):
+      case ('F'):
+      case ('g'):
+      case ('G'):
+        Double  = va_arg(argp, DOUBLE);
+        Pointer = &Double;
+        Size    = sizeof(Double);
+      break;
+
+      case ('s'):
+        String = va_arg(argp, const UCHAR *);
+        if (String == NULL) String = "(null)";
+        if (Length >= (sizeof(Record) - 1))
+        {
+          FlagStop = FLAG_ON;
+          break;
+        }
+        Int = strnlen(String, sizeof(Record) - Length - 1);
+        Record[Length++] = Int;
+        memcpy(&Record[Length], String, Int);
+        Length += Int;
+      break;
+
+      default:
+        /* Unknown conversion: the decoder displays the rest of the format string as is. */
+        FlagStop = FLAG_ON;
+      break;
+    }
+
+    if (Size > (sizeof(Record) - Length)) FlagStop = FLAG_ON;
+    if ((FlagStop == FLAG_OFF) && (Size))
+    {
+      memcpy(&Record[Length], Pointer, Size);
+      Length += Size;
+    }
+  }
+
+  /* Header. */
+  Record[0] = LOG_BINARY_SYNC | (get_core_num() & 0x0F);
+  Record[1] = Length - LOG_BINARY_HEADER;
+  Record[2] = LineNumber & 0xFF;
+  Record[3] = (LineNumber >> 8) & 0xFF;
+  Offset = (INT32)((intptr_t)Format - (intptr_t)log_printf);
+  memcpy(&Record[4], &Offset, sizeof(Offset));
+  Offset = (INT32)((intptr_t)FunctionName - (intptr_t)log_printf);
+  memcpy(&Record[8], &Offset, sizeof(Offset));
+  Timestamp = (UINT32)time_us_64();
+  memcpy(&Record[12], &Timestamp, sizeof(Timestamp));
+
+  log_write(Record, Length);
+
+  return;
+}
+
+
+
+
+
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=log_drain() */
+/* ============================================================================================================================================================= *\
+                    Send the lines waiting in the log ring buffers to stdio, in as few write calls as possible, and report the lines that have been
+                               dropped because a ring buffer was full. Return the number of bytes sent. May be called in any log mode.
+\* ============================================================================================================================================================= */
+UINT32 log_drain(void)
+{
+  UINT8 Loop1UInt8;
+
+  UINT32 Chunk;
+  UINT32 Dropped;
+  UINT32 Head;
+  UINT32 Offset;
+  UINT32 Tail;
+  UINT32 Total;
+
+  struct log_ring *Ring;
+
+
+  Total = 0;
+  for (Loop1UInt8 = 0; Loop1UInt8 < 2; ++Loop1UInt8)
+  {
+    Ring = &LogRing[Loop1UInt8];
+    Head = Ring->Head;
+    __dmb();  // read the lines only after having read their Head.
+    Tail = Ring->Tail;
+
+    /* At most two chunks: up to the end of the buffer, then from its beginning. */
+    while (Tail != Head)
+    {
+      Offset = Tail & (LOG_RING_SIZE - 1);
+      Chunk  = Head - Tail;
+      if (Chunk > (LOG_RING_SIZE - Offset)) Chunk = LOG_RING_SIZE - Offset;
+      fwrite(&Ring->Buffer[Offset], 1, Chunk, stdout);
+      Tail  += Chunk;
+      Total += Chunk;
+    }
+    __dmb();  // lines must have been read before their space is given back.
+    Ring->Tail = Tail;
+
+    Dropped = Ring->Dropped;
+    if (Dropped != Ring->DroppedReported)
+    {
+      printf("[log_drain] %lu log lines dropped on core %u (ring buffer full).\n", Dropped - Ring->DroppedReported, Loop1UInt8);
+      Ring->DroppedReported = Dropped;
+    }
+  }
+  if (Total) fflush(stdout);
+
+  return Total;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=log_get_mode() */
+/* ============================================================================================================================================================= *\
+                                  Return the current output mode of log_printf() (LOG_MODE_DIRECT, or LOG_MODE_ASYNC and / or LOG_MODE_BINARY).
+\* ============================================================================================================================================================= */
+UINT8 log_get_mode(void)
+{
+  return LogMode;
+}
+
+
+
+
+
+
+
+
+
+
 /* $PAGE */
 /* $TITLE=log_printf() */
-/* Updated 25-FEB-2026 */
+/* Updated 16-OCT-2026 */
 /* ============================================================================================================================================================= *\
                                                                        Print a string to log file.
    NOTE: If the leftmost part of the string to log corresponds to "LOG MASK", the data to the right will be decoded as an UINT16 hex number defining
@@ -24,6 +324,11 @@
 
    For example:
    log_printf(__LINE__, __func__, "<120>Firmware compatible with ASTL Smart Home ecosystem.\n");
+
+   The whole log line is built in one pass, in one buffer of LOG_LINE_SIZE bytes on the stack of the caller: the extra parameters first, then the
+   text to log formatted right after them. The line is then sent in one piece by log_write(): right away to stdio (LOG_MODE_DIRECT)
+   or to the log ring buffer of the calling core (LOG_MODE_ASYNC, see log_set_mode()). In LOG_MODE_BINARY, the text is not formatted at all: the
+   format string address and the raw arguments are sent instead (see log_binary()).
 \* ============================================================================================================================================================= */
 void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...)
 {
@@ -33,45 +338,156 @@ void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...)
   UINT8 FlagLocalDebug = FLAG_OFF;  // may be turned ON for debug purposes.
 #endif  // RELEASE_VERSION
 
-  UCHAR Dum1Str[512];
-  UCHAR Dum2Str[512];
+  UCHAR  Line[LOG_LINE_SIZE];  // complete log line: extra parameters, followed by the text to log.
+  UCHAR *Text;                 // text to log, inside Line.
 
   UINT FunctionSize = 25;  // specify space reserved to display function name including the two "[]". A tilde <~> will be append if function name has been truncated.
-  UINT Loop1UInt;
-  UINT Loop2UInt;
+  UINT Header;             // length of the extra parameters at the beginning of Line.
+  UINT Length;
   UINT LineSize;
+  UINT Loop1UInt;
+  UINT Padding;
+
+  INT TextLength;
 
   static UINT16 LogMask = 0x13;  // bitmask of parameters to display along with text to log (Line number and Function name turned On by default):
                                  // 0x0001 = LOG_LINE     (Line number).
                                  // 0x0002 = LOG_CORE     (Core number).
-                                 // 0x0004 = LOG_TIME     (Time - when real-time clock is available on target system).
-                                 // 0x0008 = LOG_DATE     (Date - when real-time clock is available on target system).
+                                 // 0x0004 = LOG_TIME     (Time - from the soft clock of Pico-Clock-Module).
+                                 // 0x0008 = LOG_DATE     (Date - from the soft clock of Pico-Clock-Module).
                                  // 0x0010 = LOG_FUNCTION (Function name of caller function).
                                  // 0xFFFF = LOG_ALL      (All available extra log information).
 
-  datetime_t LogTime;  // real-time clock variable.  ///// comment out this line (and other lines related to time stamping) if project does not allow time stamping.
-
   va_list argp;
 
 
   /* If there is no terminal connected, bypass the display. */
   if (!stdio_usb_connected()) return;
 
-  /* Transfer the text to print to working variables Dum1Str and Dum2Str. */
+  /* In binary mode, nothing is formatted: the record is decoded on the host (<LOG MASK> is still processed below). */
+  if ((LogMode & LOG_MODE_BINARY) && (LogDirect[get_core_num() & 0x01] == FLAG_OFF) && (strncmp(Format, "LOG MASK", 8)) && (strncmp(Format, "log mask", 8)))
+  {
+    va_start(argp, Format);
+    log_binary(LineNumber, FunctionName, Format, argp);
+    va_end(argp);
+    return;
+  }
+
+
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                      Extra parameters: Optionally display source code line number and caller Pico's core number.
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  Header = 0;
+  if (LogMask & (LOG_LINE + LOG_CORE))  // souce code line number and / or core number.
+  {
+    Line[Header++] = '[';
+    if (LogMask & LOG_LINE)
+    {
+      Header += sprintf(&Line[Header], "%5u", LineNumber);  // note: if program is longer than 99999 lines of code, [%5u] could be replaced by [%6u] to keep everything properly aligned.
+      if (LogMask & LOG_CORE) Line[Header++] = ' ';  // space separator.
+    }
+    if (LogMask & LOG_CORE) Line[Header++] = '0' + get_core_num();
+    Line[Header++] = ']';
+    Line[Header++] = ' ';
+  }
+
+
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                                     Extra parameters: Optionally display date and time stamp.
+                             NOTE: The soft clock of Pico-Clock-Module must have been set (clock_set_datetime()) for date and time stamp
+                                   to display valid values. It works the same way on the Pico2 and Pico2W, which do not have a real-time clock.
+                                   Date and time strings are only formatted again when the second changes (see clock_get_strings()).
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+// #if 0  // Uncomment this line if your project does not allow date stamping (to prevent error messages for undefined date and time related functions / variables).
+  if (LogMask & (LOG_TIME + LOG_DATE))
+  {
+    Line[Header++] = '[';
+
+    if (LogMask & LOG_DATE)
+    {
+      /* Display date. */
+      clock_get_strings(&Line[Header], NULL);
+      Header += (CLOCK_DATE_SIZE - 1);
+      if (LogMask & LOG_TIME)
+      {
+        /* Separator. */
+        Line[Header++] = ' ';
+        Line[Header++] = ' ';
+      }
+    }
+    if (LogMask & LOG_TIME)
+    {
+      /* Display time. */
+      clock_get_strings(NULL, &Line[Header]);
+      Header += (CLOCK_TIME_SIZE - 1);
+    }
+    Line[Header++] = ']';
+    Line[Header++] = ' ';
+  }
+// #endif  // 0   // Uncomment this line if your project does not allow date and time stamping.
+
+
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                                         Extra parameters: Optionally display function name.
+                        NOTE: Function names will be aligned in the log file no matter what their length is. The space reserved for function
+                              names is defined at the top of the current function. If a function name is too long to fit, it will be truncated and a
+                              tilde <~> will be added at the end of the printed function part. It should be relatively easy to determine the function
+                              name based on the first x characters printed.
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  if (LogMask & LOG_FUNCTION)
+  {
+    Length = strlen(FunctionName);
+    Line[Header++] = '[';
+    if (Length > (FunctionSize - 2))
+    {
+      /* Function name too long for a clean format in the log file: truncate it and add a tilde. */
+      if (FlagLocalDebug) printf("Function name too long: [%s] > %u\n", FunctionName, FunctionSize);
+      memcpy(&Line[Header], FunctionName, FunctionSize - 3);
+      Header += FunctionSize - 3;
+      Line[Header++] = '~';
+      Line[Header++] = ']';
+    }
+    else
+    {
+      /* Pad function name with blanks when it is shorter than maximum length. */
+      memcpy(&Line[Header], FunctionName, Length);
+      Header += Length;
+      Line[Header++] = ']';
+      memset(&Line[Header], ' ', FunctionSize - 2 - Length);
+      Header += FunctionSize - 2 - Length;
+    }
+
+    /* Separator. */
+    Line[Header++] = '-';
+    Line[Header++] = ' ';
+  }
+
+
+  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
+                                        Text to log: formatted right after the extra parameters, in the same buffer.
+  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
+  Text = &Line[Header];
   va_start(argp, Format);
-  vsnprintf(Dum1Str, sizeof(Dum1Str), Format, argp);
+  TextLength = vsnprintf(Text, sizeof(Line) - Header, Format, argp);
   va_end(argp);
-  strcpy(Dum2Str, Dum1Str);
-  if (FlagLocalDebug) printf("[%5u] - Log string on entry: <%s> <%s>\n", __LINE__, Dum1Str, Dum2Str);
+  if (TextLength < 0) return;
+  if (FlagLocalDebug) printf("[%5u] - Log string on entry: <%s>\n", __LINE__, Text);
+
+  /* If the line is too long, it is truncated but keeps its ending "new line" character. */
+  if (TextLength >= (INT)(sizeof(Line) - Header))
+  {
+    TextLength = sizeof(Line) - Header - 1;
+    if (Format[strlen(Format) - 1] == '\n') Text[TextLength - 1] = '\n';
+  }
 
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
                                        Handling of <LOG MASK>: special tag to determine extra parameters to print to log file.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  if ((!strncmp(Dum2Str, "LOG MASK", 8)) || (!strncmp(Dum2Str, "log mask", 8)))
+  if ((!strncmp(Text, "LOG MASK", 8)) || (!strncmp(Text, "log mask", 8)))
   {
-    if (FlagLocalDebug) printf("[%5u] - Entering <LOG MASK> string decoding with value string: <%s>\n", __LINE__, &Dum2Str[9]);
-    LogMask = strtol(&Dum2Str[9], NULL, 16);  // decode hex value sent for the <extra> parameters mask to print on each log line.
+    if (FlagLocalDebug) printf("[%5u] - Entering <LOG MASK> string decoding with value string: <%s>\n", __LINE__, &Text[9]);
+    LogMask = strtol(&Text[9], NULL, 16);  // decode hex value sent for the <extra> parameters mask to print on each log line.
     if (FlagLocalDebug) printf("[%5u] - Decoded  <LOG MASK> hex value: 0x%2.2X\n", __LINE__, LogMask);
     return;
   }
@@ -81,14 +497,11 @@ void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...)
                                                               Handling of <HOME> special control code.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
   /* Trap special control code for <HOME>. Replace "home" by appropriate control code for "Home" on a VT101 compatible terminal. */
-  if ((!strcmp(Dum2Str, "home")) || (!strcmp(Dum2Str, "HOME")))
+  if ((!strcmp(Text, "home")) || (!strcmp(Text, "HOME")))
   {
-    if (FlagLocalDebug) printf("[%5u] - Entering <HOME> tag decoding: <%s>\n", __LINE__, Dum2Str);
     /* Escape code for "home". */
-    Dum2Str[0] = 0x1B;
-    Dum2Str[1] = '[';
-    Dum2Str[2] = 'H';
-    Dum2Str[3] = 0x00;
+    log_write("\x1B[H", 3);
+    return;
   }
 
 
@@ -96,167 +509,171 @@ void log_printf(UINT LineNumber, const UCHAR *FunctionName, UCHAR *Format, ...)
                                                                 Handling of <CLS> special control code.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
   /* Trap special control code for <CLS>. Replace "cls" by appropriate control code for "Clear screen" on a VT101 compatible terminal. */
-  if ((!strcmp(Dum2Str, "cls")) || (!strcmp(Dum2Str, "CLS")))
+  if ((!strcmp(Text, "cls")) || (!strcmp(Text, "CLS")))
   {
-    if (FlagLocalDebug) printf("[%5u] - Entering <CLS> tag decoding: <%s>\n", __LINE__, Dum2Str);
     /* Since <cls> does not erase the terminal log, skip a few lines after the previous log session. */
-    for (Loop1UInt = 0; Loop1UInt < 80; ++Loop1UInt) printf("\n");  // leave a blank page between previous log session and new one.
+    memset(Line, '\n', 80);  // leave a blank page between previous log session and new one.
 
     /* Escape code for "cls". */
-    Dum2Str[0] = 0x1B;
-    Dum2Str[1] = '[';
-    Dum2Str[2] = '2';
-    Dum2Str[3] = 'J';
-    Dum2Str[4] = 0x00;
+    memcpy(&Line[80], "\x1B[2J", 4);
+    log_write(Line, 84);
+    return;
   }
 
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
                      If first character is a "new line" character or an escape code, send the raw text only (or the escape code) to log file.
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  if ((Dum2Str[0] == '\n') || (Dum2Str[0] == 0x1B))
+  if ((Text[0] == '\n') || (Text[0] == 0x1B))
   {
-    if (FlagLocalDebug) printf("[%5u] - Sending raw data to log file <%c>.\n", __LINE__, Dum2Str[2]);
-    printf(Dum2Str);
+    log_write(Text, TextLength);
     return;
   }
 
 
   /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                      Extra parameters: Optionally display source code line number and caller Pico's core number.
+                 If the first characters is a number enclosed inside angle-brackets '<xxx>', text to be displayed will be centered on a line of the
+                     specified number of characters (beginning after the current log header). The text is moved once, over the '<xxx>' heading.
+                   If there is no closing angle-bracket or if the line size is not valid, the text is displayed as is (the opening angle-bracket
+                                                                may simply be part of the text to be displayed).
   \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  if (LogMask & (LOG_LINE + LOG_CORE))  // souce code line number and / or core number.
+  if (Text[0] == '<')
   {
-    printf("[");
-    if (LogMask & LOG_LINE)
+    for (Loop1UInt = 1; (Loop1UInt < 6) && (Text[Loop1UInt] != '>'); ++Loop1UInt);
+    if ((Loop1UInt < 6) && (Loop1UInt < TextLength))
     {
-      printf("%5u", LineNumber);  // note: if program is longer than 99999 lines of code, [%5u] could be replaced by [%6u] to keep everything properly aligned.
-      if (LogMask & LOG_CORE) printf(" ");  // space separator.
+      LineSize = atoi(&Text[1]);  // convert LineSize from ASCII number to binary data.
+      Length   = TextLength - (Loop1UInt + 1);
+      Padding  = 0;
+      if ((LineSize > 5) && (LineSize < 200) && ((LineSize + 1) > Length)) Padding = (LineSize - (Length - 1)) / 2;
+      if (FlagLocalDebug) printf("[%5u] - LineSize: %u   text length: %u   spaces: %u\n", __LINE__, LineSize, Length, Padding);
+      if ((Header + Padding + Length) >= sizeof(Line)) Padding = sizeof(Line) - 1 - Header - Length;
+      memmove(&Text[Padding], &Text[Loop1UInt + 1], Length);
+      memset(Text, ' ', Padding);
+      TextLength = Padding + Length;
     }
-    if (LogMask & LOG_CORE) printf("%u", get_core_num());
-    printf("] ");
   }
 
+  log_write(Line, Header + TextLength);
 
-  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                     Extra parameters: Optionally display date and time stamp.
-                             NOTE: Pico's real-time clock must have been initialized for date and time stamp to display valid values.
-                                   You may want to take a look at my repository "Pico-WiFi-Module" and the file Pico-WiFi-Example 
-                                   to see an example on using Pico's internal real-time clock.
-                             NOTE: The Pico2 and Pico2W do not have an internal real-time clock. If you use one of those, you will have to
-                                   implement your own real-time clock using a callback function with the appropriate clock handling functions.
-  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-// #if 0  // Uncomment this line if your project does not allow date stamping (to prevent error messages for undefined date and time related functions / variables).
-  if (LogMask & (LOG_TIME + LOG_DATE))
-  {
-    rtc_get_datetime(&LogTime);  // retrieve current time from Pico's RTC.
-    /***
-    printf("[%5u %u] LogTime retrieve in log_info() - Day: %u   Month: %u   Year: %u     Hour: %u   Minute: %u   Second: %u\n", 
-           __LINE__, get_core_num(),
-           LogTime.day,  LogTime.month, LogTime.year,
-           LogTime.hour, LogTime.min,   LogTime.sec);
-    ***/
-    printf("[");
+  return;
+}
 
-    if (LogMask & LOG_DATE)
-    {
-      /* Display date. */
-      printf("%2.2d-%s-%2.2d", LogTime.day, ShortMonth[LogTime.month], LogTime.year);
-      if (LogMask & LOG_TIME) printf("  ");  // separator.
-    }
-    if (LogMask & LOG_TIME)
-    {
-      /* Display time. */
-      printf("%2.2d:%2.2d:%2.2d", LogTime.hour, LogTime.min, LogTime.sec);
-    }
-    printf("] ");
-  }
-// #endif  // 0   // Uncomment this line if your project does not allow date and time stamping.
 
 
-  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                                                         Extra parameters: Optionally display function name.
-                        NOTE: Function names will be aligned in the log file no matter what their length is. The space reserved for function
-                              names is defined at the top of the current function. If a function name is too long to fit, it will be truncated and a
-                              tilde <~> will be added at the end of the printed function part. It should be relatively easy to determine the function
-                              name based on the first x characters printed.
-  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  if (LogMask & LOG_FUNCTION)
-  {
-    /* Print function name and align all function names in log file (if function name is too long, it will be truncated and a tilde <~> added at the end). */
-    sprintf(Dum2Str, "[%s]", FunctionName);
 
-    /* Check if function name is too long for a clean format in the log file. */
-    if (strlen(Dum2Str) > FunctionSize)
-    {
-      if (FlagLocalDebug) printf("Function name too long: Dum2Str > %u: <%s>\n", FunctionSize, Dum2Str);
-      Dum2Str[FunctionSize - 2] = '~';   // tilde indicating function name has been truncated.
-      Dum2Str[FunctionSize - 1] = ']';   // truncate function name length when it is too long.
-      Dum2Str[FunctionSize]     = '\0';  // add an end-of-string.
 
-      /***
-      if (FlagLocalDebug) 
-      {
-        // Optionally print the ASCII characters representing the function name.
-        printf("Loop %u = ");
-        for (Loop1UInt = 0; Loop1UInt < 20; ++Loop1UInt)
-          printf("%2u   ", Dum2Str[Loop1UInt]);
-      }
-      ***/
-    }
-    printf("%s", Dum2Str);  // display caller's function name.
+/* $PAGE */
+/* $TITLE=log_set_direct() */
+/* ============================================================================================================================================================= *\
+                  Send the log lines of the calling core right away to stdio, as text (FLAG_ON), or back in the current mode (FLAG_OFF), without
+                   changing the mode of the other core (for example: a terminal menu mixing printf() and log_printf() on core 1, while lwIP callbacks
+                                                              keep on logging to their ring buffer on core 0).
+\* ============================================================================================================================================================= */
+void log_set_direct(UINT8 FlagDirect)
+{
+  /* Each core only writes its own flag: no lock needed. */
+  LogDirect[get_core_num() & 0x01] = (FlagDirect ? FLAG_ON : FLAG_OFF);
+
+  return;
+}
 
-    /* Pad function name with blanks when it is shorter than maximum length. */
-    for (Loop1UInt = strlen(Dum2Str); Loop1UInt < FunctionSize; ++Loop1UInt)
-      printf(" ");
 
-    printf("- ");  // separator.
-  }
 
 
-  /* ----------------------------------------------------------------------------------------------------------------------------------------------------------- *\
-                 If the first characters is a number enclosed inside angle-brackets '<xxx>', text to be displayed will be centered on a line of the 
-                                                 specified number of characters (beginning after the current log header).
-  \* ----------------------------------------------------------------------------------------------------------------------------------------------------------- */
-  if (Dum1Str[0] == '<')
+
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=log_set_mode() */
+/* ============================================================================================================================================================= *\
+                      Select how log_printf() sends its lines: LOG_MODE_DIRECT (right away to stdio, default) or LOG_MODE_ASYNC (to the log ring buffer
+                  of the calling core, sent to stdio by log_drain()). Lines still waiting in the ring buffers when going back to LOG_MODE_DIRECT are
+                  sent by the next call to log_drain(). LOG_MODE_BINARY may be added to either mode: log calls are then sent as binary records (see
+                                                                 log_binary()) instead of text lines.
+\* ============================================================================================================================================================= */
+void log_set_mode(UINT8 Mode)
+{
+  LogMode = Mode;
+
+  /* Let the drain send the lines still in the ring buffers. */
+  if (((Mode & LOG_MODE_ASYNC) == 0) && LogWakeup) LogWakeup();
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=log_set_wakeup() */
+/* ============================================================================================================================================================= *\
+                  Register a function called when a log ring buffer gets half full, so that log_drain() may be called before lines get dropped. It may
+                         be called from any core and from interrupt context (for example: a function signaling an event to the main loop).
+\* ============================================================================================================================================================= */
+void log_set_wakeup(void (*Wakeup)(void))
+{
+  LogWakeup = Wakeup;
+
+  return;
+}
+
+
+
+
+
+/* $PAGE */
+/* $TITLE=log_write() */
+/* ============================================================================================================================================================= *\
+                           Send one complete log line to stdio (LOG_MODE_DIRECT) or copy it into the log ring buffer of the calling core (LOG_MODE_ASYNC).
+\* ============================================================================================================================================================= */
+static void log_write(const UCHAR *Line, UINT Length)
+{
+  UINT32 First;
+  UINT32 Head;
+  UINT32 Interrupts;
+  UINT32 Offset;
+  UINT32 Used;
+
+  struct log_ring *Ring;
+
+
+  if (((LogMode & LOG_MODE_ASYNC) == 0) || (LogDirect[get_core_num() & 0x01]))
   {
-    if (FlagLocalDebug) printf("[%5u] - Decoding line size to center text on the line [%s].\n", __LINE__, Dum1Str);
-    LineSize = 0;  // initialize with invalid value.
-    for (Loop1UInt = 0; Loop1UInt < 6; ++Loop1UInt)
-    {
-      if (Dum1Str[Loop1UInt] == '>')
-      {
-        if (FlagLocalDebug) printf("[%5u] - Closing angle-bracket found at position: %u\n", __LINE__, Loop1UInt);
-        /* Closing angle-bracket has been found. */
-        Dum1Str[Loop1UInt] = '\0';     // replace closing angle-bracket with an end-of-string.
-        LineSize = atoi(&Dum1Str[1]);  // convert LineSize from ASCII number to binary data.
-        if (FlagLocalDebug) printf("[%5u] - LineSize decoded is: %u\n", __LINE__, LineSize);
-        break;
-      }
-    }
+    fwrite(Line, 1, Length, stdout);
+    return;
+  }
 
-    if (FlagLocalDebug)
-    {
-      printf("[%5u] - LineSize: %u\n", __LINE__, LineSize);
-      printf("[%5u] - strlen(&Dum1Str[Loop1UInt + 1]): %u\n", __LINE__, (strlen(&Dum1Str[Loop1UInt + 1]) - 1));
-      printf("[%5u] - (LineSize - (strlen(&Dum1Str[Loop1UInt + 1])) - 1) / 2: %u\n", __LINE__, (LineSize - (strlen(&Dum1Str[Loop1UInt + 1]) - 1)) / 2);
-      printf("[%5u] - Displaying this number of spaces: %u\n", __LINE__, (LineSize - (strlen(&Dum1Str[Loop1UInt + 1]) - 1)) / 2);
-    }
+  Ring = &LogRing[get_core_num() & 0x01];
 
-    /* If a valid line size has been found, print required spaces so that text will be properly centered on the line.
-       If no ending closing bracket has been found or if the number of spaces is too small or too large, display the text has is...
-       It is possible that the opening angle bracket was simply part of the text to be displayed. */
-    if ((Loop1UInt < 6) && (LineSize > 5) && (LineSize < 200) && (LineSize > (strlen(&Dum1Str[Loop1UInt + 1]) - 1)))
-    {
-      for (Loop2UInt = 0; Loop2UInt < (LineSize - (strlen(&Dum1Str[Loop1UInt + 1]) - 1)) / 2; ++Loop2UInt)
-        printf(" ");
-    }
-    printf("%s", &Dum1Str[Loop1UInt + 1]);  // print the text to be logged while removing the heading <xxx> representing the line size.
+  /* An interrupt on this core could log a line of its own: it must wait until this one has been copied. The other core has its own ring buffer. */
+  Interrupts = save_and_disable_interrupts();
+
+  Head = Ring->Head;
+  Used = Head - Ring->Tail;
+  if (Length > (LOG_RING_SIZE - Used))
+  {
+    /* Ring buffer is full: drop the line, never wait for the terminal. */
+    ++Ring->Dropped;
+    restore_interrupts(Interrupts);
     return;
   }
 
-  /* If the text to log does not need to be centered, display it to log file. */
-  printf(Dum1Str);
+  Offset = Head & (LOG_RING_SIZE - 1);
+  First  = LOG_RING_SIZE - Offset;
+  if (First > Length) First = Length;
+  memcpy(&Ring->Buffer[Offset], Line, First);
+  memcpy(Ring->Buffer, &Line[First], Length - First);  // part of the line going around the end of the buffer.
+  __dmb();  // the line must be in the buffer before log_drain() sees the new Head.
+  Ring->Head = Head + Length;
+
+  restore_interrupts(Interrupts);
+
+  if (LogWakeup && (Used < (LOG_RING_SIZE / 2)) && ((Used + Length) >= (LOG_RING_SIZE / 2))) LogWakeup();
 
   return;
 }